@@ -0,0 +1,211 @@
+/**
+ * @file api.hpp
+ * @author Cassandra Masschelein
+ * @brief Define a library interface for programs that schedule parcels in their own process, from trucks and parcels they already hold in memory
+ * @version 0.1
+ * @date 2022-04-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "schedule.hpp"
+#include "consolidate.hpp"
+#include "thread_pool.hpp"
+#include <vector>
+#include <string>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <memory>
+
+using namespace std;
+
+/**
+ * @brief The scheduling algorithms a program can choose between
+ *
+ */
+enum class schedule_strategy
+{
+    random_parcels, // randomScheduler
+    most_parcels,   // mostparcelScheduler
+    short_route,    // shortrouteScheduler
+    low_cost        // lowcostScheduler
+};
+
+/**
+ * @brief Read the name of a scheduling algorithm, the names are the ones used for profiling and checkpoints
+ *
+ * @param name The name of the scheduling algorithm
+ * @return The scheduling algorithm
+ */
+schedule_strategy parse_schedule_strategy(const string &name)
+{
+    if (name == "random")
+        return schedule_strategy::random_parcels;
+    if (name == "mostparcel")
+        return schedule_strategy::most_parcels;
+    if (name == "shortroute")
+        return schedule_strategy::short_route;
+    if (name == "lowcost")
+        return schedule_strategy::low_cost;
+    throw invalid_argument("Unknown scheduling algorithm " + name + ", the algorithms are random, mostparcel, shortroute, and lowcost!");
+}
+
+/**
+ * @brief The truck ID given to a parcel that was not loaded onto any truck
+ *
+ */
+const uint64_t no_truck = numeric_limits<uint64_t>::max();
+
+/**
+ * @brief The trucks and parcels of one schedule, and how they are to be scheduled. The trucks and parcels are owned by the caller
+ * and are used where they are
+ *
+ */
+struct schedule_request
+{
+    item_span<const parcels> parcel_list; // The parcels to be delivered, with unique IDs
+    item_span<trucks> truck_list;         // The trucks available for delivering parcels, loaded in place
+    schedule_strategy strategy = schedule_strategy::short_route;
+    bool pickup_delivery = false;                                                             // Pick each parcel up at its source city
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();     // The time by which scheduling must stop
+    checkpoint_spec checkpoints;                                                              // Where and how often to save checkpoints, none by default
+    uint64_t shipment_percent = 0; // Merge parcels into shipments of at most this percentage of the median truck capacity, 0 to schedule every parcel on its own
+};
+
+/**
+ * @brief How many parcels a schedule loaded and left behind
+ *
+ */
+struct schedule_summary
+{
+    uint64_t packed = 0;
+    uint64_t unpacked = 0;
+};
+
+/**
+ * @brief Schedules parcels for a program that links the scheduler in instead of writing data files and running main. A context is
+ * built once for a distance map and used for every schedule on that map, so that its worker threads and the lists that each
+ * schedule is split and summarized in are made once and reused, and repeated schedules of similar size allocate little
+ *
+ */
+class schedule_context
+{
+public:
+    /**
+     * @brief Construct a new schedule context object
+     *
+     * @param _dmap The distance map every schedule is made on, which must outlive the context. A map that is not completed or set
+     * to compute distances lazily is completed on the first distance it is asked for
+     * @param threads The number of worker threads that schedule depots at the same time
+     */
+    explicit schedule_context(const distanceMap &_dmap, const uint64_t &threads = thread::hardware_concurrency()) : dmap(_dmap), own_pool(make_unique<thread_pool>(threads)), pool(*own_pool) {}
+
+    /**
+     * @brief Construct a new schedule context object that schedules depots on a thread pool the program already has, so that
+     * scheduling shares its workers and their NUMA nodes with the program's other parallel work instead of starting threads of its own.
+     * A schedule waits only for its own depots, and may be made from a task running on the pool. Schedules made at the same time
+     * each need a context of their own, as a context reuses its lists
+     *
+     * @param _dmap The distance map every schedule is made on, which must outlive the context
+     * @param shared_pool The thread pool, which must outlive the context
+     */
+    schedule_context(const distanceMap &_dmap, thread_pool &shared_pool) : dmap(_dmap), pool(shared_pool) {}
+
+    /**
+     * @brief Schedule parcels onto trucks. The trucks are loaded in place, so their routes and parcel lists hold the schedule
+     * afterwards, and the ID of the truck each parcel was loaded onto is written to a buffer owned by the caller
+     *
+     * @param request The trucks and parcels, and how they are to be scheduled
+     * @param assigned_trucks Set to the ID of the truck each parcel was loaded onto, in the order of the parcels, or no_truck for
+     * the parcels that were not loaded. It must hold at least one entry for every parcel
+     * @return How many parcels were loaded and left behind
+     */
+    schedule_summary schedule(const schedule_request &request, const item_span<uint64_t> &assigned_trucks)
+    {
+        if (assigned_trucks.size() < request.parcel_list.size())
+            throw invalid_argument("The buffer for the assigned trucks holds " + to_string(assigned_trucks.size()) + " entries, but there are " + to_string(request.parcel_list.size()) + " parcels!");
+        switch (request.strategy)
+        {
+        case schedule_strategy::random_parcels:
+            run<randomScheduler>(request);
+            break;
+        case schedule_strategy::most_parcels:
+            run<mostparcelScheduler>(request);
+            break;
+        case schedule_strategy::short_route:
+            run<shortrouteScheduler>(request);
+            break;
+        case schedule_strategy::low_cost:
+            run<lowcostScheduler>(request);
+            break;
+        }
+
+        /* Find each loaded parcel by its ID, a truck may also carry parcels from an earlier schedule that are not in this request. */
+        position.clear();
+        for (uint64_t i = 0; i < request.parcel_list.size(); i++)
+            position[request.parcel_list[i].this_id()] = i;
+        fill(assigned_trucks.begin(), assigned_trucks.begin() + (int64_t)request.parcel_list.size(), no_truck);
+        schedule_summary summary;
+        for (const trucks &truck : request.truck_list)
+        {
+            for (const uint64_t &id : truck.parcels_list)
+            {
+                auto found = position.find(id);
+                if (found != position.end() and assigned_trucks[found->second] == no_truck)
+                {
+                    assigned_trucks[found->second] = truck.my_id();
+                    summary.packed++;
+                }
+            }
+        }
+        summary.unpacked = request.parcel_list.size() - summary.packed;
+        return summary;
+    }
+
+    /**
+     * @brief The distance map every schedule is made on, for measuring the schedules
+     *
+     * @return The distance map
+     */
+    const distanceMap &distance_map() const
+    {
+        return dmap;
+    }
+
+private:
+    /**
+     * @brief Schedule the trucks and parcels of a request with one scheduling algorithm
+     *
+     * @tparam scheduler_type The scheduling algorithm
+     * @param request The trucks and parcels, and how they are to be scheduled
+     */
+    template <class scheduler_type>
+    void run(const schedule_request &request)
+    {
+        if (request.shipment_percent != 0)
+            schedule_consolidated<scheduler_type>(request.parcel_list, request.truck_list, dmap, pool, request.shipment_percent, request.deadline, request.checkpoints, request.pickup_delivery);
+        else
+            schedule_depots<scheduler_type>(request.parcel_list, request.truck_list, dmap, pool, request.deadline, request.checkpoints, request.pickup_delivery, &workspace);
+    }
+
+    /**
+     * @brief The distance map, and the worker threads that schedule depots, which the context owns unless it was given a shared pool
+     *
+     */
+    const distanceMap &dmap;
+    unique_ptr<thread_pool> own_pool;
+    thread_pool &pool;
+    /**
+     * @brief The lists a schedule is split by depot in, and the position of each parcel by its ID, kept for the next schedule
+     *
+     */
+    depot_workspace workspace;
+    unordered_map<uint64_t, uint64_t> position;
+};
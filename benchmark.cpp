@@ -0,0 +1,423 @@
+/**
+ * @file benchmark.cpp
+ * @author Cassandra Masschelein
+ * @brief A benchmark suite that times each stage of the scheduler on synthetic instances and reports the results in a machine-readable format
+ * @version 0.1
+ * @date 2022-01-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#include "domain.hpp"
+#include "schedule.hpp"
+#include "repair.hpp"
+#include "loader.hpp"
+#include "generator.hpp"
+#include "bounds.hpp"
+#include "api.hpp"
+#include "spill.hpp"
+#include "consolidate.hpp"
+#include "thread_pool.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <filesystem>
+#include <thread>
+
+using namespace std;
+
+/**
+ * @brief The timing of one benchmark
+ *
+ */
+struct benchmark_result
+{
+    string name;
+    uint64_t iterations;
+    double real_time; // Average wall time per iteration (in ns)
+    double cpu_time;  // Average process CPU time per iteration (in ns)
+    double items_per_second;
+};
+
+/**
+ * @brief Keep a value alive so that the compiler cannot remove the work that produced it
+ *
+ */
+volatile uint64_t benchmark_sink;
+
+/**
+ * @brief Read the CPU time used by this process (in ns)
+ *
+ * @return The CPU time of all threads in this process
+ */
+double process_cpu_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * @brief A suite of benchmarks that repeats each benchmark until it has run for a minimum time
+ *
+ */
+class benchmark_suite
+{
+public:
+    /**
+     * @brief Construct a new benchmark suite object
+     *
+     * @param _min_time The minimum total time (in s) to run each benchmark for
+     */
+    explicit benchmark_suite(const double &_min_time) : min_time(_min_time) {}
+
+    /**
+     * @brief Run one benchmark. Only the measured function is timed, the setup function runs before every iteration
+     *
+     * @param name The name of the benchmark
+     * @param items The number of items processed by one iteration, for throughput
+     * @param setup Prepares the state for an iteration
+     * @param measured The work to be timed
+     */
+    void run(const string &name, const uint64_t &items, const function<void()> &setup, const function<void()> &measured)
+    {
+        uint64_t iterations = 0;
+        double real_ns = 0.0, cpu_ns = 0.0;
+        while (iterations == 0 or (real_ns < min_time * 1e9 and iterations < 1000000))
+        {
+            setup();
+            double cpu_start = process_cpu_ns();
+            auto start = chrono::steady_clock::now();
+            measured();
+            auto stop = chrono::steady_clock::now();
+            cpu_ns += process_cpu_ns() - cpu_start;
+            real_ns += (double)chrono::duration_cast<chrono::nanoseconds>(stop - start).count();
+            iterations += 1;
+        }
+        double real_time = real_ns / (double)iterations;
+        results.push_back({name, iterations, real_time, cpu_ns / (double)iterations, real_time > 0.0 ? (double)items * 1e9 / real_time : 0.0});
+        cerr << name << ": " << real_time << " ns over " << iterations << " iterations \n";
+    }
+
+    /**
+     * @brief Write the results as JSON, in the same layout as Google Benchmark
+     *
+     * @param out The stream to write to
+     * @param context Key and value pairs describing the run
+     */
+    void write_json(ostream &out, const vector<pair<string, string> > &context) const
+    {
+        out << "{\n  \"context\": {\n";
+        for (uint64_t i = 0; i < context.size(); i++)
+            out << "    \"" << context[i].first << "\": \"" << context[i].second << "\"" << (i + 1 < context.size() ? "," : "") << "\n";
+        out << "  },\n  \"benchmarks\": [\n";
+        for (uint64_t i = 0; i < results.size(); i++)
+        {
+            const benchmark_result &r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations << ", \"real_time\": " << r.real_time << ", \"cpu_time\": " << r.cpu_time << ", \"time_unit\": \"ns\", \"items_per_second\": " << r.items_per_second << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    /**
+     * @brief Write the results as CSV, one benchmark per line
+     *
+     * @param out The stream to write to
+     */
+    void write_csv(ostream &out) const
+    {
+        out << "name,iterations,real_time_ns,cpu_time_ns,items_per_second\n";
+        for (const benchmark_result &r : results)
+            out << r.name << "," << r.iterations << "," << r.real_time << "," << r.cpu_time << "," << r.items_per_second << "\n";
+    }
+
+    /**
+     * @brief Write the results as a table for reading in a terminal
+     *
+     * @param out The stream to write to
+     */
+    void write_console(ostream &out) const
+    {
+        out << left << setw(60) << "Benchmark" << right << setw(16) << "Time (ns)" << setw(16) << "CPU (ns)" << setw(12) << "Iterations" << setw(16) << "Items/s" << "\n";
+        for (const benchmark_result &r : results)
+            out << left << setw(60) << r.name << right << setw(16) << (uint64_t)r.real_time << setw(16) << (uint64_t)r.cpu_time << setw(12) << r.iterations << setw(16) << (uint64_t)r.items_per_second << "\n";
+    }
+
+private:
+    double min_time;
+    vector<benchmark_result> results;
+};
+
+/**
+ * @brief Time scheduling a generated instance with one scheduler
+ *
+ * @tparam scheduler_type The scheduler to be timed
+ * @param suite The benchmark suite
+ * @param name The name of the benchmark
+ * @param generated The instance to be scheduled
+ * @param dmap The distance map of the instance
+ * @param pool The thread pool that runs the depot tasks
+ */
+template <class scheduler_type>
+void benchmark_scheduler(benchmark_suite &suite, const string &name, const instance &generated, const distanceMap &dmap, thread_pool &pool)
+{
+    vector<trucks> truck_list;
+    suite.run(name, generated.parcel_list.size(),
+              [&] { truck_list = generated.truck_list; },
+              [&] { benchmark_sink = schedule_depots<scheduler_type>(generated.parcel_list, truck_list, dmap, pool).size(); });
+}
+
+/**
+ * @brief Run every stage of the program on one generated instance
+ *
+ * @param suite The benchmark suite
+ * @param spec The size and shape of the instance
+ * @param pool The thread pool that runs the depot tasks
+ */
+void benchmark_instance(benchmark_suite &suite, const instance_spec &spec, thread_pool &pool)
+{
+    instance generated = generate_instance(spec);
+    string size = "/c" + to_string(spec.cities) + "_t" + to_string(spec.trucks) + "_p" + to_string(spec.parcels);
+
+    /* Time reading each data file. */
+    filesystem::path dir = filesystem::temp_directory_path() / ("fedex-benchmark-" + to_string(spec.seed));
+    filesystem::create_directories(dir);
+    string truck_path = (dir / "truck-data.csv").string(), parcel_path = (dir / "parcel-data.csv").string(), map_path = (dir / "map-data.csv").string();
+    write_instance(generated, truck_path, parcel_path, map_path);
+    auto no_setup = [] {};
+    suite.run("load/truck_csv" + size, spec.trucks, no_setup, [&] { benchmark_sink = read_truck_file(truck_path, "").size(); });
+    suite.run("load/parcel_csv" + size, spec.parcels, no_setup, [&] { benchmark_sink = read_parcel_file(parcel_path).size(); });
+#ifdef FEDEX_ZLIB
+    {
+        /* Compress the parcel file to time reading it through the decompressing stream. */
+        ifstream whole(parcel_path, ios::binary);
+        string contents((istreambuf_iterator<char>(whole)), istreambuf_iterator<char>());
+        gzFile compressed = gzopen((parcel_path + ".gz").c_str(), "wb6");
+        gzwrite(compressed, contents.data(), (unsigned)contents.size());
+        gzclose(compressed);
+    }
+    suite.run("load/parcel_csv_gz" + size, spec.parcels, no_setup, [&] { benchmark_sink = read_parcel_file(parcel_path + ".gz").size(); });
+#endif
+    vector<string> shard_paths;
+    {
+        /* Split the parcel file into one shard per worker, as if each sorting centre sent its own file. */
+        ifstream whole(parcel_path);
+        vector<ofstream> shards;
+        for (uint64_t i = 0; i < pool.size(); i++)
+        {
+            shard_paths.push_back((dir / ("parcel-shard-" + to_string(i) + ".csv")).string());
+            shards.emplace_back(shard_paths.back());
+        }
+        string line;
+        for (uint64_t i = 0; getline(whole, line); i++)
+            shards[i % shards.size()] << line << '\n';
+    }
+    vector<shard_report> shard_reports;
+    suite.run("load/parcel_shards" + size, spec.parcels, no_setup, [&] { benchmark_sink = read_parcel_shards(shard_paths, &pool, shard_reports).size(); });
+    suite.run("load/map_csv" + size, generated.map_entries.size(), no_setup, [&] { benchmark_sink = read_map_file(map_path).size(); });
+    filesystem::remove_all(dir);
+
+    /* Time building the distance map. */
+    suite.run("build/distance_map" + size, generated.map_entries.size(), no_setup, [&] {
+        distanceMap dmap = build_distance_map(generated.map_entries);
+        benchmark_sink = dmap.number_of_cities();
+    });
+    distanceMap dmap;
+    suite.run("build/all_pairs" + size, spec.cities * spec.cities, [&] { dmap = build_distance_map(generated.map_entries); }, [&] { dmap.complete(&pool); });
+    distanceMap lazy_map;
+    suite.run("schedule/lazy_distances" + size, spec.parcels, [&] { lazy_map = build_distance_map(generated.map_entries); lazy_map.use_lazy_distances(spec.cities * 4); }, [&] {
+        vector<trucks> truck_list = generated.truck_list;
+        benchmark_sink = schedule_depots<shortrouteScheduler>(generated.parcel_list, truck_list, lazy_map, pool).size();
+    });
+
+    /* Time each scheduler. */
+    benchmark_scheduler<randomScheduler>(suite, "schedule/random" + size, generated, dmap, pool);
+    benchmark_scheduler<mostparcelScheduler>(suite, "schedule/mostparcel" + size, generated, dmap, pool);
+    benchmark_scheduler<shortrouteScheduler>(suite, "schedule/shortroute" + size, generated, dmap, pool);
+    benchmark_scheduler<lowcostScheduler>(suite, "schedule/lowcost" + size, generated, dmap, pool);
+    suite.run("schedule/pickup_delivery" + size, spec.parcels, no_setup, [&] {
+        vector<trucks> truck_list = generated.truck_list;
+        benchmark_sink = schedule_depots<shortrouteScheduler>(generated.parcel_list, truck_list, dmap, pool, chrono::steady_clock::time_point::max(), checkpoint_spec(), true).size();
+    });
+
+    /* Time scheduling again and again through the library interface, which shares the benchmark's pool and reuses its lists between schedules. */
+    schedule_context context(dmap, pool);
+    vector<trucks> context_trucks;
+    vector<uint64_t> assigned_trucks(spec.parcels);
+    schedule_request request;
+    request.parcel_list = generated.parcel_list;
+    suite.run("api/shortroute" + size, spec.parcels, [&] { context_trucks = generated.truck_list; request.truck_list = context_trucks; },
+              [&] { benchmark_sink = context.schedule(request, assigned_trucks).packed; });
+
+    /* Time the same schedule with the parcels merged into shipments of a quarter of a typical truck. */
+    vector<trucks> consolidated_trucks;
+    suite.run("consolidate/shortroute" + size, spec.parcels, [&] { consolidated_trucks = generated.truck_list; },
+              [&] { benchmark_sink = schedule_consolidated<shortrouteScheduler>(generated.parcel_list, consolidated_trucks, dmap, pool, 25).size(); });
+
+    /* Time the same schedule with the parcels spilled to sorted runs of about a tenth of the day each and merged back as they are loaded. */
+    spill_spec spill;
+    spill.budget_bytes = max<uint64_t>(spec.parcels * sizeof(parcels) / 10, 1);
+    unique_ptr<external_parcels<shortrouteScheduler::order_policy> > spilled;
+    vector<trucks> spilled_trucks;
+    suite.run("spill/shortroute" + size, spec.parcels, [&] {
+        spilled_trucks = generated.truck_list;
+        spilled.reset();
+        spilled = make_unique<external_parcels<shortrouteScheduler::order_policy> >(spill);
+        for (const parcels &parcel : generated.parcel_list)
+            spilled->add(parcel);
+        spilled->finish();
+    }, [&] {
+        external_unpacked left(spill);
+        schedule_depots_external<shortrouteScheduler>(*spilled, spilled_trucks, dmap, left);
+        benchmark_sink = left.size();
+    });
+
+    /* Time each fleet statistic on the fleet built by the most parcel scheduler. */
+    vector<trucks> truck_list = generated.truck_list;
+    schedule_depots<mostparcelScheduler>(generated.parcel_list, truck_list, dmap, pool);
+    fleet scheduled;
+    for (const trucks &truck : truck_list)
+        scheduled.add_truck(truck);
+    suite.run("stats/number_trucks_used" + size, spec.trucks, no_setup, [&] { benchmark_sink = scheduled.number_trucks_used(); });
+    suite.run("stats/free_vol_in_used_trucks" + size, spec.trucks, no_setup, [&] { benchmark_sink = scheduled.free_vol_in_used_trucks(); });
+    suite.run("stats/avg_capacity_used" + size, spec.trucks, no_setup, [&] { benchmark_sink = (uint64_t)scheduled.avg_capacity_used(); });
+    suite.run("stats/std_dev_capacity_used" + size, spec.trucks, no_setup, [&] { benchmark_sink = (uint64_t)scheduled.std_dev_capacity_used(); });
+    fleet measured;
+    suite.run("stats/truck_distances" + size, spec.trucks, [&] {
+        measured = fleet();
+        for (const trucks &truck : truck_list)
+            measured.add_truck(truck);
+    }, [&] { benchmark_sink = measured.truck_distances(dmap).size(); });
+    suite.run("stats/avg_distance_travelled" + size, spec.trucks, no_setup, [&] { benchmark_sink = (uint64_t)scheduled.avg_distance_travelled(dmap); });
+    suite.run("stats/std_dev_distance_travelled" + size, spec.trucks, no_setup, [&] { benchmark_sink = (uint64_t)scheduled.std_dev_distance_travelled(dmap); });
+    suite.run("stats/lower_bounds" + size, spec.parcels, no_setup, [&] { benchmark_sink = lower_bounds(truck_list, generated.parcel_list, dmap).trucks; });
+
+    /* Time repairing the schedule after a small change, which should not grow with the size of the day. */
+    fleet_delta delta;
+    for (uint64_t i = 0; i < 10 and i < generated.parcel_list.size(); i++)
+    {
+        const parcels &parcel = generated.parcel_list[i * generated.parcel_list.size() / 10];
+        delta.cancelled_parcels.push_back(parcel.this_id());
+        delta.added_parcels.emplace_back(spec.parcels + i, parcel.load(), parcel.where_from(), parcel.where_to(), parcel.window());
+    }
+    unique_ptr<fleet_repair> repair;
+    suite.run("repair/small_delta" + size, delta.cancelled_parcels.size() + delta.added_parcels.size(), [&] { repair = make_unique<fleet_repair>(truck_list, generated.parcel_list, dmap); }, [&] { benchmark_sink = repair->apply(delta).size(); });
+}
+
+int main(int argc, char *argv[])
+{
+    string usage = "Usage: ./benchmark [--format=console|json|csv] [--out=FILE] [--min_time=SECONDS] [--cities=N --trucks=T --parcels=P --depots=D --neighbours=K] [--distribution=uniform|exponential|bimodal] [--max_weight=W] [--shift_minutes=M] [--cost_per_km=C] [--transfer_percent=T] [--seed=S] \nWithout an instance size a default sweep of sizes is run. \n";
+    string format = "console", out_path = "";
+    double min_time = 0.2;
+    instance_spec spec;
+    spec.cost_per_km = 100; // Trucks have costs so that the low cost scheduler has something to weigh, the other schedulers ignore them
+    bool custom_size = false;
+
+    /* Read the command line options. */
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            uint64_t split = arg.find('=');
+            if (arg.rfind("--", 0) != 0 or split == string::npos)
+                throw invalid_argument("Unknown option " + arg);
+            string key = arg.substr(2, split - 2), value = arg.substr(split + 1);
+            if (key == "format")
+                format = value;
+            else if (key == "out")
+                out_path = value;
+            else if (key == "min_time")
+                min_time = stod(value);
+            else if (key == "distribution")
+                spec.distribution = parse_distribution(value);
+            else if (key == "seed")
+                spec.seed = stoull(value);
+            else if (key == "max_weight")
+                spec.max_weight = stoull(value);
+            else if (key == "shift_minutes")
+                spec.shift_minutes = stoull(value);
+            else if (key == "cost_per_km")
+                spec.cost_per_km = stoull(value);
+            else if (key == "transfer_percent")
+                spec.transfer_percent = stoull(value);
+            else if (key == "neighbours")
+                spec.neighbours = stoull(value);
+            else if (key == "cities" or key == "trucks" or key == "parcels" or key == "depots")
+            {
+                uint64_t number = stoull(value);
+                (key == "cities" ? spec.cities : key == "trucks" ? spec.trucks : key == "parcels" ? spec.parcels : spec.depots) = number;
+                custom_size = true;
+            }
+            else
+                throw invalid_argument("Unknown option " + arg);
+        }
+        if (format != "console" and format != "json" and format != "csv")
+            throw invalid_argument("Unknown format " + format);
+    }
+    catch (const exception &ex)
+    {
+        cerr << "Invalid argument: " << ex.what() << '\n';
+        cout << usage;
+        return -1;
+    }
+
+    /* Run the benchmarks over the chosen instance, or over the default sweep of instance sizes. */
+    vector<instance_spec> sweep;
+    if (custom_size)
+        sweep.push_back(spec);
+    else
+    {
+        for (const uint64_t scale : {1, 4, 16})
+        {
+            instance_spec sized = spec;
+            sized.cities = 25 * scale;
+            sized.trucks = 10 * scale;
+            sized.parcels = 500 * scale;
+            sweep.push_back(sized);
+        }
+    }
+
+    benchmark_suite suite(min_time);
+    thread_pool pool;
+    try
+    {
+        for (const instance_spec &sized : sweep)
+            benchmark_instance(suite, sized, pool);
+    }
+    catch (const exception &ex)
+    {
+        cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    /* Write the report. */
+    ofstream out_file;
+    if (not out_path.empty())
+    {
+        out_file.open(out_path);
+        if (!out_file.is_open())
+        {
+            cout << "Error opening output file for the benchmark report!";
+            return -1;
+        }
+    }
+    ostream &out = out_path.empty() ? cout : out_file;
+    time_t now = time(nullptr);
+    string date = ctime(&now);
+    date.pop_back(); // Remove the trailing newline
+    vector<pair<string, string> > context = {{"date", date}, {"num_cpus", to_string(thread::hardware_concurrency())}, {"seed", to_string(spec.seed)}};
+    if (format == "json")
+        suite.write_json(out, context);
+    else if (format == "csv")
+        suite.write_csv(out);
+    else
+        suite.write_console(out);
+}
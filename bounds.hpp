@@ -0,0 +1,257 @@
+/**
+ * @file bounds.hpp
+ * @author Cassandra Masschelein
+ * @brief Define lower bounds on the number of trucks and the distance any schedule needs, so that each schedule can be compared to the best possible
+ * @version 0.1
+ * @date 2022-03-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <limits>
+
+using namespace std;
+
+/**
+ * @brief Lower bounds for the parcels loaded by a schedule. No schedule that delivers the same parcels with the same trucks can
+ * use fewer trucks or drive less
+ *
+ */
+struct schedule_bounds
+{
+    uint64_t trucks = 0;   // The fewest trucks the parcels fit in
+    uint64_t distance = 0; // The shortest total distance of closed tours that reach every destination (in km)
+};
+
+/**
+ * @brief The Martello and Toth L2 lower bound on the number of bins of one capacity that a set of items fits in. For each threshold
+ * the items larger than half a bin each need their own bin, and the items between the threshold and half a bin must fit in the room
+ * left in the bins of the items that can share a bin with them, or else in new bins
+ *
+ * @param sizes The size of each item, none larger than the capacity
+ * @param capacity The capacity of a bin
+ * @return The fewest bins the items fit in
+ */
+uint64_t bin_packing_bound(vector<uint64_t> sizes, const uint64_t &capacity)
+{
+    if (capacity == 0 or sizes.empty())
+        return 0;
+    sort(sizes.begin(), sizes.end());
+    vector<uint64_t> prefix(sizes.size() + 1, 0); // The sum of the smallest items
+    for (uint64_t i = 0; i < sizes.size(); i++)
+        prefix[i + 1] = prefix[i] + sizes[i];
+    uint64_t half = lower_bound(sizes.begin(), sizes.end(), capacity / 2 + 1) - sizes.begin(); // The first item larger than half a bin
+    uint64_t best = 0;
+    /* Only the item sizes up to half a bin change the bound, so only they are tried as thresholds. */
+    for (uint64_t first = 0; first <= half; first++)
+    {
+        if (first != 0 and first < half and sizes[first] == sizes[first - 1])
+            continue;
+        uint64_t alpha = first < half ? sizes[first] : capacity / 2;
+        uint64_t own = upper_bound(sizes.begin(), sizes.end(), capacity - alpha) - sizes.begin(); // Items that no item of at least alpha can share a bin with
+        uint64_t shared = own > half ? own - half : 0;                                            // Items larger than half a bin that may share
+        uint64_t room = shared * capacity - (prefix[max(own, half)] - prefix[half]);
+        uint64_t small = prefix[half] - prefix[first];
+        uint64_t bins = (sizes.size() - max(own, half)) + shared;
+        if (small > room)
+            bins += (small - room + capacity - 1) / capacity;
+        best = max(best, bins);
+    }
+    return best;
+}
+
+/**
+ * @brief A lower bound on the number of trucks of different sizes that a set of parcels fits in, in one capacity dimension. The
+ * parcels need at least as many trucks as it takes for the largest trucks to hold their total size, and at least as many as the
+ * L2 bound gives if every truck were as large as the largest truck
+ *
+ * @param sizes The room each parcel takes up
+ * @param capacities The capacity of each truck
+ * @return The fewest trucks the parcels fit in
+ */
+uint64_t fleet_size_bound(const vector<uint64_t> &sizes, vector<uint64_t> capacities)
+{
+    if (sizes.empty() or capacities.empty())
+        return 0;
+    sort(capacities.begin(), capacities.end(), greater<uint64_t>());
+    uint64_t total = 0;
+    for (const uint64_t &size : sizes)
+        total += size;
+    uint64_t by_total = 0, held = 0;
+    while (by_total < capacities.size() and held < total)
+        held += capacities[by_total++];
+    return max(by_total, bin_packing_bound(sizes, capacities[0]));
+}
+
+/**
+ * @brief The weight of a minimum spanning tree over a set of cities, found by Prim's algorithm on the distance matrix. A set of
+ * closed tours that all pass through one of the cities and together reach the others is never shorter, since shortcutting the tours
+ * past every other city leaves a connected graph over the set
+ *
+ * @param cities The map indices of the cities, without repeats
+ * @param dmap The distance map
+ * @return The weight of the tree (in km), pairs of cities that no road connects are left out
+ */
+uint64_t spanning_tree_bound(const vector<uint32_t> &cities, const distanceMap &dmap)
+{
+    const uint64_t unreached = numeric_limits<uint64_t>::max();
+    vector<uint64_t> nearest(cities.size(), unreached); // The shortest edge from each city to the tree
+    vector<bool> in_tree(cities.size(), false);
+    uint64_t weight = 0, next = 0;
+    for (uint64_t added = 0; added < cities.size(); added++)
+    {
+        in_tree[next] = true;
+        if (nearest[next] != unreached)
+            weight += nearest[next];
+        uint64_t closest = cities.size();
+        for (uint64_t i = 0; i < cities.size(); i++)
+        {
+            if (in_tree[i])
+                continue;
+            try
+            {
+                nearest[i] = min(nearest[i], dmap.distance(cities[next], cities[i]));
+            }
+            catch (const map_invalidation::map_error &)
+            {
+            }
+            if (closest == cities.size() or nearest[i] < nearest[closest])
+                closest = i;
+        }
+        next = closest;
+    }
+    return weight;
+}
+
+/**
+ * @brief Find lower bounds for the parcels a schedule loaded. The trucks and parcels of each depot are bounded on their own and the
+ * bounds are added up. The truck bound is the largest over the capacity dimensions that limit some truck, and the distance bound is
+ * the larger of the spanning tree over the depot and every destination and the round trip to the farthest destination. The parcels
+ * are visited once and only the sizes and destinations of the loaded ones are kept, so they may be streamed from disk
+ *
+ * @tparam parcel_source A function that calls the function it is given with every parcel that was scheduled
+ * @param truck_list The scheduled trucks
+ * @param for_each_parcel The function that visits the parcels that were scheduled, which are matched by the IDs loaded on the trucks
+ * @param dmap The distance map
+ * @param pickup_delivery If parcels were picked up at their source city, the room on a truck is then used again after each delivery
+ * so only one truck per depot is certain
+ * @return The lower bounds
+ */
+template <class parcel_source>
+schedule_bounds lower_bounds_streamed(const vector<trucks> &truck_list, parcel_source for_each_parcel, const distanceMap &dmap, const bool &pickup_delivery = false)
+{
+    /* Find the depot of every loaded parcel and the trucks of each depot. */
+    vector<string> depots;
+    vector<vector<const trucks *> > depot_trucks;
+    unordered_map<uint64_t, uint32_t> loaded_depot;
+    for (const trucks &truck : truck_list)
+    {
+        uint64_t d = find(depots.begin(), depots.end(), truck.home_depot()) - depots.begin();
+        if (d == depots.size())
+        {
+            depots.push_back(truck.home_depot());
+            depot_trucks.emplace_back();
+        }
+        depot_trucks[d].push_back(&truck);
+        for (const uint64_t &id : truck.parcels_list)
+            loaded_depot.emplace(id, (uint32_t)d);
+    }
+
+    /* Gather the sizes and destinations of the loaded parcels of each depot, the depot comes first so that the farthest destination is measured from it. */
+    vector<array<vector<uint64_t>, capacity_dimensions> > depot_sizes(depots.size());
+    vector<vector<uint32_t> > depot_cities(depots.size());
+    vector<unordered_set<uint32_t> > seen(depots.size());
+    for (uint64_t d = 0; d < depots.size(); d++)
+    {
+        depot_cities[d].push_back(dmap.city_id(depots[d]));
+        seen[d].insert(depot_cities[d][0]);
+    }
+    for_each_parcel([&](const parcels &parcel) {
+        auto found = loaded_depot.find(parcel.this_id());
+        if (found == loaded_depot.end())
+            return;
+        uint32_t d = found->second;
+        for (uint64_t i = 0; i < capacity_dimensions; i++)
+            depot_sizes[d][i].push_back(parcel.load()[i]);
+        uint32_t city = dmap.city_id(parcel.where_to());
+        if (seen[d].insert(city).second)
+            depot_cities[d].push_back(city);
+    });
+
+    schedule_bounds bounds;
+    for (uint64_t d = 0; d < depots.size(); d++)
+    {
+        if (depot_sizes[d][0].empty())
+            continue;
+        uint64_t depot_trucks_needed = 0;
+        for (uint64_t i = 0; i < capacity_dimensions and not pickup_delivery; i++)
+        {
+            vector<uint64_t> capacities;
+            for (const trucks *truck : depot_trucks[d])
+            {
+                if (truck->limits()[i] != unlimited_capacity)
+                    capacities.push_back(truck->limits()[i]);
+            }
+            if (capacities.size() != depot_trucks[d].size()) // A truck that is not limited in this dimension could take every parcel
+                continue;
+            depot_trucks_needed = max(depot_trucks_needed, fleet_size_bound(depot_sizes[d][i], capacities));
+        }
+        bounds.trucks += max<uint64_t>(depot_trucks_needed, 1);
+
+        const vector<uint32_t> &cities = depot_cities[d];
+        uint64_t farthest = 0;
+        for (uint64_t i = 1; i < cities.size(); i++)
+        {
+            try
+            {
+                farthest = max(farthest, 2 * dmap.distance(cities[0], cities[i]));
+            }
+            catch (const map_invalidation::map_error &)
+            {
+            }
+        }
+        bounds.distance += max(farthest, spanning_tree_bound(cities, dmap));
+    }
+    return bounds;
+}
+
+/**
+ * @brief Find lower bounds for the parcels a schedule loaded, from parcels held in memory
+ *
+ * @param truck_list The scheduled trucks
+ * @param parcel_list The parcels that were scheduled, looked up by the IDs loaded on the trucks
+ * @param dmap The distance map
+ * @param pickup_delivery If parcels were picked up at their source city
+ * @return The lower bounds
+ */
+schedule_bounds lower_bounds(const vector<trucks> &truck_list, const vector<parcels> &parcel_list, const distanceMap &dmap, const bool &pickup_delivery = false)
+{
+    auto for_each_parcel = [&parcel_list](auto visit) {
+        for (const parcels &parcel : parcel_list)
+            visit(parcel);
+    };
+    return lower_bounds_streamed(truck_list, for_each_parcel, dmap, pickup_delivery);
+}
+
+/**
+ * @brief The optimality gap of a schedule, how much of its value is more than the lower bound
+ *
+ * @param value The value the schedule reached
+ * @param bound The lower bound on the value
+ * @return The gap as a percentage of the value, 0 if the schedule reaches the bound
+ */
+double optimality_gap(const uint64_t &value, const uint64_t &bound)
+{
+    if (value == 0 or bound >= value)
+        return 0.0;
+    return 100.0 * (double)(value - bound) / (double)value;
+}
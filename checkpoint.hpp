@@ -0,0 +1,278 @@
+/**
+ * @file checkpoint.hpp
+ * @author Cassandra Masschelein
+ * @brief Define compact binary checkpoint files, so that a long scheduling job can be resumed where it stopped
+ * @version 0.1
+ * @date 2022-02-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Unique error messages for checkpoint files that cannot be resumed from
+ *
+ */
+namespace checkpoint_invalidation
+{
+    /**
+     * @brief Error message for when a checkpoint file is damaged or was written for different data
+     *
+     */
+    class checkpoint_error : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new checkpoint error object
+         *
+         * @param path The path of the checkpoint file
+         */
+            checkpoint_error(const string &path) : invalid_argument("The checkpoint file " + path + " is damaged or was written for different trucks and parcels!"){};
+    };
+
+    /**
+     * @brief Error message for when a checkpoint file cannot be written
+     *
+     */
+    class save_error : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new save error object
+         *
+         * @param path The path of the checkpoint file
+         */
+            save_error(const string &path) : invalid_argument("The checkpoint file " + path + " could not be written!"){};
+    };
+}
+
+/**
+ * @brief Where and how often a scheduler saves its progress, and whether it resumes from a saved checkpoint
+ *
+ */
+struct checkpoint_spec
+{
+    string path;                  // The path of the checkpoint file, no checkpoints are saved if it is empty
+    uint64_t every_parcels = 4096; // The number of parcels loaded between checkpoints
+    bool resume = false;          // Continue from the checkpoint file if it exists
+};
+
+/**
+ * @brief Identify the trucks and parcels a checkpoint belongs to, so that a checkpoint is never resumed with different data
+ *
+ * @param parcel_list The list of parcels being scheduled
+ * @param truck_list The list of trucks being scheduled
+ * @return A hash of the parcels and the empty trucks
+ */
+uint64_t schedule_fingerprint(const item_span<const parcels> &parcel_list, const item_span<const trucks> &truck_list)
+{
+    fnv_hash hash;
+    hash.mix(parcel_list.size());
+    for (const parcels &parcel : parcel_list)
+    {
+        hash.mix(parcel.this_id());
+        for (const uint64_t &amount : parcel.load())
+            hash.mix(amount);
+        hash.mix(parcel.where_from());
+        hash.mix(parcel.where_to());
+        hash.mix(parcel.window().earliest);
+        hash.mix(parcel.window().latest);
+    }
+    hash.mix(truck_list.size());
+    for (const trucks &truck : truck_list)
+    {
+        hash.mix(truck.my_id());
+        for (const uint64_t &limit : truck.limits())
+            hash.mix(limit);
+        hash.mix(truck.home_depot());
+        hash.mix(truck.max_duration());
+        hash.mix(truck.fixed_cost());
+        hash.mix(truck.km_cost());
+    }
+    return hash.value();
+}
+
+/**
+ * @brief Build a checkpoint in memory and save it in one step. The file is replaced by renaming, so a job that is killed
+ * while saving leaves the previous checkpoint whole
+ *
+ */
+class checkpoint_writer
+{
+public:
+    /**
+     * @brief Add a whole number
+     *
+     * @param value The number
+     */
+    void put(const uint64_t &value)
+    {
+        buffer.append((const char *)&value, sizeof(value));
+    }
+
+    /**
+     * @brief Add a string, preceded by its length
+     *
+     * @param value The string
+     */
+    void put(const string &value)
+    {
+        put(value.size());
+        buffer.append(value);
+    }
+
+    /**
+     * @brief Add a list of whole numbers, preceded by its length
+     *
+     * @param values The list
+     */
+    void put(const vector<uint64_t> &values)
+    {
+        put(values.size());
+        for (const uint64_t &value : values)
+            put(value);
+    }
+
+    /**
+     * @brief Save the checkpoint followed by a checksum of its contents
+     *
+     * @param path The path of the checkpoint file
+     * @return True or False whether the checkpoint was saved
+     */
+    bool commit(const string &path) const
+    {
+        string temporary = path + ".tmp";
+        {
+            ofstream out(temporary, ios::binary | ios::trunc);
+            if (!out.is_open())
+                return false;
+            fnv_hash hash;
+            hash.mix_bytes(buffer.data(), buffer.size());
+            uint64_t checksum = hash.value();
+            out.write(buffer.data(), (streamsize)buffer.size());
+            out.write((const char *)&checksum, sizeof(checksum));
+            if (!out)
+                return false;
+        }
+        return rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    string buffer;
+};
+
+/**
+ * @brief Read a checkpoint saved by checkpoint_writer, in the same order it was written
+ *
+ */
+class checkpoint_reader
+{
+public:
+    /**
+     * @brief Read a whole checkpoint file and check its checksum
+     *
+     * @param _path The path of the checkpoint file
+     */
+    explicit checkpoint_reader(const string &_path) : path(_path)
+    {
+        ifstream in(path, ios::binary);
+        if (!in.is_open())
+            return;
+        found = true;
+        stringstream contents;
+        contents << in.rdbuf();
+        buffer = contents.str();
+        if (buffer.size() < sizeof(uint64_t))
+            throw checkpoint_invalidation::checkpoint_error(path);
+        uint64_t checksum;
+        buffer.copy((char *)&checksum, sizeof(checksum), buffer.size() - sizeof(checksum));
+        buffer.resize(buffer.size() - sizeof(checksum));
+        fnv_hash hash;
+        hash.mix_bytes(buffer.data(), buffer.size());
+        if (hash.value() != checksum)
+            throw checkpoint_invalidation::checkpoint_error(path);
+    }
+
+    /**
+     * @brief Check if the checkpoint file exists
+     *
+     * @return True or False whether there is a checkpoint to resume from
+     */
+    bool exists() const
+    {
+        return found;
+    }
+
+    /**
+     * @brief Read a whole number
+     *
+     * @return The number
+     */
+    uint64_t get()
+    {
+        if (buffer.size() - position < sizeof(uint64_t))
+            throw checkpoint_invalidation::checkpoint_error(path);
+        uint64_t value;
+        buffer.copy((char *)&value, sizeof(value), position);
+        position += sizeof(value);
+        return value;
+    }
+
+    /**
+     * @brief Read a string
+     *
+     * @return The string
+     */
+    string get_string()
+    {
+        uint64_t length = get();
+        if (length > buffer.size() - position)
+            throw checkpoint_invalidation::checkpoint_error(path);
+        string value = buffer.substr(position, length);
+        position += length;
+        return value;
+    }
+
+    /**
+     * @brief Read a list of whole numbers
+     *
+     * @return The list
+     */
+    vector<uint64_t> get_vector()
+    {
+        uint64_t length = get();
+        if (length > (buffer.size() - position) / sizeof(uint64_t))
+            throw checkpoint_invalidation::checkpoint_error(path);
+        vector<uint64_t> values(length);
+        for (uint64_t &value : values)
+            value = get();
+        return values;
+    }
+
+    /**
+     * @brief Fail with an error naming this checkpoint file
+     *
+     */
+    [[noreturn]] void reject() const
+    {
+        throw checkpoint_invalidation::checkpoint_error(path);
+    }
+
+private:
+    string path;
+    string buffer;
+    uint64_t position = 0;
+    bool found = false;
+};
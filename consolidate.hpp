@@ -0,0 +1,230 @@
+/**
+ * @file consolidate.hpp
+ * @author Cassandra Masschelein
+ * @brief Define a consolidation stage that merges parcels going between the same cities into shipments, so that the schedulers load
+ * a few shipments instead of many small parcels
+ * @version 0.1
+ * @date 2022-04-30
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "schedule.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
+
+using namespace std;
+
+/**
+ * @brief The parcels of a schedule merged into shipments. Parcels with the same source city, destination city, and delivery window
+ * are added to the same shipment in the order they were read, until the next parcel would take the shipment past its size limit in
+ * some capacity dimension, and then a new shipment is started. The size limit is a share of the median capacity of the trucks in each
+ * dimension that limits trucks, so a shipment fits a typical truck several times over. A parcel larger than the limit is a shipment
+ * of its own. A shipment is a parcel with the total load of its parcels, so it is loaded, routed, and timed exactly as its parcels
+ * would be if they were all loaded onto the same truck
+ *
+ */
+class parcel_consolidation
+{
+public:
+    /**
+     * @brief Construct a new parcel consolidation object, merging the parcels into shipments
+     *
+     * @param _parcel_list The parcels to be merged, which must outlive the consolidation
+     * @param truck_list The trucks the shipments are sized for
+     * @param shipment_percent The size limit of a shipment, as a percentage of the median truck capacity
+     */
+    parcel_consolidation(const item_span<const parcels> &_parcel_list, const item_span<const trucks> &truck_list, const uint64_t &shipment_percent) : parcel_list(_parcel_list)
+    {
+        PROFILE_SCOPE("consolidate/shipments");
+        load_vector limit = shipment_limit(truck_list, shipment_percent);
+
+        /* The shipment still being filled for each pair of cities and window, by the index of its first parcel. */
+        unordered_map<string, uint64_t> open_shipment;
+        vector<uint64_t> shipment_of(parcel_list.size());
+        vector<load_vector> shipment_load;
+        vector<uint64_t> first_parcel;
+        string key;
+        for (uint64_t i = 0; i < parcel_list.size(); i++)
+        {
+            const parcels &parcel = parcel_list[i];
+            key = parcel.where_from();
+            key += '\n';
+            key += parcel.where_to();
+            key += '\n';
+            key += to_string(parcel.window().earliest) + "," + to_string(parcel.window().latest);
+            auto found = open_shipment.find(key);
+            if (found != open_shipment.end())
+            {
+                load_vector merged = shipment_load[found->second];
+                for (uint64_t d = 0; d < capacity_dimensions; d++)
+                    merged[d] += parcel.load()[d];
+                if (fits(merged, limit))
+                {
+                    shipment_load[found->second] = merged;
+                    shipment_of[i] = found->second;
+                    continue;
+                }
+            }
+            shipment_of[i] = first_parcel.size();
+            open_shipment[key] = first_parcel.size();
+            first_parcel.push_back(i);
+            shipment_load.push_back(parcel.load());
+        }
+
+        /* List the parcels of each shipment together, in the order they were read. */
+        offsets.assign(first_parcel.size() + 1, 0);
+        for (const uint64_t &s : shipment_of)
+            offsets[s + 1]++;
+        for (uint64_t s = 0; s < first_parcel.size(); s++)
+            offsets[s + 1] += offsets[s];
+        members.resize(parcel_list.size());
+        vector<uint64_t> next = offsets;
+        for (uint64_t i = 0; i < parcel_list.size(); i++)
+            members[next[shipment_of[i]]++] = i;
+
+        /* A shipment takes the place of its parcels, its ID is its index among the shipments. */
+        shipments.reserve(first_parcel.size());
+        for (uint64_t s = 0; s < first_parcel.size(); s++)
+        {
+            const parcels &first = parcel_list[first_parcel[s]];
+            shipments.emplace_back(s, shipment_load[s], first.where_from(), first.where_to(), first.window());
+        }
+    }
+
+    /**
+     * @brief The shipments, to be scheduled in place of the parcels
+     *
+     * @return The shipments
+     */
+    const vector<parcels> &shipment_list() const
+    {
+        return shipments;
+    }
+
+    /**
+     * @brief Replace the shipments loaded on trucks with the IDs of their parcels, so each truck lists every parcel it carries
+     *
+     * @param truck_list The scheduled trucks
+     * @param loaded_before The number of parcels each truck carried before the shipments were scheduled, the IDs after these are shipments
+     */
+    void expand_trucks(const item_span<trucks> &truck_list, const vector<uint64_t> &loaded_before) const
+    {
+        for (uint64_t t = 0; t < truck_list.size(); t++)
+        {
+            vector<uint64_t> &loaded = truck_list[t].parcels_list;
+            vector<uint64_t> shipment_ids(loaded.begin() + (int64_t)loaded_before[t], loaded.end());
+            loaded.resize(loaded_before[t]);
+            for (const uint64_t &s : shipment_ids)
+            {
+                for (uint64_t k = offsets[s]; k < offsets[s + 1]; k++)
+                    loaded.push_back(parcel_list[members[k]].this_id());
+            }
+        }
+    }
+
+    /**
+     * @brief Find the parcels of shipments that could not be loaded
+     *
+     * @param unpacked The shipments that could not be loaded
+     * @return Their parcels, shipment by shipment
+     */
+    vector<parcels> expand_unpacked(const vector<parcels> &unpacked) const
+    {
+        vector<parcels> unpacked_parcels;
+        for (const parcels &shipment : unpacked)
+        {
+            for (uint64_t k = offsets[shipment.this_id()]; k < offsets[shipment.this_id() + 1]; k++)
+                unpacked_parcels.push_back(parcel_list[members[k]]);
+        }
+        return unpacked_parcels;
+    }
+
+private:
+    /**
+     * @brief Find the size limit of a shipment, a share of the median truck capacity in each dimension that limits every truck
+     *
+     * @param truck_list The trucks
+     * @param shipment_percent The share, as a percentage
+     * @return The size limit, unlimited in the dimensions some truck is not limited in
+     */
+    static load_vector shipment_limit(const item_span<const trucks> &truck_list, const uint64_t &shipment_percent)
+    {
+        load_vector limit;
+        limit.fill(unlimited_capacity);
+        for (uint64_t d = 0; d < capacity_dimensions; d++)
+        {
+            vector<uint64_t> capacities;
+            for (const trucks &truck : truck_list)
+            {
+                if (truck.limits()[d] != unlimited_capacity)
+                    capacities.push_back(truck.limits()[d]);
+            }
+            if (capacities.empty() or capacities.size() != truck_list.size())
+                continue;
+            nth_element(capacities.begin(), capacities.begin() + (int64_t)capacities.size() / 2, capacities.end());
+            uint64_t median = capacities[capacities.size() / 2];
+            limit[d] = median / 100 * shipment_percent + median % 100 * shipment_percent / 100; // The share of the median without overflowing
+        }
+        return limit;
+    }
+
+    /**
+     * @brief The parcels that were merged
+     *
+     */
+    item_span<const parcels> parcel_list;
+    /**
+     * @brief The shipments, and the indices of the parcels of each shipment as offsets into one array
+     *
+     */
+    vector<parcels> shipments;
+    vector<uint64_t> offsets;
+    vector<uint64_t> members;
+};
+
+/**
+ * @brief Schedule parcels merged into shipments. The shipments are scheduled first, then each truck lists the parcels of the
+ * shipments it was given, and the parcels of the shipments that did not fit anywhere are scheduled one by one into the room that is
+ * left. Every truck manifest lists parcel IDs, never shipments
+ *
+ * @tparam scheduler_type The scheduler used for every depot
+ * @param parcel_list The list of parcels to be loaded on trucks and delivered
+ * @param truck_list The list of trucks available for delivering parcels, each with its own depot
+ * @param dmap The distance map
+ * @param pool The thread pool that runs the depot tasks
+ * @param shipment_percent The size limit of a shipment, as a percentage of the median truck capacity
+ * @param deadline The time by which scheduling must stop, no limit by default
+ * @param checkpoints Where and how often to save checkpoints, the shipments save to the path followed by .shipments and the parcels scheduled one by one to the path followed by .parcels
+ * @param pickup_delivery Pick each parcel up at its source city instead of loading every parcel at the depot
+ * @return A list of parcels that could not get loaded on trucks
+ */
+template <class scheduler_type>
+vector<parcels> schedule_consolidated(const item_span<const parcels> &parcel_list, const item_span<trucks> &truck_list, const distanceMap &dmap, thread_pool &pool, const uint64_t &shipment_percent, const chrono::steady_clock::time_point &deadline = chrono::steady_clock::time_point::max(), const checkpoint_spec &checkpoints = checkpoint_spec(), const bool &pickup_delivery = false)
+{
+    parcel_consolidation consolidation(parcel_list, truck_list, shipment_percent);
+    vector<uint64_t> loaded_before(truck_list.size());
+    for (uint64_t t = 0; t < truck_list.size(); t++)
+        loaded_before[t] = truck_list[t].parcels_list.size();
+    auto checkpoints_for = [&checkpoints](const string &stage) {
+        checkpoint_spec spec = checkpoints;
+        if (not spec.path.empty())
+            spec.path += "." + stage;
+        return spec;
+    };
+    vector<parcels> unpacked_shipments = schedule_depots<scheduler_type>(consolidation.shipment_list(), truck_list, dmap, pool, deadline, checkpoints_for("shipments"), pickup_delivery);
+    consolidation.expand_trucks(truck_list, loaded_before);
+    vector<parcels> loose_parcels = consolidation.expand_unpacked(unpacked_shipments);
+    if (loose_parcels.empty())
+        return loose_parcels;
+    return schedule_depots<scheduler_type>(loose_parcels, truck_list, dmap, pool, deadline, checkpoints_for("parcels"), pickup_delivery);
+}
@@ -0,0 +1,408 @@
+/**
+ * @file decompress.hpp
+ * @author Cassandra Masschelein
+ * @brief Define a stream that reads gzip and zstd compressed data files, decompressing them on a second thread while the data is parsed
+ * @version 0.1
+ * @date 2022-04-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "profile.hpp"
+#include <iostream>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstring>
+#ifdef FEDEX_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FEDEX_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief The ways a data file can be compressed, found from the first bytes of the file
+ *
+ */
+enum class compression
+{
+    none,
+    gzip,
+    zstd
+};
+
+/**
+ * @brief Find how a file is compressed from its first bytes, so that a compressed file is read the same way whatever it is named
+ *
+ * @param path The path of the file
+ * @return The compression of the file, none if it cannot be opened or is not compressed
+ */
+compression compression_of(const string &path)
+{
+    ifstream file(path, ios::binary);
+    unsigned char magic[4] = {0, 0, 0, 0};
+    file.read((char *)magic, sizeof(magic));
+    if (file.gcount() >= 2 and magic[0] == 0x1f and magic[1] == 0x8b)
+        return compression::gzip;
+    if (file.gcount() == 4 and magic[0] == 0x28 and magic[1] == 0xb5 and magic[2] == 0x2f and magic[3] == 0xfd)
+        return compression::zstd;
+    return compression::none;
+}
+
+/**
+ * @brief Decompresses gzip data, including files made of several gzip members one after another
+ *
+ */
+class gzip_decoder
+{
+public:
+#ifdef FEDEX_ZLIB
+    static constexpr bool available = true;
+
+    gzip_decoder()
+    {
+        memset(&z, 0, sizeof(z));
+        if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK)
+            throw invalid_argument("The gzip decoder could not be started!");
+    }
+
+    ~gzip_decoder()
+    {
+        inflateEnd(&z);
+    }
+
+    gzip_decoder(const gzip_decoder &) = delete;
+    gzip_decoder &operator=(const gzip_decoder &) = delete;
+
+    /**
+     * @brief Decompress as much input as there is room for in the output
+     *
+     * @param in The next compressed byte, moved past the bytes used
+     * @param in_left The number of compressed bytes, reduced by the bytes used
+     * @param out Where the next decompressed byte goes, moved past the bytes written
+     * @param out_left The room left for decompressed bytes, reduced by the bytes written
+     */
+    void decode(const char *&in, uint64_t &in_left, char *&out, uint64_t &out_left)
+    {
+        if (member_done and in_left != 0) // Another gzip member follows the one that ended
+        {
+            inflateReset(&z);
+            member_done = false;
+        }
+        z.next_in = (Bytef *)in;
+        z.avail_in = (uInt)in_left;
+        z.next_out = (Bytef *)out;
+        z.avail_out = (uInt)out_left;
+        int status = inflate(&z, Z_NO_FLUSH);
+        if (status != Z_OK and status != Z_STREAM_END and status != Z_BUF_ERROR)
+            throw invalid_argument(z.msg ? z.msg : "damaged gzip data");
+        member_done = status == Z_STREAM_END;
+        in += in_left - z.avail_in;
+        in_left = z.avail_in;
+        out += out_left - z.avail_out;
+        out_left = z.avail_out;
+    }
+
+    /**
+     * @brief Check if the data ended at the end of a gzip member rather than part way through one
+     *
+     * @return True or False whether the last member is complete
+     */
+    bool complete() const
+    {
+        return member_done;
+    }
+
+private:
+    z_stream z;
+    bool member_done = false;
+#else
+    static constexpr bool available = false; // Compile with -DFEDEX_ZLIB and link with -lz to read gzip files
+
+    void decode(const char *&, uint64_t &, char *&, uint64_t &) {}
+
+    bool complete() const
+    {
+        return true;
+    }
+#endif
+};
+
+/**
+ * @brief Decompresses zstd data, including files made of several zstd frames one after another
+ *
+ */
+class zstd_decoder
+{
+public:
+#ifdef FEDEX_ZSTD
+    static constexpr bool available = true;
+
+    zstd_decoder() : stream(ZSTD_createDStream())
+    {
+        if (not stream or ZSTD_isError(ZSTD_initDStream(stream)))
+            throw invalid_argument("The zstd decoder could not be started!");
+    }
+
+    ~zstd_decoder()
+    {
+        ZSTD_freeDStream(stream);
+    }
+
+    zstd_decoder(const zstd_decoder &) = delete;
+    zstd_decoder &operator=(const zstd_decoder &) = delete;
+
+    /**
+     * @brief Decompress as much input as there is room for in the output
+     *
+     * @param in The next compressed byte, moved past the bytes used
+     * @param in_left The number of compressed bytes, reduced by the bytes used
+     * @param out Where the next decompressed byte goes, moved past the bytes written
+     * @param out_left The room left for decompressed bytes, reduced by the bytes written
+     */
+    void decode(const char *&in, uint64_t &in_left, char *&out, uint64_t &out_left)
+    {
+        ZSTD_inBuffer input = {in, in_left, 0};
+        ZSTD_outBuffer output = {out, out_left, 0};
+        size_t status = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(status))
+            throw invalid_argument(ZSTD_getErrorName(status));
+        frame_done = status == 0;
+        in += input.pos;
+        in_left -= input.pos;
+        out += output.pos;
+        out_left -= output.pos;
+    }
+
+    /**
+     * @brief Check if the data ended at the end of a zstd frame rather than part way through one
+     *
+     * @return True or False whether the last frame is complete
+     */
+    bool complete() const
+    {
+        return frame_done;
+    }
+
+private:
+    ZSTD_DStream *stream;
+    bool frame_done = false;
+#else
+    static constexpr bool available = false; // Compile with -DFEDEX_ZSTD and link with -lzstd to read zstd files
+
+    void decode(const char *&, uint64_t &, char *&, uint64_t &) {}
+
+    bool complete() const
+    {
+        return true;
+    }
+#endif
+};
+
+/**
+ * @brief A stream buffer over a compressed file. A second thread reads the file and decompresses it into blocks while the blocks
+ * decompressed before are parsed, so reading, decompressing, and parsing overlap. Only a few blocks wait at a time, and their memory
+ * is reused once they have been parsed
+ *
+ */
+class decompressing_buffer : public streambuf
+{
+public:
+    /**
+     * @brief Construct a new decompressing buffer object and start decompressing the file
+     *
+     * @param path The path of the compressed file, which must exist
+     * @param _kind How the file is compressed, with a decoder that is available
+     * @param _block_bytes The size of each decompressed block
+     * @param _max_blocks The most decompressed blocks that wait to be parsed
+     */
+    decompressing_buffer(const string &path, const compression &_kind, const uint64_t &_block_bytes = 1 << 20, const uint64_t &_max_blocks = 4)
+        : file(path, ios::binary), kind(_kind), block_bytes(max<uint64_t>(_block_bytes, 1)), max_blocks(max<uint64_t>(_max_blocks, 1))
+    {
+        worker = thread([this] { produce(); });
+    }
+
+    ~decompressing_buffer()
+    {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+
+    /**
+     * @brief Why the file could not be decompressed
+     *
+     * @return The reason, empty if every block so far was decompressed
+     */
+    string error() const
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        return failure;
+    }
+
+protected:
+    /**
+     * @brief Move on to the next decompressed block once the parser has read the current one, waiting for it if needed
+     *
+     * @return The next character, or the end of the file once every block has been read or decompressing failed
+     */
+    int_type underflow() override
+    {
+        unique_lock<mutex> lock(queue_mutex);
+        if (not current.empty())
+            spare.push_back(move(current)); // The parser is done with the current block
+        current.clear();
+        changed.wait(lock, [this] { return not ready.empty() or finished; });
+        if (ready.empty())
+            return traits_type::eof();
+        current = move(ready.front());
+        ready.pop_front();
+        changed.notify_all();
+        setg(current.data(), current.data(), current.data() + current.size());
+        return traits_type::to_int_type(current[0]);
+    }
+
+private:
+    /**
+     * @brief Decompress the file with the decoder for its compression, and tell the parser when it is done
+     *
+     */
+    void produce()
+    {
+        PROFILE_SCOPE("parse/decompress");
+        string reason;
+        try
+        {
+            if (kind == compression::gzip)
+                reason = decompress<gzip_decoder>();
+            else
+                reason = decompress<zstd_decoder>();
+        }
+        catch (const invalid_argument &ex)
+        {
+            reason = ex.what();
+        }
+        lock_guard<mutex> lock(queue_mutex);
+        failure = reason;
+        finished = true;
+        changed.notify_all();
+    }
+
+    /**
+     * @brief Read and decompress the file one block at a time, until the file ends or the buffer is destroyed
+     *
+     * @tparam decoder The decompressor, gzip_decoder or zstd_decoder
+     * @return Why the file could not be decompressed, empty if it was
+     */
+    template <class decoder>
+    string decompress()
+    {
+        decoder codec;
+        vector<char> input(1 << 18);
+        const char *in = input.data();
+        uint64_t in_left = 0;
+        vector<char> block = take_spare();
+        while (true)
+        {
+            if (in_left == 0)
+            {
+                file.read(input.data(), (streamsize)input.size());
+                in = input.data();
+                in_left = (uint64_t)file.gcount();
+            }
+            if (in_left == 0) // The whole file has been decompressed
+                break;
+            uint64_t filled = block.size();
+            block.resize(block_bytes);
+            char *out = block.data() + filled;
+            uint64_t out_left = block_bytes - filled;
+            codec.decode(in, in_left, out, out_left);
+            block.resize(block_bytes - out_left);
+            if (block.size() == block_bytes)
+            {
+                if (not give(move(block)))
+                    return "";
+                block = take_spare();
+            }
+        }
+        if (not block.empty() and not give(move(block)))
+            return "";
+        return codec.complete() ? "" : "The compressed data ends part way through!";
+    }
+
+    /**
+     * @brief Take an empty block, reusing one the parser is done with if there is one
+     *
+     * @return The empty block
+     */
+    vector<char> take_spare()
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        vector<char> block;
+        if (not spare.empty())
+        {
+            block = move(spare.back());
+            spare.pop_back();
+        }
+        block.clear();
+        block.reserve(block_bytes);
+        return block;
+    }
+
+    /**
+     * @brief Hand a decompressed block to the parser, waiting while too many blocks are waiting
+     *
+     * @param block The decompressed block
+     * @return True or False whether decompressing should go on, false once the buffer is being destroyed
+     */
+    bool give(vector<char> &&block)
+    {
+        unique_lock<mutex> lock(queue_mutex);
+        changed.wait(lock, [this] { return ready.size() < max_blocks or stopping; });
+        if (stopping)
+            return false;
+        ready.push_back(move(block));
+        changed.notify_all();
+        return true;
+    }
+
+    /**
+     * @brief The compressed file, how it is compressed, and the sizes of the decompressed blocks and of the queue of blocks
+     *
+     */
+    ifstream file;
+    compression kind;
+    uint64_t block_bytes, max_blocks;
+    /**
+     * @brief The block being parsed, the blocks waiting to be parsed, and the parsed blocks whose memory can be reused
+     *
+     */
+    vector<char> current;
+    deque<vector<char> > ready;
+    vector<vector<char> > spare;
+    /**
+     * @brief Guards the blocks and the state shared with the decompressing thread
+     *
+     */
+    mutable mutex queue_mutex;
+    condition_variable changed;
+    bool finished = false, stopping = false;
+    string failure;
+    thread worker;
+};
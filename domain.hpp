@@ -19,6 +19,17 @@
 #include <cmath>
 #include <stdexcept>
 #include <iomanip>
+#include <unordered_map>
+#include <set>
+#include <fstream>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <array>
+#include "thread_pool.hpp"
+#include "lru_cache.hpp"
+#include <memory>
+#include "profile.hpp"
 
 using namespace std;
 
@@ -79,236 +90,1255 @@ namespace fleet_invalidation
 }
 
 /**
- * @brief A parcel that needs to be delivered. A parcel has an ID, a volume, a source city, and a destination city
+ * @brief The dimensions that parcels take up room in and trucks have a limit in
+ * 
+ */
+enum class capacity_dimension
+{
+    volume,  // Volume (in cm^3)
+    weight,  // Weight (in kg)
+    pallets, // Pallet slots
+    num_dimensions
+};
+
+/**
+ * @brief The number of capacity dimensions, and their names in the same order as capacity_dimension
+ * 
+ */
+const uint64_t capacity_dimensions = (uint64_t)capacity_dimension::num_dimensions;
+const char *const capacity_dimension_names[] = {"Volume", "Weight", "Pallet Slots"};
+
+/**
+ * @brief The limit of a truck in a dimension it is not limited in
+ * 
+ */
+const uint64_t unlimited_capacity = numeric_limits<uint64_t>::max();
+
+/**
+ * @brief An amount in every capacity dimension
+ * 
+ */
+using load_vector = array<uint64_t, capacity_dimensions>;
+
+/**
+ * @brief Check if a load fits in the room that is left in every dimension. The dimensions are compared without
+ * branching so that the compiler can check them together
+ * 
+ * @param load The load of a parcel
+ * @param room The room left on a truck
+ * @return True or False whether the load fits
+ */
+bool fits(const load_vector &load, const load_vector &room)
+{
+    bool fit = true;
+    for (uint64_t i = 0; i < capacity_dimensions; i++)
+        fit &= load[i] <= room[i];
+    return fit;
+}
+
+/**
+ * @brief A view of items that are stored somewhere else, such as in a vector or an array owned by a program that embeds the
+ * scheduler. The items are used where they are and never copied
+ *
+ * @tparam item_type The type of the items, const if they may only be read
+ */
+template <class item_type>
+class item_span
+{
+public:
+    /**
+     * @brief Construct an empty item span object
+     *
+     */
+    item_span() : items(nullptr), count(0) {}
+
+    /**
+     * @brief Construct a new item span object over an array
+     *
+     * @param _items The first item
+     * @param _count The number of items
+     */
+    item_span(item_type *_items, const uint64_t &_count) : items(_items), count(_count) {}
+
+    /**
+     * @brief Construct a new item span object over every item of a vector
+     *
+     * @param list The vector, which must not grow or shrink while the span is used
+     */
+    template <class stored_type>
+    item_span(vector<stored_type> &list) : items(list.data()), count(list.size()) {}
+
+    /**
+     * @brief Construct a new item span object that may only read every item of a vector
+     *
+     * @param list The vector, which must not grow or shrink while the span is used
+     */
+    template <class stored_type>
+    item_span(const vector<stored_type> &list) : items(list.data()), count(list.size()) {}
+
+    /**
+     * @brief Construct a new item span object over the same items as another span, such as a span that may only read them
+     *
+     * @param other The other span
+     */
+    template <class other_type>
+    item_span(const item_span<other_type> &other) : items(other.data()), count(other.size()) {}
+
+    item_type &operator[](const uint64_t &index) const
+    {
+        return items[index];
+    }
+
+    item_type *data() const
+    {
+        return items;
+    }
+
+    uint64_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    item_type *begin() const
+    {
+        return items;
+    }
+
+    item_type *end() const
+    {
+        return items + count;
+    }
+
+    item_type &back() const
+    {
+        return items[count - 1];
+    }
+
+private:
+    item_type *items;
+    uint64_t count;
+};
+
+/**
+ * @brief A time that is never reached, used for windows that never close and trucks without a shift limit
+ * 
+ */
+const uint64_t unlimited_time = numeric_limits<uint64_t>::max();
+
+/**
+ * @brief The times between which a delivery may start, in minutes from the start of the trucks shift
+ * 
+ */
+struct time_window
+{
+    uint64_t earliest = 0;            // The delivery may not start before this time
+    uint64_t latest = unlimited_time; // The delivery must start by this time
+
+    /**
+     * @brief Check if this window allows a delivery at any time
+     * 
+     * @return True or False whether the window never constrains a delivery
+     */
+    bool unconstrained() const
+    {
+        return earliest == 0 and latest == unlimited_time;
+    }
+};
+
+/**
+ * @brief The timing of one stop on a trucks route, in minutes from the start of the trucks shift
+ * 
+ */
+struct stop_time
+{
+    uint64_t arrival;   // When the truck arrives at the stop
+    uint64_t start;     // When the delivery starts, after waiting for the window to open
+    time_window window; // The window shared by every parcel delivered at the stop
+    uint64_t slack;     // How long the start of this stop can be delayed without breaking its own window or a later window
+    uint64_t waited;    // The time spent waiting for windows to open at this stop and every stop before it
+    uint64_t head_slack; // How long leaving the depot can be delayed without this stop or a stop before it missing its window
+};
+
+/**
+ * @brief A parcel that needs to be delivered. A parcel has an ID, a volume, a source city, a destination city, and optionally a delivery time window
  * 
  */
 class parcels
 {
     friend class trucks;
 
-public:
+public:
+    /**
+     * @brief Construct a new parcels object
+     * 
+     * @param this_id The parcels ID
+     * @param _vol The parcels volume
+     * @param _source_city The parcels source city
+     * @param _dest The parcels destination city
+     */
+    parcels(const uint64_t &this_id, const uint64_t &_vol, const string &_source_city, const string &_dest) : parcels(this_id, load_vector{_vol, 0, 0}, _source_city, _dest) {}
+
+    /**
+     * @brief Construct a new parcels object that takes up room in several capacity dimensions
+     * 
+     * @param this_id The parcels ID
+     * @param _load The room the parcel takes up in each capacity dimension
+     * @param _source_city The parcels source city
+     * @param _dest The parcels destination city
+     * @param _window The times between which the parcel may be delivered, any time by default
+     */
+    parcels(const uint64_t &this_id, const load_vector &_load, const string &_source_city, const string &_dest, const time_window &_window = time_window()) : p_id(this_id), p_load(_load), source_city(_source_city), dest_city(_dest), p_window(_window)
+    {
+        /* A parcels source city and destination city cannot be the same. */
+        if (source_city == dest_city)
+            throw map_invalidation::city_error();
+    }
+
+    /**
+     * @brief Return the volume of a parcel
+     * 
+     * @return The volume in cm^3
+     */
+    uint64_t volume() const
+    {
+        return p_load[(uint64_t)capacity_dimension::volume];
+    }
+
+    /**
+     * @brief Return the room a parcel takes up in every capacity dimension
+     * 
+     * @return The volume, weight, and pallet slots of the parcel
+     */
+    const load_vector &load() const
+    {
+        return p_load;
+    }
+
+    /**
+     * @brief Return the times between which the parcel may be delivered
+     * 
+     * @return The delivery time window
+     */
+    const time_window &window() const
+    {
+        return p_window;
+    }
+
+    /**
+     * @brief Return the parcels unique ID
+     * 
+     * @return The parcels ID value
+     */
+    uint64_t this_id() const
+    {
+        return p_id;
+    }
+
+    /**
+     * @brief Return the city where this parcel is being sent
+     * 
+     * @return The destination city 
+     */
+    string where_to() const
+    {
+        return dest_city;
+    }
+
+    /**
+     * @brief Return the city where this parcel is picked up
+     * 
+     * @return The source city 
+     */
+    string where_from() const
+    {
+        return source_city;
+    }
+
+private:
+    /**
+     * @brief The parcels ID
+     * 
+     */
+    uint64_t p_id;
+    /**
+     * @brief The room the parcel takes up in each capacity dimension
+     * 
+     */
+    load_vector p_load;
+    /**
+     * @brief The parcels source city and destination city respectively 
+     * 
+     */
+    string source_city, dest_city;
+    /**
+     * @brief The times between which the parcel may be delivered
+     * 
+     */
+    time_window p_window;
+};
+
+/**
+ * @brief A truck that will be used to deliver parcels. A truck has an id, a capacity in each capacity dimension, the room left on the truck, a depot where it starts from, a route, and a list of parcels
+ * 
+ */
+class trucks
+{
+    friend class fleet;
+
+public:
+    /**
+     * @brief Construct a new trucks object
+     * 
+     * @param _id The trucks ID
+     * @param _cap The trucks capacity
+     * @param _common_depot The trucks starting depot location
+     */
+    trucks(const uint64_t &_id, const uint64_t &_cap, const string &_common_depot) : trucks(_id, load_vector{_cap, unlimited_capacity, unlimited_capacity}, _common_depot) {}
+
+    /**
+     * @brief Construct a new trucks object that is limited in several capacity dimensions
+     * 
+     * @param _id The trucks ID
+     * @param _limits The trucks capacity in each capacity dimension, unlimited_capacity for a dimension it is not limited in
+     * @param _common_depot The trucks starting depot location
+     */
+    trucks(const uint64_t &_id, const load_vector &_limits, const string &_common_depot) : avail_load(_limits), t_id(_id), t_limits(_limits), depot(_common_depot)
+    {
+        route.push_back(depot); // Add the depot as the first stop on the route
+        parcels_list = vector<uint64_t>(0); // A list of parcels on this truck
+    }
+
+    load_vector avail_load; // Room available in a truck to fill with parcels, in each capacity dimension
+    vector<string> route; // The route that a given truck will take
+    vector<uint64_t> parcels_list; // The list of parcels (by ID) that are loaded onto this truck
+    vector<stop_time> timing; // The timing of each stop on the route, only kept when deliveries are scheduled in time
+    vector<load_vector> onboard; // The load carried when leaving each stop of the route, only kept for pickup-and-delivery routes
+
+    /**
+     * @brief Load a parcel onto a truck
+     * 
+     * @param parcel The parcel to potentially be loaded
+     * @return True or False whether that parcel was loaded
+     */
+    bool pack_truck(const parcels &parcel)
+    {
+        if (fits(parcel.p_load, avail_load)) // If the parcel will fit on the truck in every dimension, load it on the truck
+        {
+            parcels_list.push_back(parcel.p_id);
+            for (uint64_t i = 0; i < capacity_dimensions; i++)
+                avail_load[i] -= parcel.p_load[i];
+            if (find(route.begin(), route.end(), parcel.dest_city) == route.end()) // If the parcel destination is not in the route, add it to the end of the route
+                route.push_back(parcel.dest_city);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief The trucks capacity
+     * 
+     * @return The volume of the truck in cm^3 
+     */
+    uint64_t volume() const
+    {
+        return t_limits[(uint64_t)capacity_dimension::volume];
+    }
+
+    /**
+     * @brief The trucks capacity in every capacity dimension
+     * 
+     * @return The volume, weight, and pallet slot limits of the truck
+     */
+    const load_vector &limits() const
+    {
+        return t_limits;
+    }
+
+    /**
+     * @brief The volume available in a truck to fill with parcels
+     * 
+     * @return The free volume in cm^3
+     */
+    uint64_t avail_space() const
+    {
+        return avail_load[(uint64_t)capacity_dimension::volume];
+    }
+
+    /**
+     * @brief Return the trucks unique ID
+     * 
+     * @return The trucks ID
+     */
+    uint64_t my_id() const
+    {
+        return t_id;
+    }
+
+    /**
+     * @brief Return the depot that this truck starts its route from
+     * 
+     * @return The trucks depot city
+     */
+    const string &home_depot() const
+    {
+        return depot;
+    }
+
+    /**
+     * @brief The longest the trucks route may take, from leaving the depot to driving back to it after the last delivery
+     * 
+     * @return The shift limit in minutes, or unlimited_time if the truck has no shift limit
+     */
+    uint64_t max_duration() const
+    {
+        return t_max_duration;
+    }
+
+    /**
+     * @brief Limit how long the trucks route may take
+     * 
+     * @param minutes The shift limit in minutes, or unlimited_time for no shift limit
+     */
+    void set_max_duration(const uint64_t &minutes)
+    {
+        t_max_duration = minutes;
+    }
+
+    /**
+     * @brief The cost of sending this truck out at all, whatever its route
+     * 
+     * @return The dispatch cost (in cents)
+     */
+    uint64_t fixed_cost() const
+    {
+        return t_fixed_cost;
+    }
+
+    /**
+     * @brief The cost of each km this truck drives
+     * 
+     * @return The cost per km (in cents)
+     */
+    uint64_t km_cost() const
+    {
+        return t_km_cost;
+    }
+
+    /**
+     * @brief Set the cost of running this truck
+     * 
+     * @param fixed The dispatch cost (in cents)
+     * @param per_km The cost per km (in cents)
+     */
+    void set_costs(const uint64_t &fixed, const uint64_t &per_km)
+    {
+        t_fixed_cost = fixed;
+        t_km_cost = per_km;
+    }
+
+    /**
+     * @brief A function that returns the capacity that has been used for a given truck
+     * 
+     * @param dimension The capacity dimension, volume by default
+     * @return The percentage of used space, or 0 if the truck is not limited in this dimension
+     */
+    double capacity_used(const capacity_dimension &dimension = capacity_dimension::volume) const
+    {
+        uint64_t i = (uint64_t)dimension;
+        if (t_limits[i] == unlimited_capacity)
+            return 0.0;
+        double percentage = (double)avail_load[i] / (double)t_limits[i];
+        return 100.0 - (percentage * 100.0);
+    }
+
+private:
+    /**
+     * @brief The trucks unique ID
+     * 
+     */
+    uint64_t t_id;
+    /**
+     * @brief The trucks capacity in each capacity dimension
+     * 
+     */
+    load_vector t_limits;
+    /**
+     * @brief The trucks starting location
+     * 
+     */
+    string depot;
+    /**
+     * @brief The longest the trucks route may take in minutes
+     * 
+     */
+    uint64_t t_max_duration = unlimited_time;
+    /**
+     * @brief The dispatch cost and the cost per km of the truck in cents, a truck without costs costs nothing to run
+     * 
+     */
+    uint64_t t_fixed_cost = 0, t_km_cost = 0;
+};
+
+/**
+ * @brief A hash that is updated one whole number at a time (64 bit FNV-1a)
+ *
+ */
+class fnv_hash
+{
+public:
+    /**
+     * @brief Add a number to the hash
+     *
+     * @param value The number
+     */
+    void mix(const uint64_t &value)
+    {
+        for (uint64_t byte = 0; byte < 8; byte++)
+        {
+            hash ^= (value >> (8 * byte)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    /**
+     * @brief Add every character of a string to the hash
+     *
+     * @param value The string
+     */
+    void mix(const string &value)
+    {
+        mix(value.size());
+        mix_bytes(value.data(), value.size());
+    }
+
+    /**
+     * @brief Add a block of bytes to the hash
+     *
+     * @param data The first byte
+     * @param size The number of bytes
+     */
+    void mix_bytes(const char *data, const uint64_t &size)
+    {
+        for (uint64_t i = 0; i < size; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    /**
+     * @brief The hash of everything added so far
+     *
+     * @return The hash value
+     */
+    uint64_t value() const
+    {
+        return hash;
+    }
+
+private:
+    uint64_t hash = 1469598103934665603ULL;
+};
+
+/**
+ * @brief A map that stores the distances between cities for all cities where parcels must be delivered.
+ * The map is given as a road graph that does not need an entry for every pair of cities, and the complete
+ * matrix of shortest distances is computed from it the first time a distance is needed. Maps that are too
+ * large for a complete matrix can instead compute each distance when it is first asked for and keep the
+ * recently used distances in a bounded cache
+ * 
+ */
+class distanceMap
+{
+    friend class fleet;
+
+public:
+    /**
+     * @brief Construct a new distance Map object
+     * 
+     */
+    distanceMap() {}
+
+    /**
+     * @brief Construct a copy of a distance Map object
+     * 
+     * @param other The distance map to copy
+     */
+    distanceMap(const distanceMap &other) : city_index(other.city_index), city_names(other.city_names), roads(other.roads), road_set(other.road_set), matrix(other.matrix), completed(other.completed.load())
+    {
+        if (other.cache)
+            use_lazy_distances(other.cache->capacity(), other.cache->shard_count());
+    }
+
+    /**
+     * @brief Copy another distance Map object into this one
+     * 
+     * @param other The distance map to copy
+     * @return This distance map
+     */
+    distanceMap &operator=(const distanceMap &other)
+    {
+        city_index = other.city_index;
+        city_names = other.city_names;
+        roads = other.roads;
+        road_set = other.road_set;
+        matrix = other.matrix;
+        replicas.clear();
+        completed = other.completed.load();
+        adjacency_built = false;
+        cache.reset();
+        if (other.cache)
+            use_lazy_distances(other.cache->capacity(), other.cache->shard_count());
+        return *this;
+    }
+
+    /**
+     * @brief Add the distance between two cities to the distance map. The road can be travelled in both directions
+     * 
+     * @param city_1 The first city
+     * @param city_2 The second city
+     * @param distance The distance between the cities in km
+     */
+    void add_distance(const string &city_1, const string &city_2, const uint64_t &distance)
+    {
+        uint32_t a = add_city(city_1), b = add_city(city_2);
+        if (road_set.insert({a, b}).second) // Only the first entry for a pair of cities is used
+        {
+            roads.push_back({a, b, distance});
+            replicas.clear();
+            completed = false;
+            adjacency_built = false;
+            if (cache) // A new road can shorten distances that were already looked up, or connect cities that were unreachable
+                cache->clear();
+        }
+    }
+
+    /**
+     * @brief Find the distance between two given cities (in km)
+     * 
+     * @param city_1 The source city
+     * @param city_2 The destination city
+     * @return The distance between the two cities (in km)
+     */
+    uint64_t distance(const string &city_1, const string &city_2) const
+    {
+        PROFILE_COUNT(distance_lookups, 1);
+        auto a = city_index.find(city_1), b = city_index.find(city_2);
+        if (a == city_index.end() or b == city_index.end())
+            throw map_invalidation::map_error();
+        return distance(a->second, b->second);
+    }
+
+    /**
+     * @brief Find the distance between two cities by their index in this map (in km)
+     * 
+     * @param city_1 The index of the source city
+     * @param city_2 The index of the destination city
+     * @return The distance between the two cities (in km)
+     */
+    uint64_t distance(const uint32_t &city_1, const uint32_t &city_2) const
+    {
+        if (cache)
+            return lazy_distance(city_1, city_2);
+        if (not completed)
+            complete();
+        const uint64_t *distances = matrix.data();
+        if (not replicas.empty()) // Read the copy on the node of the calling thread
+        {
+            uint64_t node = thread_pool::current_node();
+            if (node < replicas.size() and not replicas[node].empty())
+                distances = replicas[node].data();
+            else
+                PROFILE_COUNT(remote_distance_lookups, 1);
+        }
+        uint64_t d = distances[(uint64_t)city_1 * city_names.size() + city_2];
+        if (d >= unreachable) // There is no road between the two cities
+            throw map_invalidation::map_error();
+        return d;
+    }
+
+    /**
+     * @brief Find the index of a city in this map
+     * 
+     * @param city The city name
+     * @return The index of the city
+     */
+    uint32_t city_id(const string &city) const
+    {
+        auto found = city_index.find(city);
+        if (found == city_index.end())
+            throw map_invalidation::map_error();
+        return found->second;
+    }
+
+    /**
+     * @brief The number of cities in this map
+     * 
+     * @return The number of cities
+     */
+    uint64_t number_of_cities() const
+    {
+        return city_names.size();
+    }
+
+    /**
+     * @brief Compute each distance from the road graph when it is first asked for instead of computing the complete matrix.
+     * The distances are kept in a bounded cache, so memory stays bounded for maps that are too large for a complete matrix
+     * 
+     * @param cache_entries The largest number of distances kept in the cache
+     * @param shards The number of independently locked parts of the cache
+     */
+    void use_lazy_distances(const uint64_t &cache_entries, const uint64_t &shards = 16)
+    {
+        cache = make_unique<lru_cache>(cache_entries, shards);
+        matrix.clear();
+        matrix.shrink_to_fit();
+        replicas.clear();
+        completed = false;
+    }
+
+    /**
+     * @brief Check if distances are computed when they are first asked for
+     * 
+     * @return True or False whether this map is in lazy mode
+     */
+    bool is_lazy() const
+    {
+        return (bool)cache;
+    }
+
+    /**
+     * @brief The number of lazy distance lookups that were found in the cache
+     * 
+     * @return The number of cache hits
+     */
+    uint64_t cache_hits() const
+    {
+        return cache ? cache->hit_count() : 0;
+    }
+
+    /**
+     * @brief The number of lazy distance lookups that had to be computed
+     * 
+     * @return The number of cache misses
+     */
+    uint64_t cache_misses() const
+    {
+        return cache ? cache->miss_count() : 0;
+    }
+
+    /**
+     * @brief Compute the shortest distance between every pair of cities. Dijkstra's algorithm is run from every city for sparse maps,
+     * and a blocked Floyd-Warshall algorithm is used for dense maps. This is done automatically the first time a distance is needed
+     * 
+     * @param pool An optional thread pool to compute the distances in parallel
+     */
+    void complete(thread_pool *pool = nullptr) const
+    {
+        lock_guard<mutex> lock(complete_mutex);
+        if (completed)
+            return;
+        uint64_t n = city_names.size();
+        matrix.assign(n * n, unreachable);
+        for (uint64_t i = 0; i < n; i++)
+            matrix[i * n + i] = 0;
+        /* Dijkstra from every city costs about n * roads * log(n), Floyd-Warshall costs n^3. */
+        uint64_t log_n = 1;
+        while ((1ULL << log_n) < n)
+            log_n++;
+        if (2 * roads.size() * log_n < n * n)
+            all_pairs_dijkstra(pool);
+        else
+            all_pairs_floyd_warshall(pool);
+        completed = true;
+    }
+
+    /**
+     * @brief Copy the complete distance matrix to every NUMA node of a thread pool, each copy made by a worker of its node so that
+     * its memory is placed there. Lookups by the workers of a node then read their own copy instead of reaching across to the node
+     * the matrix was computed on. Nothing is copied on a machine with one node or for a map in lazy mode, and the copies are dropped
+     * when the map changes
+     * 
+     * @param pool The thread pool whose nodes get a copy
+     */
+    void replicate(thread_pool &pool)
+    {
+        if (pool.nodes() < 2 or cache)
+            return;
+        complete(&pool);
+        replicas.assign(pool.nodes(), vector<uint64_t>());
+        pool.on_each_node([this](const uint64_t &node) { replicas[node] = matrix; });
+    }
+
+    /**
+     * @brief The number of NUMA nodes that have their own copy of the distance matrix
+     * 
+     * @return The number of copies, 0 if the matrix is not copied
+     */
+    uint64_t replica_count() const
+    {
+        uint64_t copies = 0;
+        for (const vector<uint64_t> &replica : replicas)
+            copies += not replica.empty();
+        return copies;
+    }
+
+    /**
+     * @brief Save the complete distance matrix to a binary file so that later runs on the same map can skip computing it
+     * 
+     * @param path The path of the binary matrix file
+     * @return True or False whether the file could be written
+     */
+    bool save_matrix(const string &path) const
+    {
+        if (not completed)
+            complete();
+        ofstream out(path, ios::binary);
+        if (!out.is_open())
+            return false;
+        uint64_t header[3] = {matrix_magic, city_names.size(), road_checksum()};
+        out.write((const char *)header, sizeof(header));
+        for (const string &name : city_names)
+        {
+            uint64_t length = name.size();
+            out.write((const char *)&length, sizeof(length));
+            out.write(name.data(), (streamsize)length);
+        }
+        fnv_hash hash;
+        hash.mix_bytes((const char *)matrix.data(), matrix.size() * sizeof(uint64_t));
+        uint64_t checksum = hash.value();
+        out.write((const char *)matrix.data(), (streamsize)(matrix.size() * sizeof(uint64_t)));
+        out.write((const char *)&checksum, sizeof(checksum));
+        return (bool)out;
+    }
+
+    /**
+     * @brief Load the complete distance matrix from a binary file, if the file was saved from the same map and is whole
+     * 
+     * @param path The path of the binary matrix file
+     * @return True or False whether the matrix was loaded
+     */
+    bool load_matrix(const string &path)
+    {
+        ifstream in(path, ios::binary);
+        if (!in.is_open())
+            return false;
+        uint64_t header[3];
+        in.read((char *)header, sizeof(header));
+        if (!in or header[0] != matrix_magic or header[1] != city_names.size() or header[2] != road_checksum())
+            return false;
+        for (const string &name : city_names)
+        {
+            uint64_t length;
+            in.read((char *)&length, sizeof(length));
+            if (!in or length != name.size()) // A corrupt length is never used to allocate
+                return false;
+            string stored(length, '\0');
+            in.read(&stored[0], (streamsize)stored.size());
+            if (!in or stored != name)
+                return false;
+        }
+        /* The distances are only used if they hash to the checksum after them, so a file that was cut short or torn is not trusted. */
+        vector<uint64_t> stored_matrix(city_names.size() * city_names.size());
+        uint64_t checksum;
+        in.read((char *)stored_matrix.data(), (streamsize)(stored_matrix.size() * sizeof(uint64_t)));
+        in.read((char *)&checksum, sizeof(checksum));
+        if (!in)
+            return false;
+        fnv_hash hash;
+        hash.mix_bytes((const char *)stored_matrix.data(), stored_matrix.size() * sizeof(uint64_t));
+        if (hash.value() != checksum)
+            return false;
+        lock_guard<mutex> lock(complete_mutex);
+        matrix = move(stored_matrix);
+        replicas.clear();
+        completed = true;
+        return true;
+    }
+
     /**
-     * @brief Construct a new parcels object
+     * @brief Print the distance map as a dictionary 
      * 
-     * @param this_id The parcels ID
-     * @param _vol The parcels volume
-     * @param _source_city The parcels source city
-     * @param _dest The parcels destination city
      */
-    parcels(const uint64_t &this_id, const uint64_t &_vol, const string &_source_city, const string &_dest) : p_id(this_id), p_vol(_vol), source_city(_source_city), dest_city(_dest)
+    void print_distance_map() const
     {
-        /* A parcels source city and destination city cannot be the same. */
-        if (source_city == dest_city)
-            throw map_invalidation::city_error();
+        vector<pair<pair<string, string>, uint64_t> > sorted_roads;
+        for (const road &r : roads)
+            sorted_roads.push_back({{city_names[r.city_1], city_names[r.city_2]}, r.distance});
+        sort(sorted_roads.begin(), sorted_roads.end());
+        cout << "{ \n";
+        for (const auto &i : sorted_roads)
+            cout << setw(5) << "(" << i.first.first << ", " << i.first.second << "): " << i.second << "\n";
+        
+        cout << "} \n";
     }
 
+private:
     /**
-     * @brief Return the volume of a parcel
+     * @brief A road between two cities, stored by city index
      * 
-     * @return The volume in cm^3
      */
-    uint64_t volume() const
+    struct road
     {
-        return p_vol;
-    }
+        uint32_t city_1, city_2;
+        uint64_t distance;
+    };
 
     /**
-     * @brief Return the parcels unique ID
+     * @brief The value stored for pairs of cities that are not connected, small enough that adding two of them cannot overflow
      * 
-     * @return The parcels ID value
      */
-    uint64_t this_id() const
+    static constexpr uint64_t unreachable = numeric_limits<uint64_t>::max() / 4;
+    /**
+     * @brief The first word of a binary matrix file
+     * 
+     */
+    static constexpr uint64_t matrix_magic = 0x32544d4d44584446ULL; // "FDXDMMT2", the matrix is followed by its checksum
+    /**
+     * @brief The side length of the blocks used by the Floyd-Warshall algorithm
+     * 
+     */
+    static constexpr uint64_t block_size = 64;
+
+    /**
+     * @brief Find or add the index of a city
+     * 
+     * @param city The city name
+     * @return The index of the city
+     */
+    uint32_t add_city(const string &city)
     {
-        return p_id;
+        auto found = city_index.find(city);
+        if (found != city_index.end())
+            return found->second;
+        uint32_t index = (uint32_t)city_names.size();
+        city_index.emplace(city, index);
+        city_names.push_back(city);
+        completed = false;
+        return index;
     }
 
     /**
-     * @brief Return the city where this parcel is being sent
+     * @brief A checksum of the cities and roads, so that a saved matrix is only used for the same map
      * 
-     * @return The destination city 
+     * @return The FNV-1a hash of the roads
      */
-    string where_to() const
+    uint64_t road_checksum() const
     {
-        return dest_city;
+        fnv_hash hash;
+        hash.mix(city_names.size());
+        for (const road &r : roads)
+        {
+            hash.mix(r.city_1);
+            hash.mix(r.city_2);
+            hash.mix(r.distance);
+        }
+        return hash.value();
     }
 
-private:
     /**
-     * @brief The parcels ID and volume respectively 
+     * @brief Run a task for every chunk of a range, on the thread pool if there is one
      * 
+     * @param pool An optional thread pool
+     * @param n The size of the range
+     * @param task Called with the first and one past the last index of each chunk
      */
-    uint64_t p_id, p_vol;
+    template <class task_type>
+    static void for_chunks(thread_pool *pool, const uint64_t &n, task_type task)
+    {
+        if (pool == nullptr or pool->size() == 1 or n < 2)
+        {
+            task(0, n);
+            return;
+        }
+        uint64_t chunk = (n + 4 * pool->size() - 1) / (4 * pool->size());
+        thread_pool::task_group chunks(*pool);
+        for (uint64_t first = 0; first < n; first += chunk)
+            chunks.submit([=] { task(first, min(n, first + chunk)); });
+        chunks.wait();
+    }
+
     /**
-     * @brief The parcels source city and destination city respectively 
+     * @brief Store the roads as adjacency lists in one array. Must be called with the complete mutex held
      * 
      */
-    string source_city, dest_city;
-};
-
-/**
- * @brief A truck that will be used to deliver parcels. A truck has an id, a capacity, available space left on the truck, a depot where it starts from, a route, and a list of parcels
- * 
- */
-class trucks
-{
-    friend class fleet;
+    void build_adjacency() const
+    {
+        if (adjacency_built)
+            return;
+        uint64_t n = city_names.size();
+        offsets.assign(n + 1, 0);
+        for (const road &r : roads)
+        {
+            offsets[r.city_1 + 1]++;
+            offsets[r.city_2 + 1]++;
+        }
+        for (uint64_t i = 0; i < n; i++)
+            offsets[i + 1] += offsets[i];
+        adjacent.resize(offsets[n]);
+        vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+        for (const road &r : roads)
+        {
+            adjacent[next[r.city_1]++] = {r.city_2, r.distance};
+            adjacent[next[r.city_2]++] = {r.city_1, r.distance};
+        }
+        adjacency_built = true;
+    }
 
-public:
     /**
-     * @brief Construct a new trucks object
+     * @brief Find the distance between two cities in lazy mode, from the cache or else by Dijkstra's algorithm stopping at the destination
      * 
-     * @param _id The trucks ID
-     * @param _cap The trucks capacity
-     * @param _common_depot The trucks starting depot location
+     * @param city_1 The index of the source city
+     * @param city_2 The index of the destination city
+     * @return The distance between the two cities (in km)
      */
-    trucks(const uint64_t &_id, const uint64_t &_cap, const string &_common_depot) : avail_space(_cap), t_id(_id), t_cap(_cap), depot(_common_depot) 
+    uint64_t lazy_distance(const uint32_t &city_1, const uint32_t &city_2) const
     {
-        route.push_back(depot); // Add the depot as the first stop on the route
-        parcels_list = vector<uint64_t>(0); // A list of parcels on this truck
+        if (city_1 == city_2)
+            return 0;
+        /* Roads go both ways, so both directions share one cache entry. */
+        uint64_t key = ((uint64_t)min(city_1, city_2) << 32) | max(city_1, city_2);
+        uint64_t d;
+        if (cache->get(key, d))
+            PROFILE_COUNT(distance_cache_hits, 1);
+        else
+        {
+            PROFILE_COUNT(distance_cache_misses, 1);
+            if (not adjacency_built)
+            {
+                lock_guard<mutex> lock(complete_mutex);
+                build_adjacency();
+            }
+            d = shortest_path(city_1, city_2);
+            cache->put(key, d);
+        }
+        if (d >= unreachable)
+            throw map_invalidation::map_error();
+        return d;
     }
 
-    uint64_t avail_space; // Volume available in a truck to fill with parcels
-    vector<string> route; // The route that a given truck will take
-    vector<uint64_t> parcels_list; // The list of parcels (by ID) that are loaded onto this truck
-
     /**
-     * @brief Load a parcel onto a truck
+     * @brief Run Dijkstra's algorithm from one city until another city is reached
      * 
-     * @param parcel The parcel to potentially be loaded
-     * @return True or False whether that parcel was loaded
+     * @param source The index of the source city
+     * @param target The index of the destination city
+     * @return The distance between the two cities, or unreachable
      */
-    bool pack_truck(const parcels &parcel)
+    uint64_t shortest_path(const uint32_t &source, const uint32_t &target) const
     {
-        if (parcel.p_vol <= avail_space) // If the parcel will fit on the truck, load it on the truck
+        /* Each thread keeps its distances between searches, and a search number marks which entries belong to the current search. */
+        thread_local vector<uint64_t> dist;
+        thread_local vector<uint64_t> seen_in;
+        thread_local uint64_t search = 0;
+        thread_local vector<pair<uint64_t, uint32_t> > heap;
+        if (dist.size() < city_names.size())
         {
-            parcels_list.push_back(parcel.p_id);
-            avail_space -= parcel.p_vol;
-            if (find(route.begin(), route.end(), parcel.dest_city) == route.end()) // If the parcel destination is not in the route, add it to the end of the route
-                route.push_back(parcel.dest_city);
-            return true;
+            dist.resize(city_names.size());
+            seen_in.assign(city_names.size(), 0);
         }
-        return false;
+        search++;
+        auto current = [&](const uint32_t &city) { return seen_in[city] == search ? dist[city] : unreachable; };
+
+        heap.assign(1, {0, source});
+        dist[source] = 0;
+        seen_in[source] = search;
+        while (not heap.empty())
+        {
+            pop_heap(heap.begin(), heap.end(), greater<pair<uint64_t, uint32_t> >());
+            auto [d, city] = heap.back();
+            heap.pop_back();
+            if (city == target)
+                return d;
+            if (d > current(city))
+                continue;
+            for (uint64_t e = offsets[city]; e < offsets[city + 1]; e++)
+            {
+                uint64_t through = d + adjacent[e].second;
+                if (through < current(adjacent[e].first))
+                {
+                    dist[adjacent[e].first] = through;
+                    seen_in[adjacent[e].first] = search;
+                    heap.push_back({through, adjacent[e].first});
+                    push_heap(heap.begin(), heap.end(), greater<pair<uint64_t, uint32_t> >());
+                }
+            }
+        }
+        return unreachable;
     }
 
     /**
-     * @brief The trucks capacity
+     * @brief Fill the matrix by running Dijkstra's algorithm from every city
      * 
-     * @return The volume of the truck in cm^3 
+     * @param pool An optional thread pool
      */
-    uint64_t volume() const
+    void all_pairs_dijkstra(thread_pool *pool) const
     {
-        return t_cap;
+        uint64_t n = city_names.size();
+        build_adjacency();
+        for_chunks(pool, n, [&](const uint64_t &first, const uint64_t &last) {
+            vector<pair<uint64_t, uint32_t> > heap;
+            for (uint64_t source = first; source < last; source++)
+            {
+                uint64_t *row = &matrix[source * n];
+                heap.assign(1, {0, (uint32_t)source});
+                while (not heap.empty())
+                {
+                    pop_heap(heap.begin(), heap.end(), greater<pair<uint64_t, uint32_t> >());
+                    auto [d, city] = heap.back();
+                    heap.pop_back();
+                    if (d > row[city])
+                        continue;
+                    for (uint64_t e = offsets[city]; e < offsets[city + 1]; e++)
+                    {
+                        uint64_t through = d + adjacent[e].second;
+                        if (through < row[adjacent[e].first])
+                        {
+                            row[adjacent[e].first] = through;
+                            heap.push_back({through, adjacent[e].first});
+                            push_heap(heap.begin(), heap.end(), greater<pair<uint64_t, uint32_t> >());
+                        }
+                    }
+                }
+            }
+        });
     }
 
     /**
-     * @brief Return the trucks unique ID
+     * @brief Relax every pair in block C through the cities of block K, where A = (rows of C, K) and B = (K, columns of C)
      * 
-     * @return The trucks ID
+     * @param ci The first row of block C
+     * @param cj The first column of block C
+     * @param k The first city of block K
      */
-    uint64_t my_id() const
+    void relax_block(const uint64_t &ci, const uint64_t &cj, const uint64_t &k) const
     {
-        return t_id;
+        uint64_t n = city_names.size();
+        uint64_t i_end = min(n, ci + block_size), j_end = min(n, cj + block_size), k_end = min(n, k + block_size);
+        for (uint64_t kk = k; kk < k_end; kk++)
+        {
+            const uint64_t *through = &matrix[kk * n];
+            for (uint64_t i = ci; i < i_end; i++)
+            {
+                uint64_t to_k = matrix[i * n + kk];
+                if (to_k >= unreachable)
+                    continue;
+                uint64_t *row = &matrix[i * n];
+                for (uint64_t j = cj; j < j_end; j++)
+                    row[j] = min(row[j], to_k + through[j]);
+            }
+        }
     }
 
     /**
-     * @brief A function that returns the capacity that has been used for a given truck
+     * @brief Fill the matrix with the blocked Floyd-Warshall algorithm
      * 
-     * @return The percentage of used space
+     * @param pool An optional thread pool
      */
-    double capacity_used() const
+    void all_pairs_floyd_warshall(thread_pool *pool) const
     {
-        double percentage = (double)avail_space / (double)t_cap;
-        return 100.0 - (percentage * 100.0);
+        uint64_t n = city_names.size();
+        for (const road &r : roads)
+        {
+            uint64_t &forward = matrix[(uint64_t)r.city_1 * n + r.city_2];
+            uint64_t &backward = matrix[(uint64_t)r.city_2 * n + r.city_1];
+            forward = backward = min(forward, r.distance);
+        }
+        uint64_t blocks = (n + block_size - 1) / block_size;
+        for (uint64_t kb = 0; kb < blocks; kb++)
+        {
+            uint64_t k = kb * block_size;
+            /* The diagonal block depends only on itself, then its row and column, then every other block. */
+            relax_block(k, k, k);
+            for_chunks(pool, blocks, [&](const uint64_t &first, const uint64_t &last) {
+                for (uint64_t b = first; b < last; b++)
+                {
+                    if (b == kb)
+                        continue;
+                    relax_block(k, b * block_size, k);
+                    relax_block(b * block_size, k, k);
+                }
+            });
+            for_chunks(pool, blocks, [&](const uint64_t &first, const uint64_t &last) {
+                for (uint64_t bi = first; bi < last; bi++)
+                {
+                    if (bi == kb)
+                        continue;
+                    for (uint64_t bj = 0; bj < blocks; bj++)
+                    {
+                        if (bj != kb)
+                            relax_block(bi * block_size, bj * block_size, k);
+                    }
+                }
+            });
+        }
     }
 
-private:
     /**
-     * @brief The trucks unique ID
+     * @brief The index of each city in this map
      * 
      */
-    uint64_t t_id;
+    unordered_map<string, uint32_t> city_index;
     /**
-     * @brief The trucks capacity (in cm^3)
+     * @brief The name of each city, by index
      * 
      */
-    uint64_t t_cap;
+    vector<string> city_names;
     /**
-     * @brief The trucks starting location
+     * @brief The roads between cities in the order they were added
      * 
      */
-    string depot;
-};
-
-/**
- * @brief A map that stores the distances between cities for all cities where parcels must be delivered
- * 
- */
-class distanceMap
-{
-    friend class fleet;
-
-public:
+    vector<road> roads;
     /**
-     * @brief Construct a new distance Map object
+     * @brief The pairs of cities that already have a road, in the direction they were added
      * 
      */
-    distanceMap() {}
-
+    set<pair<uint32_t, uint32_t> > road_set;
     /**
-     * @brief Add the distance between two cities to the distance map
+     * @brief The shortest distance between every pair of cities, row by row
      * 
-     * @param city_1 The first city
-     * @param city_2 The second city
-     * @param distance The distance between the cities in km
      */
-    void add_distance(const string &city_1, const string &city_2, const uint64_t &distance)
-    {
-        vector<string> this_tuple = {city_1, city_2};
-        if (distance_map.count(this_tuple) == 0)
-            distance_map[this_tuple] = distance;
-    }
-
+    mutable vector<uint64_t> matrix;
     /**
-     * @brief Find the distance between two given cities (in km)
+     * @brief A copy of the matrix on each NUMA node, empty unless the map was replicated
      * 
-     * @param city_1 The source city
-     * @param city_2 The destination city
-     * @return The distance between the two cities (in km)
      */
-    uint64_t distance(const string &city_1, const string &city_2) const
-    {
-        vector<string> this_tuple = {city_1, city_2};
-        vector<string> reverse_tuple = {city_2, city_1};
-        if (distance_map.count(this_tuple) == 1)
-            return distance_map.at(this_tuple);
-        else if (distance_map.count(reverse_tuple) == 1)
-            return distance_map.at(reverse_tuple);
-        else
-            throw map_invalidation::map_error();
-    }
-
+    vector<vector<uint64_t> > replicas;
     /**
-     * @brief Print the distance map as a dictionary 
+     * @brief If the matrix is up to date with the roads
      * 
      */
-    void print_distance_map() const
-    {
-        cout << "{ \n";
-        for (const auto &i : distance_map)        
-            cout << setw(5) << "(" << i.first[0] << ", " << i.first[1] << "): " << i.second << "\n";
-        
-        cout << "} \n";
-    }
+    mutable atomic<bool> completed{false};
+    mutable mutex complete_mutex;
+    /**
+     * @brief The roads leaving each city, as offsets into one array of (city, distance) pairs
+     * 
+     */
+    mutable vector<uint64_t> offsets;
+    mutable vector<pair<uint32_t, uint64_t> > adjacent;
+    mutable atomic<bool> adjacency_built{false};
+    /**
+     * @brief The cache of distances in lazy mode, empty when the complete matrix is used
+     * 
+     */
+    unique_ptr<lru_cache> cache;
+};
+
 
-private:
 /**
- * @brief A map where each key is a tuple of the two cities and the value is the distance between them
+ * @brief How the distance of a route is measured, closed tours include the drive from the last stop back to the depot
  * 
  */
-    map<vector<string>, uint64_t> distance_map;
+enum class tour_mode
+{
+    open,
+    closed
 };
 
-
 /**
  * @brief A fleet of trucks for delivering parcels. A fleet will have a list of trucks.
  * 
@@ -319,8 +1349,9 @@ public:
     /**
      * @brief Construct a new fleet object
      * 
+     * @param _tours How route distances are measured, trucks return to their depot by default
      */
-    fleet() {}
+    explicit fleet(const tour_mode &_tours = tour_mode::closed) : tours(_tours) {}
 
     /**
      * @brief A function for adding a truck to this fleet of trucks, and adding the map entry
@@ -329,21 +1360,12 @@ public:
      */
     void add_truck(const trucks &truck)
     {
-        uint64_t counter = 0;
-        /* Check if the truck has already been added to the fleet. */
-        for (trucks &curr_truck : f_trucks)
-        {
-            if (curr_truck.t_id == truck.t_id) // Check by ID since IDs are unique
-            {
-                counter += 1;
-                throw fleet_invalidation::unique_id();
-            }
-        }
-        if (counter == 0) // The truck has not already been added to the fleet
-        {
-            f_trucks.push_back(truck);
-            parcel_alloc[truck.t_id] = truck.parcels_list;
-        }
+        /* Check if the truck has already been added to the fleet, by ID since IDs are unique. */
+        if (parcel_alloc.count(truck.t_id) != 0)
+            throw fleet_invalidation::unique_id();
+        f_trucks.push_back(truck);
+        parcel_alloc[truck.t_id] = truck.parcels_list;
+        measured_map = nullptr;
     }
 
     /**
@@ -352,15 +1374,42 @@ public:
      */
     void print_fleet() const
     {
+        /* Format the whole fleet first and write it in one call, which is much faster than writing it city by city. */
+        string text;
         for (const trucks &truck : f_trucks)
         {
-            cout << "Truck: " << truck.t_id << " Route: ";
+            text += "Truck: ";
+            text += to_string(truck.t_id);
+            text += " Route: ";
             for (const string &t_route : truck.route)
             {
-                cout << t_route << " -> ";
+                text += t_route;
+                text += " -> ";
             }
-            cout << "\n";
+            text += "\n";
         }
+        cout.write(text.data(), (streamsize)text.size());
+    }
+
+    /**
+     * @brief The trucks in this fleet, in the order they were added
+     * 
+     * @return The list of trucks
+     */
+    const vector<trucks> &trucks_in_fleet() const
+    {
+        return f_trucks;
+    }
+
+    /**
+     * @brief The parcels loaded on a truck in this fleet
+     * 
+     * @param truck_id The ID of the truck
+     * @return The IDs of the parcels on the truck
+     */
+    const vector<uint64_t> &manifest(const uint64_t &truck_id) const
+    {
+        return parcel_alloc.at(truck_id);
     }
 
     /**
@@ -373,7 +1422,7 @@ public:
         uint64_t counter = 0;
         for (const trucks &truck : f_trucks)
         {
-            if (truck.avail_space != truck.t_cap)
+            if (loaded(truck))
                 counter += 1;
         }
         return counter;
@@ -389,18 +1438,35 @@ public:
         uint64_t volume = 0;
         for (const trucks &truck : f_trucks)
         {
-            if (truck.avail_space != truck.t_cap) // Check for trucks that have parcels loaded on them
-                volume += truck.avail_space;
+            if (loaded(truck)) // Check for trucks that have parcels loaded on them
+                volume += truck.avail_space();
         }
         return volume;
     }
 
+    /**
+     * @brief Check if any truck in this fleet is limited in a capacity dimension
+     * 
+     * @param dimension The capacity dimension
+     * @return True or False whether the dimension limits any truck
+     */
+    bool dimension_limited(const capacity_dimension &dimension) const
+    {
+        for (const trucks &truck : f_trucks)
+        {
+            if (truck.t_limits[(uint64_t)dimension] != unlimited_capacity)
+                return true;
+        }
+        return false;
+    }
+
     /**
      * @brief Return that average capacity used for all trucks with loaded parcels
      * 
-     * @return The volume of the trucks capacity used as a percentage 
+     * @param dimension The capacity dimension, volume by default
+     * @return The trucks capacity used as a percentage 
      */
-    double avg_capacity_used() const
+    double avg_capacity_used(const capacity_dimension &dimension = capacity_dimension::volume) const
     {
         double avg_cap_ = 0.0;
         uint64_t N = number_trucks_used();
@@ -409,7 +1475,7 @@ public:
             double tot_cap = 0.0;
             for (const trucks &truck : f_trucks)
             {
-                tot_cap += truck.capacity_used(); 
+                tot_cap += truck.capacity_used(dimension); 
             }
             avg_cap_ = tot_cap / (double)N;
         }
@@ -419,20 +1485,22 @@ public:
     /**
      * @brief Calculate the standard deviation for the capacity used of loaded trucks
      * 
+     * @param dimension The capacity dimension, volume by default
      * @return The standard deviation of capacity used 
      */
-    double std_dev_capacity_used() const
+    double std_dev_capacity_used(const capacity_dimension &dimension = capacity_dimension::volume) const
     {
         double std_dev = 0.0;
         uint64_t N = number_trucks_used();
         if (N != 0)
         {
-            double mean_cap = avg_capacity_used();
+            double mean_cap = avg_capacity_used(dimension);
             double sum_num_minus_mean = 0.0;
             double over_N = 1.0 / (double)N;
             for (const trucks &truck : f_trucks)
             {
-                sum_num_minus_mean += pow(truck.capacity_used() - mean_cap, 2.0);
+                if (loaded(truck)) // Trucks without parcels are not part of the average
+                    sum_num_minus_mean += pow(truck.capacity_used(dimension) - mean_cap, 2.0);
             }
             std_dev = sqrt(over_N * sum_num_minus_mean);
         }
@@ -440,29 +1508,109 @@ public:
     }
 
     /**
-     * @brief Calculate the average distance travelled by trucks in this fleet
+     * @brief How the route distances of this fleet are measured
+     * 
+     * @return Whether routes are open or closed tours
+     */
+    tour_mode tour() const
+    {
+        return tours;
+    }
+
+    /**
+     * @brief The distance of the route of each truck in this fleet, in the order the trucks were added. The distances are measured
+     * in one pass the first time they are asked for and kept until a truck is added, so the statistics do not look them up again
+     * 
+     * @param dmap The distance map
+     * @return The route distance of each truck (in km), zero for trucks without parcels
+     */
+    const vector<uint64_t> &truck_distances(const distanceMap &dmap) const
+    {
+        if (measured_map != &dmap)
+        {
+            route_distances.assign(f_trucks.size(), 0);
+            for (uint64_t i = 0; i < f_trucks.size(); i++)
+            {
+                if (loaded(f_trucks[i]))
+                    route_distances[i] = route_distance(f_trucks[i], dmap, tours);
+            }
+            measured_map = &dmap;
+        }
+        return route_distances;
+    }
+
+    /**
+     * @brief Measure the distance of a trucks route. Each city is looked up in the map once, and the legs are then found by city index
+     * 
+     * @param truck The truck
+     * @param dmap The distance map
+     * @param tours Whether the drive back to the depot is included
+     * @return The route distance (in km)
+     */
+    static uint64_t route_distance(const trucks &truck, const distanceMap &dmap, const tour_mode &tours = tour_mode::closed)
+    {
+        if (truck.route.size() < 2)
+            return 0;
+        uint32_t depot = dmap.city_id(truck.route[0]), previous = depot;
+        uint64_t distance = 0;
+        for (uint64_t i = 1; i < truck.route.size(); i++)
+        {
+            uint32_t city = dmap.city_id(truck.route[i]);
+            distance += dmap.distance(previous, city);
+            previous = city;
+        }
+        if (tours == tour_mode::closed)
+            distance += dmap.distance(previous, depot);
+        return distance;
+    }
+
+    /**
+     * @brief Calculate the total distance travelled by all trucks in this fleet
+     * 
+     * @return The total distance travelled (in km)
+     */
+    uint64_t total_distance_travelled(const distanceMap &dmap) const
+    {
+        uint64_t distance_travel = 0;
+        for (const uint64_t &distance : truck_distances(dmap))
+            distance_travel += distance;
+        return distance_travel;
+    }
+
+    /**
+     * @brief Calculate the cost of running every truck with loaded parcels in this fleet, which is the dispatch cost of each truck
+     * and its cost per km over its route
+     * 
+     * @return The total cost (in cents)
+     */
+    uint64_t total_cost(const distanceMap &dmap) const
+    {
+        uint64_t cost = 0;
+        const vector<uint64_t> &distances = truck_distances(dmap);
+        for (uint64_t i = 0; i < f_trucks.size(); i++)
+        {
+            if (loaded(f_trucks[i]))
+                cost += f_trucks[i].t_fixed_cost + f_trucks[i].t_km_cost * distances[i];
+        }
+        return cost;
+    }
+
+    /**
+     * @brief Calculate the average distance travelled by the trucks with loaded parcels in this fleet
      * 
      * @return The average distance travelled  
      */
     double avg_distance_travelled(const distanceMap &dmap) const
     {
         double avg_distance = 0.0;
-        uint64_t distance_travel = 0;
         uint64_t N = number_trucks_used();
         if (N != 0)
-        {
-            for (const trucks &truck : f_trucks)
-            {
-                for (uint64_t i = 0; i < truck.route.size() - 1; i++)
-                    distance_travel += dmap.distance(truck.route[i], truck.route[i + 1]);
-            }
-            avg_distance = (double)distance_travel / (double)N;
-        }
+            avg_distance = (double)total_distance_travelled(dmap) / (double)N;
         return avg_distance;
     }
 
     /**
-     * @brief Calculate the standard deviation for the distance travelled by the trucks in this fleet
+     * @brief Calculate the standard deviation for the distance travelled by the trucks with loaded parcels in this fleet
      * 
      * @return The standard deviations for distance travelled 
      */
@@ -475,13 +1623,11 @@ public:
             double mean_dist = avg_distance_travelled(dmap);
             double sum_num_minus_mean = 0.0;
             double over_N = 1.0 / (double)N;
-            for (const trucks &truck : f_trucks)
+            const vector<uint64_t> &distances = truck_distances(dmap);
+            for (uint64_t i = 0; i < f_trucks.size(); i++)
             {
-                uint64_t this_truck = 0;
-                for (uint64_t i = 0; i < truck.route.size() - 1; i++)
-                    this_truck += dmap.distance(truck.route[i], truck.route[i + 1]);
-
-                sum_num_minus_mean += pow((double)this_truck - mean_dist, 2.0);
+                if (loaded(f_trucks[i]))
+                    sum_num_minus_mean += pow((double)distances[i] - mean_dist, 2.0);
             }
             std_dev = sqrt(over_N * sum_num_minus_mean);
         }
@@ -489,6 +1635,17 @@ public:
     }
 
 private:
+    /**
+     * @brief Check if a truck has parcels loaded on it, only those trucks are counted in the statistics
+     * 
+     * @param truck The truck
+     * @return True or False whether the truck is used
+     */
+    static bool loaded(const trucks &truck)
+    {
+        return truck.avail_load != truck.t_limits;
+    }
+
 /**
  * @brief The list of trucks in this fleet, stored in a vector
  * 
@@ -499,4 +1656,15 @@ private:
      * 
      */
     map<uint64_t, vector<uint64_t> > parcel_alloc;
+    /**
+     * @brief Whether the drive back to the depot is counted in route distances
+     * 
+     */
+    tour_mode tours;
+    /**
+     * @brief The route distance of each truck, measured with the map that measured_map points to, or not yet measured if it is nullptr
+     * 
+     */
+    mutable vector<uint64_t> route_distances;
+    mutable const distanceMap *measured_map = nullptr;
 };
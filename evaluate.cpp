@@ -0,0 +1,258 @@
+/**
+ * @file evaluate.cpp
+ * @author Cassandra Masschelein
+ * @brief A program that runs every scheduler over a sweep of synthetic instance sizes and time budgets, and reports which runs give the best trade off between schedule quality and time
+ * @version 0.1
+ * @date 2022-02-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#include "domain.hpp"
+#include "schedule.hpp"
+#include "generator.hpp"
+#include "thread_pool.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/resource.h>
+
+using namespace std;
+
+/**
+ * @brief The quality and cost of one scheduling run
+ *
+ */
+struct evaluation
+{
+    string instance_name;
+    string scheduler_name;
+    uint64_t budget_ms; // The time budget, 0 for no limit
+    double wall_ms;
+    uint64_t peak_rss_kb;
+    uint64_t total_distance;
+    uint64_t total_cost; // The cost of running the loaded trucks (in cents)
+    uint64_t trucks_used;
+    uint64_t unpacked_volume;
+    bool pareto_optimal;
+};
+
+/**
+ * @brief Reset the peak resident set size of this process, so that the next reading covers a single run. Only supported on Linux
+ *
+ */
+void reset_peak_rss()
+{
+    ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs.is_open())
+        clear_refs << "5";
+}
+
+/**
+ * @brief Read the peak resident set size of this process
+ *
+ * @return The peak resident set size (in kB)
+ */
+uint64_t peak_rss_kb()
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return stoull(line.substr(6));
+    }
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)usage.ru_maxrss;
+}
+
+/**
+ * @brief Check if run A is at least as good as run B in every measure and better in at least one
+ *
+ * @param a The first run
+ * @param b The second run
+ * @return If it is true that run A dominates run B
+ */
+bool dominates(const evaluation &a, const evaluation &b)
+{
+    bool no_worse = a.wall_ms <= b.wall_ms and a.total_distance <= b.total_distance and a.total_cost <= b.total_cost and a.trucks_used <= b.trucks_used and a.unpacked_volume <= b.unpacked_volume;
+    bool better = a.wall_ms < b.wall_ms or a.total_distance < b.total_distance or a.total_cost < b.total_cost or a.trucks_used < b.trucks_used or a.unpacked_volume < b.unpacked_volume;
+    return no_worse and better;
+}
+
+/**
+ * @brief Run one scheduler on an instance with a time budget and measure the result
+ *
+ * @tparam scheduler_type The scheduler to be run
+ * @param generated The instance to be scheduled
+ * @param dmap The distance map of the instance
+ * @param pool The thread pool that runs the depot tasks
+ * @param budget_ms The time budget, 0 for no limit
+ * @return The measured run
+ */
+template <class scheduler_type>
+evaluation evaluate_scheduler(const instance &generated, const distanceMap &dmap, thread_pool &pool, const uint64_t &budget_ms)
+{
+    evaluation result;
+    result.budget_ms = budget_ms;
+    vector<trucks> truck_list = generated.truck_list;
+
+    reset_peak_rss();
+    auto start = chrono::steady_clock::now();
+    chrono::steady_clock::time_point deadline = budget_ms == 0 ? chrono::steady_clock::time_point::max() : start + chrono::milliseconds(budget_ms);
+    vector<parcels> unpacked = schedule_depots<scheduler_type>(generated.parcel_list, truck_list, dmap, pool, deadline);
+    result.wall_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    result.peak_rss_kb = peak_rss_kb();
+
+    fleet scheduled;
+    for (const trucks &truck : truck_list)
+        scheduled.add_truck(truck);
+    result.total_distance = scheduled.total_distance_travelled(dmap);
+    result.total_cost = scheduled.total_cost(dmap);
+    result.trucks_used = scheduled.number_trucks_used();
+    result.unpacked_volume = 0;
+    for (const parcels &parcel : unpacked)
+        result.unpacked_volume += parcel.volume();
+    result.pareto_optimal = false;
+    return result;
+}
+
+/**
+ * @brief Read a comma separated list of whole numbers
+ *
+ * @param value The list
+ * @return The numbers in the list
+ */
+vector<uint64_t> read_list(const string &value)
+{
+    vector<uint64_t> numbers;
+    stringstream str(value);
+    string entry;
+    while (getline(str, entry, ','))
+        numbers.push_back(stoull(entry));
+    return numbers;
+}
+
+int main(int argc, char *argv[])
+{
+    string usage = "Usage: ./evaluate [--sizes=P1,P2,...] [--budgets=MS1,MS2,...] [--distribution=uniform|exponential|bimodal] [--max_weight=W] [--shift_minutes=M] [--cost_per_km=C] [--seed=S] [--out=FILE] \nEach size is a number of parcels, the number of cities and trucks grows with it. A budget of 0 means no time limit. \n";
+    vector<uint64_t> sizes = {500, 2000, 8000};
+    vector<uint64_t> budgets = {0};
+    string out_path = "pareto-report.csv";
+    instance_spec spec;
+    spec.cost_per_km = 100; // Trucks have costs so that the low cost scheduler has something to weigh, the other schedulers ignore them
+
+    /* Read the command line options. */
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            uint64_t split = arg.find('=');
+            if (arg.rfind("--", 0) != 0 or split == string::npos)
+                throw invalid_argument("Unknown option " + arg);
+            string key = arg.substr(2, split - 2), value = arg.substr(split + 1);
+            if (key == "sizes")
+                sizes = read_list(value);
+            else if (key == "budgets")
+                budgets = read_list(value);
+            else if (key == "distribution")
+                spec.distribution = parse_distribution(value);
+            else if (key == "seed")
+                spec.seed = stoull(value);
+            else if (key == "max_weight")
+                spec.max_weight = stoull(value);
+            else if (key == "shift_minutes")
+                spec.shift_minutes = stoull(value);
+            else if (key == "cost_per_km")
+                spec.cost_per_km = stoull(value);
+            else if (key == "out")
+                out_path = value;
+            else
+                throw invalid_argument("Unknown option " + arg);
+        }
+    }
+    catch (const exception &ex)
+    {
+        cerr << "Invalid argument: " << ex.what() << '\n';
+        cout << usage;
+        return -1;
+    }
+
+    /* Run every scheduler with every budget on every instance size. */
+    thread_pool pool;
+    vector<evaluation> results;
+    try
+    {
+        for (const uint64_t &size : sizes)
+        {
+            instance_spec sized = spec;
+            sized.parcels = size;
+            sized.cities = max<uint64_t>(2, size / 20);
+            sized.trucks = max<uint64_t>(1, size / 20);
+            instance generated = generate_instance(sized);
+            distanceMap dmap = build_distance_map(generated.map_entries);
+            string instance_name = "c" + to_string(sized.cities) + "_t" + to_string(sized.trucks) + "_p" + to_string(sized.parcels);
+            cout << "Evaluating the schedulers on instance " << instance_name << "... \n";
+
+            uint64_t first = results.size();
+            for (const uint64_t &budget : budgets)
+            {
+                results.push_back(evaluate_scheduler<randomScheduler>(generated, dmap, pool, budget));
+                results.back().scheduler_name = "Random Parcels";
+                results.push_back(evaluate_scheduler<mostparcelScheduler>(generated, dmap, pool, budget));
+                results.back().scheduler_name = "Most Parcels";
+                results.push_back(evaluate_scheduler<shortrouteScheduler>(generated, dmap, pool, budget));
+                results.back().scheduler_name = "Short Route";
+                results.push_back(evaluate_scheduler<lowcostScheduler>(generated, dmap, pool, budget));
+                results.back().scheduler_name = "Low Cost";
+            }
+
+            /* A run is on the Pareto front if no other run on the same instance dominates it. */
+            for (uint64_t i = first; i < results.size(); i++)
+            {
+                results[i].instance_name = instance_name;
+                results[i].pareto_optimal = true;
+                for (uint64_t j = first; j < results.size(); j++)
+                {
+                    if (dominates(results[j], results[i]))
+                    {
+                        results[i].pareto_optimal = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    catch (const exception &ex)
+    {
+        cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    /* Write the report. */
+    ofstream report(out_path);
+    if (!report.is_open())
+    {
+        cout << "Error opening output file for the Pareto report!";
+        return -1;
+    }
+    report << "Instance" << ", " << "Scheduler" << ", " << "Budget (ms)" << ", " << "Wall Time (ms)" << ", " << "Peak RSS (kB)" << ", " << "Total Distance (km)" << ", " << "Total Cost (cents)" << ", " << "Trucks Used" << ", " << "Unpacked Volume (cm^3)" << ", " << "Pareto Optimal" << "\n";
+    for (const evaluation &r : results)
+        report << r.instance_name << ", " << r.scheduler_name << ", " << r.budget_ms << ", " << r.wall_ms << ", " << r.peak_rss_kb << ", " << r.total_distance << ", " << r.total_cost << ", " << r.trucks_used << ", " << r.unpacked_volume << ", " << (r.pareto_optimal ? "yes" : "no") << "\n";
+    report.close();
+
+    cout << "The runs on the Pareto front, where no other run is faster and better in every measure, are: \n";
+    for (const evaluation &r : results)
+    {
+        if (r.pareto_optimal)
+            cout << r.instance_name << ": " << r.scheduler_name << " with budget " << r.budget_ms << "ms took " << r.wall_ms << "ms, travelled " << r.total_distance << "km for " << r.total_cost << " cents with " << r.trucks_used << " trucks and left " << r.unpacked_volume << "cm^3 unpacked \n";
+    }
+    cout << "The full comparison has been written to the " << out_path << " file. \n";
+}
@@ -0,0 +1,935 @@
+/**
+ * @file exact.hpp
+ * @author Cassandra Masschelein
+ * @brief Define an exact packer that finds the best assignment of parcels to trucks by branch and bound, for days with a few hundred
+ * parcels where a provably best packing is worth more than a fast one
+ * @version 0.1
+ * @date 2022-05-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "schedule.hpp"
+#include "bounds.hpp"
+#include "timing.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+#include <vector>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief The exact packer exception error namespace
+ *
+ */
+namespace exact_invalidation
+{
+    /**
+     * @brief Error message for when the exact packer is given constraints it does not search over
+     *
+     */
+    class unsupported_error : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new unsupported error object
+         *
+         * @param reason The constraints that cannot be searched over
+         */
+            explicit unsupported_error(const string &reason) : invalid_argument("The exact packer cannot schedule parcels " + reason + "!"){};
+    };
+}
+
+/**
+ * @brief What the exact packer minimizes
+ *
+ */
+enum class exact_objective
+{
+    least_unpacked, // The volume of the parcels left unpacked
+    fewest_trucks   // The number of trucks used, among the schedules that leave the least volume unpacked
+};
+
+/**
+ * @brief Read the name of an exact packer objective
+ *
+ * @param name The name of the objective, unpacked or trucks
+ * @return The objective
+ */
+exact_objective parse_exact_objective(const string &name)
+{
+    if (name == "unpacked")
+        return exact_objective::least_unpacked;
+    if (name == "trucks")
+        return exact_objective::fewest_trucks;
+    throw invalid_argument("Unknown exact objective " + name + ", the objectives are unpacked and trucks!");
+}
+
+/**
+ * @brief The schedule found by the exact packer and how far it is proven to be from the best schedule. When the search finishes
+ * the bounds equal the schedule, when the time limit is hit they are the best that was proven
+ *
+ */
+struct exact_result
+{
+    exact_objective objective = exact_objective::least_unpacked;
+    bool optimal = false;              // If the schedule is proven to be the best for the objective
+    uint64_t unpacked_volume = 0;      // The volume of the parcels left unpacked (in cm^3)
+    uint64_t unpacked_volume_bound = 0; // No schedule leaves less volume unpacked
+    uint64_t trucks_used = 0;          // The trucks that carry at least one parcel
+    uint64_t trucks_bound = 0;         // No schedule that leaves no more volume unpacked uses fewer trucks
+    uint64_t nodes = 0;                // The search nodes visited
+
+    /**
+     * @brief The proven gap of the schedule, in the unpacked volume until that is proven and then in the trucks used when the
+     * objective is the fewest trucks
+     *
+     * @return The gap as a percentage of the value reached, 0 if the schedule is the best
+     */
+    double gap_percent() const
+    {
+        if (unpacked_volume > unpacked_volume_bound)
+            return optimality_gap(unpacked_volume, unpacked_volume_bound);
+        if (objective == exact_objective::fewest_trucks)
+            return optimality_gap(trucks_used, trucks_bound);
+        return 0.0;
+    }
+
+    /**
+     * @brief Add the result of another depot, depots are packed independently so their values and bounds add up
+     *
+     * @param depot The result of the other depot
+     */
+    void add(const exact_result &depot)
+    {
+        optimal = optimal and depot.optimal;
+        unpacked_volume += depot.unpacked_volume;
+        unpacked_volume_bound += depot.unpacked_volume_bound;
+        trucks_used += depot.trucks_used;
+        trucks_bound += depot.trucks_bound;
+        nodes += depot.nodes;
+    }
+};
+
+/**
+ * @brief Finds the best assignment of parcels to the trucks of one depot by branch and bound. The parcels are placed largest first,
+ * each onto one of the trucks it fits on or left unpacked. A branch is cut when its lower bound cannot beat the best schedule found:
+ * the parcels that fit on no truck are left unpacked, the rest can only be loaded into the room the trucks have left, and the trucks
+ * that must be opened for them are counted from the largest empty trucks. The search starts from the better of two greedy schedules,
+ * and the root is also bounded with the Martello and Toth L2 bound. Trucks with the same room are only tried once for a parcel, equal
+ * parcels go onto trucks in increasing order, and the states already searched are remembered so a state reached again at no lower
+ * cost is skipped. The tree is split into subtrees that are searched on the thread pool and share the best schedule. Routes are built
+ * like the other schedulers build them, each truck visits the destinations of its parcels in the order the parcels were read, so
+ * delivery windows, shift limits, and pickups are not searched over
+ *
+ */
+class exact_packer
+{
+public:
+    /**
+     * @brief Construct a new exact packer object
+     *
+     * @param _parcel_list The list of parcels to be loaded on trucks and delivered
+     * @param _truck_list The list of trucks available for delivering parcels, loaded in place
+     */
+    exact_packer(const item_span<const parcels> &_parcel_list, const item_span<trucks> &_truck_list) : truck_list(_truck_list), parcel_list(_parcel_list) {}
+
+    /**
+     * @brief Choose what the packer minimizes, the unpacked volume by default
+     *
+     * @param _objective The objective
+     */
+    void set_objective(const exact_objective &_objective)
+    {
+        objective = _objective;
+    }
+
+    /**
+     * @brief Set a time limit for the search. When the deadline passes the best schedule found is loaded, with the gap that was proven
+     *
+     * @param _deadline The time by which the search must stop
+     */
+    void set_deadline(const chrono::steady_clock::time_point &_deadline)
+    {
+        deadline = _deadline;
+    }
+
+    /**
+     * @brief Limit the memory used to remember the states already searched, shared by the subtrees searched at the same time
+     *
+     * @param bytes The memory for remembered states
+     */
+    void set_memo_bytes(const uint64_t &bytes)
+    {
+        memo_bytes = bytes;
+    }
+
+    /**
+     * @brief Find the best schedule, or the best found by the deadline, and load the trucks with it. The search waits only for its own
+     * subtrees, and may be run from a task running on the pool
+     *
+     * @param pool The thread pool the subtrees are searched on
+     * @return A list of parcels that are not loaded on trucks
+     */
+    vector<parcels> schedule(thread_pool &pool)
+    {
+        PROFILE_SCOPE("exact/search");
+        prepare();
+        search_node root = root_node();
+        greedy(root, false);
+        greedy(root, true);
+        node_bound root_bound = bound_root(root, best_unpacked);
+        if (not reaches(root_bound))
+            search(root, pool);
+
+        /* Bound what was left unsearched, the best schedule is then at most the proven gap from the best possible. */
+        report = exact_result();
+        report.objective = objective;
+        report.unpacked_volume = best_unpacked;
+        report.trucks_used = best_trucks;
+        report.nodes = total_nodes;
+        root_bound = bound_root(root, best_unpacked);
+        node_bound open = {best_unpacked, best_trucks};
+        for (const search_node &subtree : unfinished)
+        {
+            node_bound b = bound(subtree, best_unpacked);
+            open.unpacked = min(open.unpacked, b.unpacked);
+            open.trucks = min(open.trucks, b.trucks);
+        }
+        report.unpacked_volume_bound = min(best_unpacked, max(open.unpacked, root_bound.unpacked));
+        /* Only a search for the fewest trucks tries every truck count, otherwise the root bound is all that is proven about trucks. */
+        if (objective == exact_objective::fewest_trucks)
+            report.trucks_bound = min(best_trucks, max(open.trucks, root_bound.trucks));
+        else
+            report.trucks_bound = min(best_trucks, root_bound.trucks);
+        report.optimal = unfinished.empty() or (report.unpacked_volume_bound == best_unpacked and (objective == exact_objective::least_unpacked or report.trucks_bound == best_trucks));
+        unfinished.clear();
+        return load_best();
+    }
+
+    /**
+     * @brief The schedule found by the last call to schedule and how far it is proven to be from the best schedule
+     *
+     * @return The result of the search
+     */
+    const exact_result &result() const
+    {
+        return report;
+    }
+
+private:
+    /**
+     * @brief The choice of a parcel that is left unpacked
+     *
+     */
+    static constexpr uint32_t leave_unpacked = numeric_limits<uint32_t>::max();
+    static constexpr uint64_t volume = (uint64_t)capacity_dimension::volume;
+
+    /**
+     * @brief A partial schedule: the parcels before next are placed, and the room and use of each truck follow from them
+     *
+     */
+    struct search_node
+    {
+        uint64_t next = 0;        // The position of the next parcel to place, in placing order
+        uint64_t unpacked = 0;    // The volume of the parcels left unpacked so far
+        uint64_t used_count = 0;  // The trucks that carry a parcel
+        uint32_t previous = 0;    // The choice made for the parcel before next
+        vector<load_vector> room; // The room left on each truck
+        vector<uint8_t> used;     // If each truck carries a parcel
+        vector<uint32_t> choice;  // The truck of each placed parcel, or leave_unpacked
+    };
+
+    /**
+     * @brief A lower bound on every schedule that completes a partial schedule
+     *
+     */
+    struct node_bound
+    {
+        uint64_t unpacked = 0; // The least volume left unpacked
+        uint64_t trucks = 0;   // The fewest trucks used by a schedule that leaves no more than the best schedule unpacked
+    };
+
+    /**
+     * @brief What one search task keeps to itself: the remembered states, a copy of the best schedule value, and reused lists
+     *
+     */
+    struct worker_state
+    {
+        unordered_map<string, pair<uint64_t, uint64_t> > memo; // The unpacked volume and trucks used each state was reached with
+        uint64_t memo_left = 0;
+        uint64_t best_unpacked = 0, best_trucks = 0;
+        uint64_t nodes = 0;
+        string key;
+        vector<vector<uint32_t> > options; // The choices tried at each depth
+        vector<array<uint64_t, capacity_dimensions + 1> > records;
+    };
+
+    /**
+     * @brief Sort the parcels into placing order, largest volume first, and find the capacity dimensions every truck is limited in
+     *
+     */
+    void prepare()
+    {
+        order.resize(parcel_list.size());
+        for (uint64_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        stable_sort(order.begin(), order.end(), [this](const uint64_t &a, const uint64_t &b) {
+            const load_vector &x = parcel_list[a].load(), &y = parcel_list[b].load();
+            return x[volume] != y[volume] ? x[volume] > y[volume] : x > y;
+        });
+        sizes.clear();
+        for (const uint64_t &index : order)
+            sizes.push_back(parcel_list[index].load());
+        same_as_previous.assign(sizes.size(), false);
+        for (uint64_t k = 1; k < sizes.size(); k++)
+            same_as_previous[k] = sizes[k] == sizes[k - 1];
+        for (uint64_t d = 0; d < capacity_dimensions; d++)
+        {
+            limited[d] = not truck_list.empty();
+            for (const trucks &truck : truck_list)
+                limited[d] = limited[d] and truck.limits()[d] != unlimited_capacity;
+        }
+        best_choice.clear();
+        best_unpacked = best_trucks = numeric_limits<uint64_t>::max();
+        total_nodes = 0;
+        stopped = false;
+        out_of_time = false;
+        unfinished.clear();
+    }
+
+    /**
+     * @brief The partial schedule with no parcel placed, trucks that already carry parcels count as used
+     *
+     * @return The root of the search tree
+     */
+    search_node root_node() const
+    {
+        search_node root;
+        for (const trucks &truck : truck_list)
+        {
+            root.room.push_back(truck.avail_load);
+            root.used.push_back(not truck.parcels_list.empty());
+            root.used_count += root.used.back();
+        }
+        root.choice.assign(sizes.size(), leave_unpacked);
+        return root;
+    }
+
+    /**
+     * @brief Check if one schedule value is better than another for the objective
+     *
+     * @param unpacked The unpacked volume of the first schedule
+     * @param used The trucks used by the first schedule
+     * @param other_unpacked The unpacked volume of the second schedule
+     * @param other_used The trucks used by the second schedule
+     * @return If it is true that the first schedule is better
+     */
+    bool better(const uint64_t &unpacked, const uint64_t &used, const uint64_t &other_unpacked, const uint64_t &other_used) const
+    {
+        if (objective == exact_objective::least_unpacked)
+            return unpacked < other_unpacked;
+        return unpacked < other_unpacked or (unpacked == other_unpacked and used < other_used);
+    }
+
+    /**
+     * @brief Check if a bound shows that no schedule below a node beats the best schedule found
+     *
+     * @param b The bound of the node
+     * @param w The search task, with its copy of the best schedule value
+     * @return True or False whether the node can be cut
+     */
+    bool cut(const node_bound &b, const worker_state &w) const
+    {
+        if (objective == exact_objective::least_unpacked)
+            return b.unpacked >= w.best_unpacked;
+        return b.unpacked > w.best_unpacked or (b.unpacked == w.best_unpacked and b.trucks >= w.best_trucks);
+    }
+
+    /**
+     * @brief Check if the best schedule found reaches a bound, so that it is proven to be the best
+     *
+     * @param b The bound
+     * @return True or False whether no schedule can be better
+     */
+    bool reaches(const node_bound &b) const
+    {
+        return best_unpacked <= b.unpacked and (objective == exact_objective::least_unpacked or best_trucks <= b.trucks);
+    }
+
+    /**
+     * @brief Bound every schedule below a node. The parcels that fit in no trucks room are left unpacked, the other parcels can only
+     * fill the room left, and the volume that must still be loaded, with at most the best unpacked volume left behind, needs the room
+     * of the used trucks and then of the fewest empty trucks. Each capacity dimension that limits every truck is bounded the same way
+     * when every parcel that fits must be loaded
+     *
+     * @param node The partial schedule
+     * @param best_unpacked The unpacked volume of the best schedule found
+     * @return The lower bound
+     */
+    node_bound bound(const search_node &node, const uint64_t &best_unpacked) const
+    {
+        load_vector most_room{};
+        for (const load_vector &room : node.room)
+        {
+            for (uint64_t d = 0; d < capacity_dimensions; d++)
+                most_room[d] = max(most_room[d], room[d]);
+        }
+        uint64_t forced = 0, rest = 0;
+        load_vector rest_load{};
+        for (uint64_t k = node.next; k < sizes.size(); k++)
+        {
+            if (not fits(sizes[k], most_room))
+            {
+                forced += sizes[k][volume];
+                continue;
+            }
+            rest += sizes[k][volume];
+            for (uint64_t d = 0; d < capacity_dimensions; d++)
+            {
+                if (limited[d])
+                    rest_load[d] += sizes[k][d];
+            }
+        }
+        uint64_t room_volume = 0;
+        for (const load_vector &room : node.room)
+            room_volume += room[volume];
+        node_bound b;
+        b.unpacked = node.unpacked + forced + (rest > room_volume ? rest - room_volume : 0);
+        b.trucks = node.used_count;
+        if (b.unpacked > best_unpacked)
+            return b;
+
+        /* The parcels that fit may leave at most this much volume unpacked and still match the best schedule. */
+        uint64_t allowed = best_unpacked - node.unpacked - forced;
+        for (uint64_t d = 0; d < capacity_dimensions; d++)
+        {
+            if (not limited[d] or (d != volume and allowed != 0))
+                continue;
+            uint64_t need = d == volume ? (rest > allowed ? rest - allowed : 0) : rest_load[d];
+            vector<uint64_t> empty_rooms;
+            for (uint64_t t = 0; t < node.room.size(); t++)
+            {
+                if (node.used[t])
+                    need -= min(need, node.room[t][d]);
+                else
+                    empty_rooms.push_back(node.room[t][d]);
+            }
+            sort(empty_rooms.begin(), empty_rooms.end(), greater<uint64_t>());
+            uint64_t opened = 0;
+            while (need != 0 and opened < empty_rooms.size())
+                need -= min(need, empty_rooms[opened++]);
+            if (need != 0)
+                opened = node.room.size() + 1; // The parcels cannot be loaded at all, so no schedule below matches the best
+            b.trucks = max(b.trucks, node.used_count + opened);
+        }
+        return b;
+    }
+
+    /**
+     * @brief Bound the root, which is also bounded with the L2 bound on the trucks the parcels that must be loaded fit in
+     *
+     * @param root The root of the search tree
+     * @param best_unpacked The unpacked volume of the best schedule found
+     * @return The lower bound
+     */
+    node_bound bound_root(const search_node &root, const uint64_t &best_unpacked) const
+    {
+        node_bound b = bound(root, best_unpacked);
+        if (b.unpacked != best_unpacked)
+            return b;
+        /* Every parcel with a volume that fits some truck is loaded, so the trucks it takes can be bounded as a bin packing. */
+        load_vector most_room{};
+        for (const load_vector &room : root.room)
+        {
+            for (uint64_t d = 0; d < capacity_dimensions; d++)
+                most_room[d] = max(most_room[d], room[d]);
+        }
+        for (uint64_t d = 0; d < capacity_dimensions; d++)
+        {
+            if (not limited[d])
+                continue;
+            vector<uint64_t> loaded_sizes, capacities;
+            for (const load_vector &size : sizes)
+            {
+                if (size[volume] != 0 and fits(size, most_room))
+                    loaded_sizes.push_back(size[d]);
+            }
+            for (const load_vector &room : root.room)
+                capacities.push_back(room[d]);
+            b.trucks = max(b.trucks, fleet_size_bound(loaded_sizes, capacities));
+        }
+        return b;
+    }
+
+    /**
+     * @brief Build a schedule greedily to start the search from, each parcel goes onto the used truck it fills the most, or else
+     * onto the smallest or the largest empty truck it fits on
+     *
+     * @param root The root of the search tree
+     * @param open_largest True or False whether to open the largest empty truck instead of the smallest
+     */
+    void greedy(const search_node &root, const bool &open_largest)
+    {
+        search_node node = root;
+        for (uint64_t k = 0; k < sizes.size(); k++)
+        {
+            uint32_t pick = leave_unpacked;
+            for (uint32_t t = 0; t < node.room.size(); t++)
+            {
+                if (not fits(sizes[k], node.room[t]))
+                    continue;
+                if (pick == leave_unpacked or node.used[t] != node.used[pick])
+                {
+                    if (pick == leave_unpacked or node.used[t])
+                        pick = t;
+                }
+                else if (node.used[t] or not open_largest)
+                {
+                    if (node.room[t][volume] < node.room[pick][volume])
+                        pick = t;
+                }
+                else if (node.room[t][volume] > node.room[pick][volume])
+                    pick = t;
+            }
+            place(node, k, pick);
+        }
+        offer(node);
+    }
+
+    /**
+     * @brief Place the next parcel of a partial schedule
+     *
+     * @param node The partial schedule
+     * @param k The position of the parcel, which is node.next
+     * @param t The truck the parcel goes onto, or leave_unpacked
+     */
+    void place(search_node &node, const uint64_t &k, const uint32_t &t) const
+    {
+        node.choice[k] = t;
+        node.previous = t;
+        node.next = k + 1;
+        if (t == leave_unpacked)
+        {
+            node.unpacked += sizes[k][volume];
+            return;
+        }
+        for (uint64_t d = 0; d < capacity_dimensions; d++)
+            node.room[t][d] -= sizes[k][d];
+        if (not node.used[t])
+        {
+            node.used[t] = 1;
+            node.used_count++;
+        }
+    }
+
+    /**
+     * @brief Take back the placement of the last parcel of a partial schedule
+     *
+     * @param node The partial schedule
+     * @param k The position of the parcel, which is node.next - 1
+     * @param previous The choice made for the parcel before it
+     * @param opened True or False whether the parcel was the first on its truck
+     */
+    void unplace(search_node &node, const uint64_t &k, const uint32_t &previous, const bool &opened) const
+    {
+        uint32_t t = node.choice[k];
+        node.choice[k] = leave_unpacked;
+        node.previous = previous;
+        node.next = k;
+        if (t == leave_unpacked)
+        {
+            node.unpacked -= sizes[k][volume];
+            return;
+        }
+        for (uint64_t d = 0; d < capacity_dimensions; d++)
+            node.room[t][d] += sizes[k][d];
+        if (opened)
+        {
+            node.used[t] = 0;
+            node.used_count--;
+        }
+    }
+
+    /**
+     * @brief Keep a complete schedule if it is better than the best one found, and stop the search once it reaches the root bound
+     *
+     * @param node The complete schedule
+     */
+    void offer(const search_node &node)
+    {
+        lock_guard<mutex> lock(best_mutex);
+        if (not better(node.unpacked, node.used_count, best_unpacked, best_trucks))
+            return;
+        best_unpacked = node.unpacked;
+        best_trucks = node.used_count;
+        best_choice = node.choice;
+    }
+
+    /**
+     * @brief List the choices for the next parcel in the order they are tried: the used trucks it fills the most first, then the
+     * empty trucks from the smallest, then leaving it unpacked. Of trucks with the same room only the first is tried, and a parcel
+     * equal to the one before goes onto the same truck or a later one, or is left unpacked like it
+     *
+     * @param node The partial schedule
+     * @param options Set to the choices
+     */
+    void list_options(const search_node &node, vector<uint32_t> &options) const
+    {
+        options.clear();
+        uint64_t k = node.next;
+        uint32_t first = 0;
+        if (same_as_previous[k])
+        {
+            if (node.previous == leave_unpacked)
+            {
+                options.push_back(leave_unpacked);
+                return;
+            }
+            first = node.previous;
+        }
+        bool count_trucks = objective == exact_objective::fewest_trucks;
+        for (uint32_t t = first; t < node.room.size(); t++)
+        {
+            if (not fits(sizes[k], node.room[t]))
+                continue;
+            bool repeat = false;
+            for (const uint32_t &other : options)
+                repeat = repeat or (same_room(node.room[other], node.room[t]) and (not count_trucks or node.used[other] == node.used[t]));
+            if (not repeat)
+                options.push_back(t);
+        }
+        stable_sort(options.begin(), options.end(), [&node](const uint32_t &a, const uint32_t &b) {
+            if (node.used[a] != node.used[b])
+                return node.used[a] > node.used[b];
+            return node.room[a][volume] < node.room[b][volume];
+        });
+        options.push_back(leave_unpacked);
+    }
+
+    /**
+     * @brief Check if two trucks have the same room in every dimension that limits trucks, the other dimensions never run out
+     *
+     * @param a The room of the first truck
+     * @param b The room of the second truck
+     * @return True or False whether the trucks are interchangeable for every parcel left
+     */
+    bool same_room(const load_vector &a, const load_vector &b) const
+    {
+        for (uint64_t d = 0; d < capacity_dimensions; d++)
+        {
+            if (limited[d] and a[d] != b[d])
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Check if a state was already searched at no higher cost, and remember it otherwise. The state is the next parcel and the
+     * room of the trucks, with whether they are used when trucks are counted. The order of the trucks does not matter, unless the next
+     * parcel is equal to the one before and so depends on the truck that one went onto
+     *
+     * @param node The partial schedule
+     * @param w The search task
+     * @return True or False whether the state was already searched
+     */
+    bool remembered(const search_node &node, worker_state &w) const
+    {
+        bool count_trucks = objective == exact_objective::fewest_trucks;
+        w.records.clear();
+        for (uint64_t t = 0; t < node.room.size(); t++)
+        {
+            array<uint64_t, capacity_dimensions + 1> record;
+            for (uint64_t d = 0; d < capacity_dimensions; d++)
+                record[d] = limited[d] ? node.room[t][d] : 0;
+            record[capacity_dimensions] = count_trucks ? node.used[t] : 0;
+            w.records.push_back(record);
+        }
+        w.key.assign((const char *)&node.next, sizeof(node.next));
+        if (same_as_previous[node.next])
+            w.key.append((const char *)&node.previous, sizeof(node.previous));
+        else
+            sort(w.records.begin(), w.records.end());
+        w.key.append((const char *)w.records.data(), w.records.size() * sizeof(w.records[0]));
+
+        auto found = w.memo.find(w.key);
+        if (found != w.memo.end())
+        {
+            if (found->second.first <= node.unpacked and (not count_trucks or found->second.second <= node.used_count))
+                return true;
+            if (node.unpacked <= found->second.first and node.used_count <= found->second.second)
+                found->second = {node.unpacked, node.used_count};
+            return false;
+        }
+        uint64_t cost = w.key.size() + 64;
+        if (cost <= w.memo_left)
+        {
+            w.memo_left -= cost;
+            w.memo.emplace(w.key, make_pair(node.unpacked, node.used_count));
+        }
+        return false;
+    }
+
+    /**
+     * @brief Search every schedule below a node depth first, cutting the branches that cannot beat the best schedule
+     *
+     * @param node The partial schedule, restored before returning
+     * @param w The search task
+     */
+    void explore(search_node &node, worker_state &w)
+    {
+        if (stopped.load(memory_order_relaxed))
+            return;
+        if (++w.nodes % 256 == 0)
+        {
+            refresh(w);
+            if (deadline != chrono::steady_clock::time_point::max() and chrono::steady_clock::now() >= deadline)
+            {
+                out_of_time = true;
+                stopped = true;
+                return;
+            }
+        }
+        if (node.next == sizes.size())
+        {
+            if (better(node.unpacked, node.used_count, w.best_unpacked, w.best_trucks))
+            {
+                offer(node);
+                refresh(w);
+            }
+            return;
+        }
+        if (cut(bound(node, w.best_unpacked), w) or remembered(node, w))
+            return;
+
+        uint64_t k = node.next;
+        vector<uint32_t> &options = w.options[k];
+        list_options(node, options);
+        uint32_t previous = node.previous;
+        for (const uint32_t &t : options)
+        {
+            bool opened = t != leave_unpacked and not node.used[t];
+            place(node, k, t);
+            explore(node, w);
+            unplace(node, k, previous, opened);
+            if (stopped.load(memory_order_relaxed))
+                return;
+        }
+    }
+
+    /**
+     * @brief Bring a search task's copy of the best schedule value up to date, and stop the search once the root bound is reached
+     *
+     * @param w The search task
+     */
+    void refresh(worker_state &w)
+    {
+        lock_guard<mutex> lock(best_mutex);
+        w.best_unpacked = best_unpacked;
+        w.best_trucks = best_trucks;
+        if (reaches(proven))
+            stopped = true;
+    }
+
+    /**
+     * @brief Split the tree into subtrees, a few for each worker, and search them on the thread pool. The subtrees that were not
+     * finished by the deadline are kept to bound what is left
+     *
+     * @param root The root of the search tree
+     * @param pool The thread pool
+     */
+    void search(const search_node &root, thread_pool &pool)
+    {
+        proven = bound_root(root, best_unpacked);
+        worker_state splitter;
+        refresh(splitter);
+        vector<search_node> frontier = {root};
+        vector<uint32_t> options;
+        uint64_t target = 8 * pool.size();
+        while (frontier.size() < target)
+        {
+            vector<search_node> deeper;
+            bool split = false;
+            for (const search_node &node : frontier)
+            {
+                if (node.next == sizes.size())
+                {
+                    offer(node);
+                    continue;
+                }
+                if (cut(bound(node, splitter.best_unpacked), splitter))
+                    continue;
+                list_options(node, options);
+                for (const uint32_t &t : options)
+                {
+                    deeper.push_back(node);
+                    place(deeper.back(), node.next, t);
+                }
+                split = true;
+            }
+            frontier = move(deeper);
+            refresh(splitter);
+            if (not split)
+                break;
+        }
+
+        vector<uint8_t> finished(frontier.size(), 0);
+        uint64_t memo_share = memo_bytes / max<uint64_t>(pool.size(), 1);
+        thread_pool::task_group subtrees(pool);
+        for (uint64_t i = 0; i < frontier.size(); i++)
+        {
+            subtrees.submit([this, &frontier, &finished, memo_share, i] {
+                worker_state w;
+                w.memo_left = memo_share;
+                w.options.resize(sizes.size());
+                refresh(w);
+                search_node node = frontier[i];
+                explore(node, w);
+                finished[i] = not out_of_time;
+                total_nodes += w.nodes;
+                PROFILE_COUNT(exact_nodes, w.nodes);
+            });
+        }
+        subtrees.wait();
+        for (uint64_t i = 0; i < frontier.size(); i++)
+        {
+            if (not finished[i])
+                unfinished.push_back(move(frontier[i]));
+        }
+    }
+
+    /**
+     * @brief Load the trucks with the best schedule, each truck takes its parcels in the order they were read
+     *
+     * @return The parcels that are left unpacked
+     */
+    vector<parcels> load_best()
+    {
+        vector<uint32_t> truck_of(parcel_list.size(), leave_unpacked);
+        for (uint64_t k = 0; k < best_choice.size(); k++)
+            truck_of[order[k]] = best_choice[k];
+        vector<parcels> not_packed_parcels;
+        for (uint64_t i = 0; i < parcel_list.size(); i++)
+        {
+            if (truck_of[i] == leave_unpacked or not truck_list[truck_of[i]].pack_truck(parcel_list[i]))
+                not_packed_parcels.push_back(parcel_list[i]);
+        }
+        return not_packed_parcels;
+    }
+
+    /**
+     * @brief The trucks and parcels being scheduled, and what is minimized by when
+     *
+     */
+    item_span<trucks> truck_list;
+    item_span<const parcels> parcel_list;
+    exact_objective objective = exact_objective::least_unpacked;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    uint64_t memo_bytes = 1ULL << 27;
+    /**
+     * @brief The parcels in placing order, their loads, if each is equal to the one before, and the dimensions every truck is limited in
+     *
+     */
+    vector<uint64_t> order;
+    vector<load_vector> sizes;
+    vector<bool> same_as_previous;
+    array<bool, capacity_dimensions> limited{};
+    /**
+     * @brief The best schedule found, as the truck of each parcel in placing order, and its value, shared by the search tasks
+     *
+     */
+    mutex best_mutex;
+    vector<uint32_t> best_choice;
+    uint64_t best_unpacked = numeric_limits<uint64_t>::max(), best_trucks = numeric_limits<uint64_t>::max();
+    node_bound proven; // The root bound, the search stops once the best schedule reaches it
+    /**
+     * @brief The progress of the search, the subtrees left unfinished at the deadline, and the result of the last search
+     *
+     */
+    atomic<uint64_t> total_nodes{0};
+    atomic<bool> stopped{false}, out_of_time{false};
+    vector<search_node> unfinished;
+    exact_result report;
+};
+
+/**
+ * @brief Schedule parcels onto trucks with the exact packer. The trucks and parcels of each depot are packed on their own, one depot
+ * after another with the search of each spread over the thread pool, and each depot gets an equal share of the time that is left
+ *
+ * @param parcel_list The list of parcels to be loaded on trucks and delivered
+ * @param truck_list The list of trucks available for delivering parcels, each with its own depot
+ * @param dmap The distance map used to find the depot that owns each parcel
+ * @param pool The thread pool the search runs on. The search waits only for its own subtrees, and may be run from a task running on the pool
+ * @param objective What the packer minimizes
+ * @param deadline The time by which the search must stop, no limit by default
+ * @param result Set to the value of the schedule and how far it is proven to be from the best, summed over the depots, if not nullptr
+ * @return A list of parcels that could not get loaded on trucks
+ */
+vector<parcels> schedule_exact(const item_span<const parcels> &parcel_list, const item_span<trucks> &truck_list, const distanceMap &dmap, thread_pool &pool, const exact_objective &objective = exact_objective::least_unpacked, const chrono::steady_clock::time_point &deadline = chrono::steady_clock::time_point::max(), exact_result *result = nullptr)
+{
+    if (needs_timing(parcel_list, truck_list))
+        throw exact_invalidation::unsupported_error("with delivery windows or shift limits");
+    exact_result total;
+    total.objective = objective;
+    total.optimal = true;
+    auto schedule_depot = [&](const item_span<const parcels> &own_parcels, const item_span<trucks> &own_trucks, const uint64_t &depots_left) {
+        exact_packer packer(own_parcels, own_trucks);
+        packer.set_objective(objective);
+        if (deadline != chrono::steady_clock::time_point::max())
+        {
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            packer.set_deadline(deadline > now ? now + (deadline - now) / (int64_t)depots_left : now);
+        }
+        vector<parcels> unpacked = packer.schedule(pool);
+        total.add(packer.result());
+        return unpacked;
+    };
+
+    /* A single depot owns every parcel, so its trucks and parcels are packed in place. */
+    bool one_depot = shares_one_depot(truck_list);
+    vector<parcels> not_packed_parcels;
+    if (one_depot)
+        not_packed_parcels = schedule_depot(parcel_list, truck_list, 1);
+    else
+    {
+        depot_workspace w;
+        split_trucks(truck_list, w);
+        for (uint64_t i = 0; i < parcel_list.size(); i++)
+        {
+            uint64_t d = owning_depot(parcel_list[i], w.depots, dmap);
+            if (d != w.depots.size())
+            {
+                w.depot_parcel_index[d].push_back(i);
+                continue;
+            }
+            /* No depot can reach the parcel, so every schedule leaves it unpacked. */
+            not_packed_parcels.push_back(parcel_list[i]);
+            total.unpacked_volume += parcel_list[i].load()[(uint64_t)capacity_dimension::volume];
+            total.unpacked_volume_bound += parcel_list[i].load()[(uint64_t)capacity_dimension::volume];
+        }
+        for (uint64_t d = 0; d < w.depots.size(); d++)
+        {
+            place_depot(truck_list, parcel_list, w, d);
+            w.depot_unpacked[d] = schedule_depot(w.depot_parcels[d], w.depot_trucks[d], w.depots.size() - d);
+        }
+        gather_trucks(truck_list, w);
+        for (uint64_t d = 0; d < w.depots.size(); d++)
+            not_packed_parcels.insert(not_packed_parcels.end(), w.depot_unpacked[d].begin(), w.depot_unpacked[d].end());
+    }
+    if (result)
+        *result = total;
+    return not_packed_parcels;
+}
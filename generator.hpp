@@ -0,0 +1,259 @@
+/**
+ * @file generator.hpp
+ * @author Cassandra Masschelein
+ * @brief Generate deterministic synthetic maps, fleets, and parcels for measuring the schedulers at scale
+ * @version 0.1
+ * @date 2022-01-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "loader.hpp"
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief The distributions that synthetic parcel volumes can be drawn from
+ *
+ */
+enum class volume_distribution
+{
+    uniform,     // Every volume between the smallest and largest volume is equally likely
+    exponential, // Mostly small parcels with a long tail of large parcels
+    bimodal      // A mix of many small parcels and a few large parcels
+};
+
+/**
+ * @brief The size and shape of a synthetic instance
+ *
+ */
+struct instance_spec
+{
+    uint64_t cities = 50;  // The number of cities on the map
+    uint64_t trucks = 20;  // The number of trucks in the fleet
+    uint64_t parcels = 1000; // The number of parcels to be delivered
+    uint64_t depots = 1;   // The number of depots, the trucks are spread evenly over the first cities
+    uint64_t neighbours = 0; // The number of nearest cities each city has a road to, 0 for a road between every pair of cities
+    uint64_t min_volume = 1, max_volume = 50; // The range of parcel volumes (in cm^3)
+    uint64_t min_capacity = 200, max_capacity = 1000; // The range of truck capacities (in cm^3)
+    uint64_t max_weight = 0; // The largest parcel weight (in kg), 0 for parcels and trucks without weight
+    uint64_t transfer_percent = 0; // The percentage of parcels picked up at a random city instead of at a depot
+    uint64_t shift_minutes = 0; // The shift limit of every truck, 0 for trucks without a shift limit and parcels without time windows
+    uint64_t cost_per_km = 0; // The cost per km (in cents) of the largest trucks, 0 for trucks that cost nothing to run
+    volume_distribution distribution = volume_distribution::uniform;
+    uint64_t seed = 1; // The same seed always generates the same instance
+};
+
+/**
+ * @brief A synthetic map, fleet, and set of parcels
+ *
+ */
+struct instance
+{
+    vector<string> cities;
+    vector<map_entry> map_entries;
+    vector<trucks> truck_list;
+    vector<parcels> parcel_list;
+};
+
+/**
+ * @brief Create a city name that passes the data file validation, which only allows alphabet characters
+ *
+ * @param index The index of the city
+ * @return A capitalized name that is unique to this index
+ */
+string city_name(uint64_t index)
+{
+    string name = "C";
+    do
+    {
+        name.push_back((char)('a' + index % 26));
+        index /= 26;
+    } while (index != 0);
+    return name;
+}
+
+/**
+ * @brief Parse the name of a volume distribution
+ *
+ * @param name One of uniform, exponential, or bimodal
+ * @return The volume distribution
+ */
+volume_distribution parse_distribution(const string &name)
+{
+    if (name == "uniform")
+        return volume_distribution::uniform;
+    if (name == "exponential")
+        return volume_distribution::exponential;
+    if (name == "bimodal")
+        return volume_distribution::bimodal;
+    throw invalid_argument("Unknown volume distribution: " + name);
+}
+
+/**
+ * @brief Generate a synthetic instance. Cities are points in a square so the distances form a metric space
+ *
+ * @param spec The size and shape of the instance
+ * @return The generated instance
+ */
+instance generate_instance(const instance_spec &spec)
+{
+    if (spec.cities < 2 or spec.depots == 0 or spec.depots > spec.cities or spec.min_volume > spec.max_volume or spec.min_capacity > spec.max_capacity)
+        throw invalid_argument("The instance specification is not valid!");
+
+    instance generated;
+    mt19937_64 rng(spec.seed);
+    uniform_real_distribution<double> coordinate(0.0, 1000.0);
+
+    /* Place the cities and connect them by the rounded straight line distance between them. */
+    vector<double> x(spec.cities), y(spec.cities);
+    for (uint64_t i = 0; i < spec.cities; i++)
+    {
+        generated.cities.push_back(city_name(i));
+        x[i] = coordinate(rng);
+        y[i] = coordinate(rng);
+    }
+    auto straight_line = [&x, &y](const uint64_t &i, const uint64_t &j) { return max<uint64_t>(1, (uint64_t)llround(hypot(x[i] - x[j], y[i] - y[j]))); };
+    if (spec.neighbours == 0 or spec.neighbours + 1 >= spec.cities)
+    {
+        generated.map_entries.reserve(spec.cities * (spec.cities - 1) / 2);
+        for (uint64_t i = 0; i < spec.cities; i++)
+        {
+            for (uint64_t j = i + 1; j < spec.cities; j++)
+                generated.map_entries.push_back({generated.cities[i], generated.cities[j], straight_line(i, j)});
+        }
+    }
+    else
+    {
+        /* A sparse road network: each city has roads to its nearest cities, and a chain of roads keeps the network connected. */
+        vector<pair<uint64_t, uint64_t> > nearest(spec.cities);
+        for (uint64_t i = 0; i < spec.cities; i++)
+        {
+            for (uint64_t j = 0; j < spec.cities; j++)
+                nearest[j] = {straight_line(i, j), j};
+            partial_sort(nearest.begin(), nearest.begin() + (int64_t)spec.neighbours + 1, nearest.end());
+            for (uint64_t k = 1; k <= spec.neighbours; k++)
+                generated.map_entries.push_back({generated.cities[i], generated.cities[nearest[k].second], nearest[k].first});
+            if (i + 1 < spec.cities)
+                generated.map_entries.push_back({generated.cities[i], generated.cities[i + 1], straight_line(i, i + 1)});
+        }
+    }
+
+    /* Spread the trucks evenly over the depots. A truck with weight is limited to about the weight of the parcels that fill its volume, so either limit can be reached first. */
+    uniform_int_distribution<uint64_t> capacity(spec.min_capacity, spec.max_capacity);
+    generated.truck_list.reserve(spec.trucks);
+    for (uint64_t i = 0; i < spec.trucks; i++)
+    {
+        uint64_t truck_volume = capacity(rng);
+        if (spec.max_weight == 0)
+            generated.truck_list.emplace_back(i, truck_volume, generated.cities[i % spec.depots]);
+        else
+        {
+            uint64_t truck_weight = max<uint64_t>(1, truck_volume * spec.max_weight / (spec.min_volume + spec.max_volume));
+            generated.truck_list.emplace_back(i, load_vector{truck_volume, truck_weight, unlimited_capacity}, generated.cities[i % spec.depots]);
+        }
+        if (spec.shift_minutes != 0)
+            generated.truck_list.back().set_max_duration(spec.shift_minutes);
+        /* Larger trucks cost more per km, and sending a truck out costs about as much as driving it 100 km. */
+        if (spec.cost_per_km != 0)
+        {
+            uint64_t per_km = max<uint64_t>(1, spec.cost_per_km * truck_volume / spec.max_capacity);
+            generated.truck_list.back().set_costs(per_km * 100, per_km);
+        }
+    }
+
+    /* Draw the parcel volumes from the chosen distribution. */
+    uint64_t range = spec.max_volume - spec.min_volume;
+    uniform_int_distribution<uint64_t> uniform_volume(spec.min_volume, spec.max_volume);
+    uniform_int_distribution<uint64_t> small_volume(spec.min_volume, spec.min_volume + range / 5);
+    uniform_int_distribution<uint64_t> large_volume(spec.max_volume - range / 5, spec.max_volume);
+    exponential_distribution<double> tail(4.0 / (double)max<uint64_t>(range, 1));
+    bernoulli_distribution is_large(0.2);
+    uniform_int_distribution<uint64_t> weight(1, max<uint64_t>(spec.max_weight, 1));
+    uniform_int_distribution<uint64_t> city(0, spec.cities - 1);
+    uniform_int_distribution<uint64_t> percent(0, 99);
+    uniform_int_distribution<uint64_t> window_opens(0, spec.shift_minutes - spec.shift_minutes / 4); // A window lasts a quarter of the shift
+    generated.parcel_list.reserve(spec.parcels);
+    for (uint64_t i = 0; i < spec.parcels; i++)
+    {
+        uint64_t volume;
+        if (spec.distribution == volume_distribution::uniform)
+            volume = uniform_volume(rng);
+        else if (spec.distribution == volume_distribution::exponential)
+            volume = min(spec.max_volume, spec.min_volume + (uint64_t)tail(rng));
+        else
+            volume = is_large(rng) ? large_volume(rng) : small_volume(rng);
+
+        uint64_t source = city(rng) % spec.depots; // Parcels are picked up at a depot, except for transfers between cities
+        if (spec.transfer_percent != 0 and percent(rng) < spec.transfer_percent)
+            source = city(rng);
+        uint64_t dest = city(rng);
+        if (dest == source)
+            dest = (dest + 1) % spec.cities;
+        load_vector parcel_load{volume, spec.max_weight == 0 ? 0 : weight(rng), 0};
+        time_window window;
+        if (spec.shift_minutes != 0)
+        {
+            window.earliest = window_opens(rng);
+            window.latest = window.earliest + spec.shift_minutes / 4;
+        }
+        generated.parcel_list.emplace_back(i, parcel_load, generated.cities[source], generated.cities[dest], window);
+    }
+    return generated;
+}
+
+/**
+ * @brief Write an instance as a truck data file, a parcel data file, and a map data file
+ *
+ * @param generated The instance to be written
+ * @param truck_path The path of the truck data file
+ * @param parcel_path The path of the parcel data file
+ * @param map_path The path of the map data file
+ */
+void write_instance(const instance &generated, const string &truck_path, const string &parcel_path, const string &map_path)
+{
+    ofstream truck_file(truck_path), parcel_file(parcel_path), map_file(map_path);
+    if (!truck_file.is_open() or !parcel_file.is_open() or !map_file.is_open())
+        throw file_invalidation::data_error("Error opening output files for the synthetic instance!");
+
+    const uint64_t weight_dimension = (uint64_t)capacity_dimension::weight;
+    for (const trucks &truck : generated.truck_list)
+    {
+        truck_file << truck.my_id() << ", " << truck.volume() << ", " << truck.home_depot();
+        /* The weight limit, pallet slots, shift limit, and costs are left empty if the truck has none, up to the last one it has. */
+        vector<string> optional = {truck.limits()[weight_dimension] != unlimited_capacity ? to_string(truck.limits()[weight_dimension]) : "", "",
+                                   truck.max_duration() != unlimited_time ? to_string(truck.max_duration()) : "",
+                                   truck.fixed_cost() != 0 ? to_string(truck.fixed_cost()) : "", truck.km_cost() != 0 ? to_string(truck.km_cost()) : ""};
+        while (not optional.empty() and optional.back().empty())
+            optional.pop_back();
+        for (const string &value : optional)
+        {
+            truck_file << ",";
+            if (not value.empty())
+                truck_file << " " << value;
+        }
+        truck_file << "\n";
+    }
+    for (const parcels &parcel : generated.parcel_list)
+    {
+        parcel_file << parcel.this_id() << ", " << parcel.where_from() << ", " << parcel.where_to() << ", " << parcel.volume();
+        if (not parcel.window().unconstrained())
+            parcel_file << ", " << parcel.load()[weight_dimension] << ", 0, " << parcel.window().earliest << ", " << parcel.window().latest;
+        else if (parcel.load()[weight_dimension] != 0)
+            parcel_file << ", " << parcel.load()[weight_dimension];
+        parcel_file << "\n";
+    }
+    for (const map_entry &entry : generated.map_entries)
+        map_file << entry.city_1 << ", " << entry.city_2 << ", " << entry.distance << "\n";
+}
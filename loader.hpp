@@ -0,0 +1,826 @@
+/**
+ * @file loader.hpp
+ * @author Cassandra Masschelein
+ * @brief Read and validate the truck, parcel, and map data files
+ * @version 0.1
+ * @date 2022-01-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "profile.hpp"
+#include "thread_pool.hpp"
+#include "decompress.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <optional>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <charconv>
+
+using namespace std;
+
+/**
+ * @brief Unique error messages for invalid data files
+ *
+ */
+namespace file_invalidation
+{
+    /**
+     * @brief Error message for when a data file cannot be opened or contains invalid data
+     *
+     */
+    class data_error : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new data error object
+         *
+         * @param message A description of the problem, including the file and line where it was found
+         */
+            explicit data_error(const string &message) : invalid_argument(message){};
+    };
+}
+
+/**
+ * @brief An entry of the map data file, the distance between two cities
+ *
+ */
+struct map_entry
+{
+    string city_1, city_2;
+    uint64_t distance;
+};
+
+/**
+ * @brief Unique error messages for invalid entries, which say where in the entry the problem is
+ *
+ */
+namespace file_invalidation
+{
+    /**
+     * @brief Error message for an entry with a character that does not belong in it
+     *
+     */
+    class field_error : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new field error object
+         *
+         * @param reason Why the entry is invalid
+         * @param _offset The position of the first invalid character in the entry
+         */
+            field_error(const string &reason, const uint64_t &_offset) : invalid_argument(reason), offset(_offset){};
+
+            uint64_t offset;
+    };
+}
+
+/**
+ * @brief Check that every character of an entry from a position on is a letter. Each character is compared to the letter ranges
+ * and the results are combined without branching, so the compiler checks many characters at once
+ *
+ * @param entry The entry
+ * @param first The position of the first character to check
+ * @return The position of the first character that is not a letter, or the length of the entry if they all are
+ */
+uint64_t first_non_letter(const string &entry, const uint64_t &first)
+{
+    uint8_t bad = 0;
+    for (uint64_t i = first; i < entry.size(); i++)
+        bad |= (uint8_t)((uint8_t)(((uint8_t)entry[i] | 0x20) - 'a') > 25);
+    if (bad == 0)
+        return entry.size();
+    uint64_t i = first;
+    while ((uint8_t)(((uint8_t)entry[i] | 0x20) - 'a') <= 25)
+        i++;
+    return i;
+}
+
+/**
+ * @brief Check that every character of an entry from a position on is a digit, in the same way as first_non_letter
+ *
+ * @param entry The entry
+ * @param first The position of the first character to check
+ * @return The position of the first character that is not a digit, or the length of the entry if they all are
+ */
+uint64_t first_non_digit(const string &entry, const uint64_t &first)
+{
+    uint8_t bad = 0;
+    for (uint64_t i = first; i < entry.size(); i++)
+        bad |= (uint8_t)((uint8_t)((uint8_t)entry[i] - '0') > 9);
+    if (bad == 0)
+        return entry.size();
+    uint64_t i = first;
+    while ((uint8_t)((uint8_t)entry[i] - '0') <= 9)
+        i++;
+    return i;
+}
+
+/**
+ * @brief The position of the first character of an entry after its leading space character, if it has one
+ *
+ * @param entry The comma separated value
+ * @return 1 if the entry starts with a space character, and 0 otherwise
+ */
+uint64_t entry_start(const string &entry)
+{
+    return (not entry.empty() and isspace((unsigned char)entry[0])) ? 1 : 0;
+}
+
+/**
+ * @brief Validate a city name entry, ignoring a leading space character
+ *
+ * @param entry The comma separated value
+ * @return The city name
+ */
+string read_city(const string &entry)
+{
+    uint64_t first = entry_start(entry);
+    uint64_t bad = first_non_letter(entry, first);
+    if (bad != entry.size())
+        throw file_invalidation::field_error("City name must only contain alphabet characters!", bad);
+    return entry.substr(first);
+}
+
+/**
+ * @brief Validate a whole number entry, ignoring a leading space character
+ *
+ * @param entry The comma separated value
+ * @return The value of the number
+ */
+uint64_t read_number(const string &entry)
+{
+    uint64_t first = entry_start(entry);
+    uint64_t bad = first_non_digit(entry, first);
+    if (bad != entry.size())
+        throw file_invalidation::field_error("Numbers must only contain digits!", bad);
+    if (first == entry.size())
+        throw invalid_argument("Numbers must contain at least one digit!");
+    uint64_t number = 0;
+    from_chars_result end = from_chars(entry.data() + first, entry.data() + entry.size(), number);
+    if (end.ec == errc::result_out_of_range)
+        throw out_of_range("The number is too large!");
+    return number;
+}
+
+/**
+ * @brief Validate a whole number entry that may be left empty, such as a limit that does not apply
+ *
+ * @param entry The comma separated value
+ * @param none The value of an empty entry
+ * @return The value of the number, or none if the entry is empty
+ */
+uint64_t read_limit(const string &entry, const uint64_t &none)
+{
+    if (entry.empty() or (entry.size() == 1 and isspace((unsigned char)entry[0])))
+        return none;
+    return read_number(entry);
+}
+
+/**
+ * @brief The most invalid entries listed in the error for a data file, the rest are only counted
+ *
+ */
+const uint64_t max_reported_errors = 20;
+
+/**
+ * @brief Collects the invalid entries of a data file, so that every bad line is found in one pass over the file. Only the first few
+ * are kept, and the rest are counted
+ *
+ */
+class validation_report
+{
+public:
+    /**
+     * @brief Construct a new validation report object
+     *
+     * @param _file_name The name of the data file
+     * @param _max_errors The most errors kept
+     */
+    explicit validation_report(const string &_file_name, const uint64_t &_max_errors = max_reported_errors) : file_name(_file_name), max_errors(_max_errors) {}
+
+    /**
+     * @brief Record an invalid entry
+     *
+     * @param entry The entry, or the whole line for a problem with the line
+     * @param line_number The line of the file the entry was found on
+     * @param column The column of the first invalid character (starting from 1)
+     * @param reason Why the entry is invalid
+     */
+    void add(const string &entry, const uint64_t &line_number, const uint64_t &column, const string &reason)
+    {
+        if (total++ < max_errors)
+            errors.push_back("Invalid data entry: " + entry + " found on line " + to_string(line_number) + ", column " + to_string(column) + " of the " + file_name + " file. " + reason);
+    }
+
+    /**
+     * @brief Record a number that is too large
+     *
+     * @param entry The entry
+     * @param line_number The line of the file the entry was found on
+     * @param column The column the entry starts at (starting from 1)
+     */
+    void add_out_of_range(const string &entry, const uint64_t &line_number, const uint64_t &column)
+    {
+        if (total++ < max_errors)
+            errors.push_back("Number out of range: " + entry + " found on line " + to_string(line_number) + ", column " + to_string(column) + " of the " + file_name + " file.");
+    }
+
+    /**
+     * @brief Throw an error that lists the invalid entries, if there were any
+     *
+     */
+    void raise() const
+    {
+        if (total == 0)
+            return;
+        string message;
+        for (const string &error : errors)
+            message += (message.empty() ? "" : "\n") + error;
+        if (total > errors.size())
+            message += "\n" + to_string(total - errors.size()) + " more invalid entries were found in the " + file_name + " file.";
+        throw file_invalidation::data_error(message);
+    }
+
+    /**
+     * @brief The number of invalid entries found
+     *
+     * @return The number of invalid entries, including the ones that were not kept
+     */
+    uint64_t count() const
+    {
+        return total;
+    }
+
+private:
+    string file_name;
+    uint64_t max_errors;
+    uint64_t total = 0;
+    vector<string> errors;
+};
+
+/**
+ * @brief Split each line of a data file by comma delimeter and validate the number of entries. A line with an invalid entry is
+ * recorded and skipped, and the rest of the file is still read, so that the error lists every bad line
+ *
+ * @tparam entry_reader A function that is given each entry of a row with its position
+ * @tparam row_reader A function that is given the line number of each finished row
+ * @param in The stream to read from
+ * @param file_name The name of the data file, for error messages
+ * @param min_entries The smallest number of entries on a line
+ * @param max_entries The largest number of entries on a line
+ * @param read_entry Called with each entry and its position on the line (starting from 1)
+ * @param end_row Called once all entries of a line have been read
+ * @param skip_row Called instead of end_row for a line with an invalid entry, so the row can be cleared
+ */
+template <class entry_reader, class row_reader, class row_skipper>
+void read_rows(istream &in, const string &file_name, const uint64_t &min_entries, const uint64_t &max_entries, entry_reader read_entry, row_reader end_row, row_skipper skip_row)
+{
+    validation_report report(file_name);
+    string line, entry; // A line is a row, and an entry is a comma separated value
+    uint64_t line_number = 0;
+    while (getline(in, line))
+    {
+        line_number++;
+        if (line.empty()) // Skip blank lines, such as a trailing newline at the end of the file
+            continue;
+        uint64_t arg_counter = 0;
+        bool valid = true;
+        /* Split the line in place rather than through a stringstream, which takes a lock on the locale that shards read at the same time would share. */
+        for (uint64_t start = 0; start < line.size() and valid;)
+        {
+            uint64_t comma = min<uint64_t>(line.find(',', start), line.size());
+            entry.assign(line, start, comma - start);
+            uint64_t column = start + 1;
+            start = comma + 1;
+            arg_counter++;
+            if (arg_counter > max_entries) // Check that a line in the data file has the correct number of entries
+            {
+                report.add(entry, line_number, column, "Too many data entries!");
+                valid = false;
+                break;
+            }
+            PROFILE_COUNT(fields_validated, 1);
+            try
+            {
+                read_entry(entry, arg_counter);
+            }
+            catch (const out_of_range &)
+            {
+                report.add_out_of_range(entry, line_number, column);
+                valid = false;
+            }
+            catch (const file_invalidation::field_error &ex)
+            {
+                report.add(entry, line_number, column + ex.offset, ex.what());
+                valid = false;
+            }
+            catch (const invalid_argument &ex)
+            {
+                report.add(entry, line_number, column, ex.what());
+                valid = false;
+            }
+        }
+        if (valid and arg_counter < min_entries)
+        {
+            report.add(line, line_number, line.size() + 1, "Too few data entries!");
+            valid = false;
+        }
+        if (valid)
+        {
+            try
+            {
+                end_row(line_number);
+            }
+            catch (const invalid_argument &ex)
+            {
+                report.add(line, line_number, 1, ex.what());
+                valid = false;
+            }
+        }
+        if (not valid)
+            skip_row();
+    }
+    report.raise();
+}
+
+/**
+ * @brief Read the trucks from a truck data stream. Each line holds an ID, a capacity, and optionally a depot, a weight limit, a number
+ * of pallet slots, a shift limit in minutes, a dispatch cost, and a cost per km, both in cents. The depot may be left empty for a truck
+ * that starts from the common depot, a limit may be left empty for a truck that is not limited by it, and a cost may be left empty for
+ * a truck that does not have it
+ *
+ * @param in The stream to read from
+ * @param common_depot The depot of trucks that do not name their own depot, may be empty
+ * @param file_name The name of the data file, for error messages
+ * @return The trucks in the order they were read
+ */
+vector<trucks> read_trucks(istream &in, const string &common_depot, const string &file_name = "truck-data.csv")
+{
+    vector<trucks> list_of_trucks;
+    unordered_set<uint64_t> unique_truck; // Make sure all trucks have a unique ID
+    uint64_t truck_id = 0;
+    load_vector limits;
+    limits.fill(unlimited_capacity);
+    uint64_t shift = unlimited_time, fixed_cost = 0, km_cost = 0;
+    string depot;
+    auto clear_row = [&] {
+        limits.fill(unlimited_capacity);
+        shift = unlimited_time;
+        fixed_cost = km_cost = 0;
+        depot.clear();
+    };
+    read_rows(in, file_name, 2, 5 + capacity_dimensions,
+              [&](const string &entry, const uint64_t &position) {
+                  if (position == 1)
+                      truck_id = read_number(entry);
+                  else if (position == 2)
+                      limits[(uint64_t)capacity_dimension::volume] = read_number(entry);
+                  else if (position == 3) // The depot city name
+                      depot = read_city(entry);
+                  else if (position < 3 + capacity_dimensions) // The limits of the other capacity dimensions
+                      limits[position - 3] = read_limit(entry, unlimited_capacity);
+                  else if (position == 3 + capacity_dimensions) // The shift limit
+                      shift = read_limit(entry, unlimited_time);
+                  else if (position == 4 + capacity_dimensions)
+                      fixed_cost = read_limit(entry, 0);
+                  else
+                      km_cost = read_limit(entry, 0);
+              },
+              [&](const uint64_t &) {
+                  const string &truck_depot = depot.empty() ? common_depot : depot;
+                  if (truck_depot.empty())
+                      throw invalid_argument("Truck " + to_string(truck_id) + " does not name a depot and no common depot was given!");
+                  if (not unique_truck.insert(truck_id).second)
+                      throw invalid_argument("The truck ID must be unique!");
+                  list_of_trucks.emplace_back(truck_id, limits, truck_depot);
+                  list_of_trucks.back().set_max_duration(shift);
+                  list_of_trucks.back().set_costs(fixed_cost, km_cost);
+                  clear_row();
+              },
+              clear_row);
+    return list_of_trucks;
+}
+
+/**
+ * @brief Read the parcels from a parcel data stream. Each line holds an ID, a source city, a destination city, a volume, and optionally a weight,
+ * a number of pallet slots, and the earliest and latest delivery times in minutes from the start of the day. The latest time may be left
+ * empty for a window that never closes
+ *
+ * @tparam parcel_visitor A function taking each parcel
+ * @param in The stream to read from
+ * @param file_name The name of the data file, for error messages
+ * @param unique_parcel The IDs read so far, from this stream and any read before it, so that every parcel has a unique ID
+ * @param visit The function given each valid parcel in the order they were read, so that the parcels need not be held together
+ */
+template <class parcel_visitor>
+void read_parcels_each(istream &in, const string &file_name, unordered_set<uint64_t> &unique_parcel, parcel_visitor visit)
+{
+    uint64_t parcel_id = 0;
+    load_vector parcel_load{};
+    time_window window;
+    string from_city, to_city;
+    auto clear_row = [&] {
+        parcel_load.fill(0);
+        window = time_window();
+    };
+    read_rows(in, file_name, 4, 5 + capacity_dimensions,
+              [&](const string &entry, const uint64_t &position) {
+                  if (position == 1)
+                      parcel_id = read_number(entry);
+                  else if (position == 2)
+                      from_city = read_city(entry);
+                  else if (position == 3)
+                      to_city = read_city(entry);
+                  else if (position < 4 + capacity_dimensions) // The room taken up in each capacity dimension, starting with volume
+                      parcel_load[position - 4] = read_number(entry);
+                  else if (position == 4 + capacity_dimensions)
+                      window.earliest = read_number(entry);
+                  else
+                      window.latest = read_limit(entry, unlimited_time);
+              },
+              [&](const uint64_t &) {
+                  if (not unique_parcel.insert(parcel_id).second)
+                      throw invalid_argument("The parcel ID must be unique!");
+                  if (window.earliest > window.latest)
+                      throw invalid_argument("The delivery window of parcel " + to_string(parcel_id) + " closes before it opens!");
+                  visit(parcels(parcel_id, parcel_load, from_city, to_city, window));
+                  clear_row();
+              },
+              clear_row);
+}
+
+/**
+ * @brief Read the parcels from a parcel data stream, in the format read by read_parcels_each
+ *
+ * @param in The stream to read from
+ * @param file_name The name of the data file, for error messages
+ * @return The parcels in the order they were read
+ */
+vector<parcels> read_parcels(istream &in, const string &file_name = "parcel-data.csv")
+{
+    vector<parcels> list_of_parcels;
+    unordered_set<uint64_t> unique_parcel; // Make sure all parcels have a unique ID
+    read_parcels_each(in, file_name, unique_parcel, [&list_of_parcels](parcels &&parcel) { list_of_parcels.push_back(move(parcel)); });
+    return list_of_parcels;
+}
+
+/**
+ * @brief Read the entries of a map data stream. Each line holds two cities and the distance between them
+ *
+ * @param in The stream to read from
+ * @param file_name The name of the data file, for error messages
+ * @return The map entries in the order they were read
+ */
+vector<map_entry> read_map(istream &in, const string &file_name = "map-data.csv")
+{
+    vector<map_entry> map_entries;
+    map_entry row;
+    read_rows(in, file_name, 3, 3,
+              [&](const string &entry, const uint64_t &position) {
+                  if (position == 1)
+                      row.city_1 = read_city(entry);
+                  else if (position == 2)
+                      row.city_2 = read_city(entry);
+                  else
+                      row.distance = read_number(entry);
+              },
+              [&](const uint64_t &) {
+                  map_entries.push_back(row);
+              },
+              [] {});
+    return map_entries;
+}
+
+/**
+ * @brief A data file opened for reading. A file compressed with gzip or zstd is decompressed as it is read
+ *
+ */
+class data_file : public istream
+{
+public:
+    /**
+     * @brief Open a data file
+     *
+     * @param _path The path of the data file
+     */
+    explicit data_file(const string &_path) : istream(nullptr), path(_path)
+    {
+        compression kind = compression_of(path);
+        if (kind == compression::gzip and not gzip_decoder::available)
+            throw file_invalidation::data_error("The data file " + path + " is compressed with gzip, compile with -DFEDEX_ZLIB and link with -lz to read it!");
+        if (kind == compression::zstd and not zstd_decoder::available)
+            throw file_invalidation::data_error("The data file " + path + " is compressed with zstd, compile with -DFEDEX_ZSTD and link with -lzstd to read it!");
+        if (not plain.open(path, ios::in))
+            throw file_invalidation::data_error("Error opening data file " + path + "!");
+        if (kind == compression::none)
+            rdbuf(&plain);
+        else
+        {
+            plain.close();
+            inflater = make_unique<decompressing_buffer>(path, kind);
+            rdbuf(inflater.get());
+        }
+    }
+
+    /**
+     * @brief Check that the whole file was read, which for a compressed file means that it was decompressed without errors
+     *
+     */
+    void finish() const
+    {
+        string reason = inflater ? inflater->error() : "";
+        if (not reason.empty())
+            throw file_invalidation::data_error("Error decompressing data file " + path + ": " + reason);
+    }
+
+private:
+    string path;
+    filebuf plain;
+    unique_ptr<decompressing_buffer> inflater;
+};
+
+/**
+ * @brief Read a data file with a stream reader. If a compressed file is damaged, the parser may see it end part way through a line, so
+ * the decompression error is reported rather than the invalid entry it caused
+ *
+ * @tparam stream_reader A function that reads the contents of a stream
+ * @param path The path of the data file
+ * @param read The stream reader
+ * @return The contents of the file
+ */
+template <class stream_reader>
+auto read_data_file(const string &path, stream_reader read)
+{
+    data_file data(path);
+    auto contents = [&] {
+        try
+        {
+            return read(data);
+        }
+        catch (const file_invalidation::data_error &)
+        {
+            data.finish();
+            throw;
+        }
+    }();
+    data.finish();
+    return contents;
+}
+
+/**
+ * @brief Read the trucks from a truck data file
+ *
+ * @param path The path of the truck data file
+ * @param common_depot The depot of trucks that do not name their own depot, may be empty
+ * @return The trucks in the order they were read
+ */
+vector<trucks> read_truck_file(const string &path, const string &common_depot)
+{
+    PROFILE_SCOPE("parse/trucks");
+    return read_data_file(path, [&](istream &data) { return read_trucks(data, common_depot, path); });
+}
+
+/**
+ * @brief Read the parcels from a parcel data file
+ *
+ * @param path The path of the parcel data file
+ * @return The parcels in the order they were read
+ */
+vector<parcels> read_parcel_file(const string &path)
+{
+    PROFILE_SCOPE("parse/parcels");
+    return read_data_file(path, [&](istream &data) { return read_parcels(data, path); });
+}
+
+/**
+ * @brief Find a data file, or the compressed copy of it if only that is there, so that archived data can be read without unpacking it
+ *
+ * @param path The path of the data file
+ * @return The path itself if it exists or no compressed copy does, or else the path followed by .gz or .zst
+ */
+string find_data_file(const string &path)
+{
+    for (const string &candidate : {path, path + ".gz", path + ".zst"})
+    {
+        if (filesystem::exists(candidate))
+            return candidate;
+    }
+    return path;
+}
+
+/**
+ * @brief The outcome of reading one parcel shard, so that a bad shard can be traced back to the sorting centre that sent it
+ *
+ */
+struct shard_report
+{
+    string path;
+    uint64_t parcels = 0; // The number of parcels read from the shard
+    string error;         // Why the shard was refused, empty if it was read
+};
+
+/**
+ * @brief Check if a file name matches a pattern, where * matches any characters and ? matches any one character
+ *
+ * @param name The file name
+ * @param pattern The pattern
+ * @return True or False whether the name matches
+ */
+bool matches_pattern(const string &name, const string &pattern)
+{
+    uint64_t n = 0, p = 0, star = string::npos, star_n = 0;
+    while (n < name.size())
+    {
+        if (p < pattern.size() and (pattern[p] == '?' or pattern[p] == name[n]))
+        {
+            n++;
+            p++;
+        }
+        else if (p < pattern.size() and pattern[p] == '*')
+        {
+            star = p++;
+            star_n = n;
+        }
+        else if (star != string::npos) // Let the last * match one more character
+        {
+            p = star + 1;
+            n = ++star_n;
+        }
+        else
+            return false;
+    }
+    while (p < pattern.size() and pattern[p] == '*')
+        p++;
+    return p == pattern.size();
+}
+
+/**
+ * @brief Find the parcel shards named by a comma separated list of paths. The file name of a path may hold the wildcards * and ?,
+ * and is replaced by the names of the files in its directory that match it, in sorted order
+ *
+ * @param list The comma separated list of paths
+ * @return The path of every shard, in the order they were listed
+ */
+vector<string> find_parcel_shards(const string &list)
+{
+    vector<string> paths;
+    string pattern;
+    stringstream str(list);
+    while (getline(str, pattern, ','))
+    {
+        if (pattern.empty())
+            continue;
+        filesystem::path pattern_path(pattern);
+        string file_pattern = pattern_path.filename().string();
+        if (file_pattern.find_first_of("*?") == string::npos)
+        {
+            paths.push_back(find_data_file(pattern));
+            continue;
+        }
+        filesystem::path dir = pattern_path.has_parent_path() ? pattern_path.parent_path() : filesystem::path(".");
+        vector<string> matches;
+        error_code ec;
+        for (filesystem::directory_iterator it(dir, ec), end; not ec and it != end; it.increment(ec))
+        {
+            if (it->is_regular_file() and matches_pattern(it->path().filename().string(), file_pattern))
+                matches.push_back(pattern_path.has_parent_path() ? (dir / it->path().filename()).string() : it->path().filename().string());
+        }
+        if (matches.empty())
+            throw file_invalidation::data_error("No parcel data files match " + pattern + "!");
+        sort(matches.begin(), matches.end());
+        paths.insert(paths.end(), matches.begin(), matches.end());
+    }
+    return paths;
+}
+
+/**
+ * @brief Read the parcels from several parcel data files, such as one from each sorting centre, and merge them in the order the
+ * files are listed. Each file is read as its own task on the thread pool, and a file with invalid data does not stop the others
+ * from being read, so that every bad shard is reported together. Parcel IDs must be unique across all of the files
+ *
+ * @param paths The paths of the parcel data files
+ * @param pool The thread pool that reads the files, or nullptr to read them one after another
+ * @param reports Set to the outcome of reading each file, in the order of the paths
+ * @return The parcels of every file
+ */
+vector<parcels> read_parcel_shards(const vector<string> &paths, thread_pool *pool, vector<shard_report> &reports)
+{
+    PROFILE_SCOPE("parse/parcel_shards");
+    vector<vector<parcels> > shards(paths.size());
+    reports.assign(paths.size(), shard_report());
+    optional<thread_pool::task_group> readers;
+    if (pool)
+        readers.emplace(*pool);
+    for (uint64_t i = 0; i < paths.size(); i++)
+    {
+        reports[i].path = paths[i];
+        auto task = [&, i] {
+            try
+            {
+                shards[i] = read_parcel_file(paths[i]);
+                reports[i].parcels = shards[i].size();
+            }
+            catch (const file_invalidation::data_error &ex)
+            {
+                reports[i].error = ex.what();
+            }
+        };
+        if (readers)
+            readers->submit(task);
+        else
+            task();
+    }
+    if (readers)
+        readers->wait();
+
+    /* Each file only checks its own IDs, so an ID is traced to the first file it was read from to find repeats across files. */
+    uint64_t total = 0;
+    for (const vector<parcels> &shard : shards)
+        total += shard.size();
+    unordered_map<uint64_t, uint64_t> first_shard;
+    first_shard.reserve(total);
+    for (uint64_t i = 0; i < shards.size(); i++)
+    {
+        for (const parcels &parcel : shards[i])
+        {
+            auto found = first_shard.emplace(parcel.this_id(), i);
+            if (not found.second and reports[i].error.empty())
+                reports[i].error = "The parcel ID " + to_string(parcel.this_id()) + " was already read from the " + paths[found.first->second] + " file. The parcel ID must be unique!";
+        }
+    }
+
+    string errors;
+    for (const shard_report &report : reports)
+    {
+        if (not report.error.empty())
+            errors += (errors.empty() ? "" : "\n") + report.error;
+    }
+    if (not errors.empty())
+        throw file_invalidation::data_error(errors);
+
+    vector<parcels> list_of_parcels;
+    list_of_parcels.reserve(total);
+    for (vector<parcels> &shard : shards)
+        list_of_parcels.insert(list_of_parcels.end(), make_move_iterator(shard.begin()), make_move_iterator(shard.end()));
+    return list_of_parcels;
+}
+
+/**
+ * @brief Read the parcels of several parcel data files one after another without keeping them, for parcel sets too large to hold in
+ * memory. Parcel IDs must be unique across every file
+ *
+ * @tparam parcel_visitor A function taking each parcel
+ * @param paths The paths of the parcel data files, read in this order
+ * @param visit The function given each valid parcel in the order they were read
+ * @return The number of parcels read
+ */
+template <class parcel_visitor>
+uint64_t stream_parcel_files(const vector<string> &paths, parcel_visitor visit)
+{
+    PROFILE_SCOPE("parse/parcel_stream");
+    unordered_set<uint64_t> unique_parcel;
+    for (const string &path : paths)
+        read_data_file(path, [&](istream &data) { read_parcels_each(data, path, unique_parcel, visit); return 0; });
+    return unique_parcel.size();
+}
+
+/**
+ * @brief Read the entries of a map data file
+ *
+ * @param path The path of the map data file
+ * @return The map entries in the order they were read
+ */
+vector<map_entry> read_map_file(const string &path)
+{
+    PROFILE_SCOPE("parse/map");
+    return read_data_file(path, [&](istream &data) { return read_map(data, path); });
+}
+
+/**
+ * @brief Create a distance map from the entries of a map data file
+ *
+ * @param map_entries The map entries
+ * @return The distance map
+ */
+distanceMap build_distance_map(const vector<map_entry> &map_entries)
+{
+    PROFILE_SCOPE("build/distance_map");
+    distanceMap newMap;
+    for (const map_entry &entry : map_entries)
+        newMap.add_distance(entry.city_1, entry.city_2, entry.distance);
+    return newMap;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file lru_cache.hpp
+ * @author Cassandra Masschelein
+ * @brief Define a bounded, thread-safe cache that forgets the least recently used entries first
+ * @version 0.1
+ * @date 2022-02-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief A cache of whole number values with a fixed maximum number of entries. The entries are split over shards
+ * that each have their own lock, so that threads looking up different keys rarely wait for each other
+ *
+ */
+class lru_cache
+{
+public:
+    /**
+     * @brief Construct a new lru cache object
+     *
+     * @param capacity The largest number of entries kept across all shards
+     * @param num_shards The number of independently locked shards
+     */
+    lru_cache(const uint64_t &capacity, const uint64_t &num_shards) : shards(max<uint64_t>(num_shards, 1))
+    {
+        for (shard &s : shards)
+            s.capacity = max<uint64_t>(1, capacity / shards.size());
+    }
+
+    /**
+     * @brief Look up a value, and mark it as the most recently used entry of its shard
+     *
+     * @param key The key
+     * @param value The cached value, if it was found
+     * @return True or False whether the key was in the cache
+     */
+    bool get(const uint64_t &key, uint64_t &value)
+    {
+        shard &s = shard_for(key);
+        lock_guard<mutex> lock(s.shard_mutex);
+        auto found = s.index.find(key);
+        if (found == s.index.end())
+        {
+            misses.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        s.entries.splice(s.entries.begin(), s.entries, found->second);
+        value = found->second->second;
+        hits.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Add a value to the cache, forgetting the least recently used entry of its shard if the shard is full
+     *
+     * @param key The key
+     * @param value The value
+     */
+    void put(const uint64_t &key, const uint64_t &value)
+    {
+        shard &s = shard_for(key);
+        lock_guard<mutex> lock(s.shard_mutex);
+        auto found = s.index.find(key);
+        if (found != s.index.end())
+        {
+            found->second->second = value;
+            s.entries.splice(s.entries.begin(), s.entries, found->second);
+            return;
+        }
+        if (s.index.size() >= s.capacity)
+        {
+            s.index.erase(s.entries.back().first);
+            s.entries.pop_back();
+        }
+        s.entries.emplace_front(key, value);
+        s.index[key] = s.entries.begin();
+    }
+
+    /**
+     * @brief Forget every entry, such as when the values they were computed from change. The hit and miss counts are kept
+     *
+     */
+    void clear()
+    {
+        for (shard &s : shards)
+        {
+            lock_guard<mutex> lock(s.shard_mutex);
+            s.entries.clear();
+            s.index.clear();
+        }
+    }
+
+    /**
+     * @brief The number of lookups that found their key
+     *
+     * @return The number of cache hits
+     */
+    uint64_t hit_count() const
+    {
+        return hits.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief The number of lookups that did not find their key
+     *
+     * @return The number of cache misses
+     */
+    uint64_t miss_count() const
+    {
+        return misses.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief The largest number of entries kept across all shards
+     *
+     * @return The capacity of the cache
+     */
+    uint64_t capacity() const
+    {
+        return shards[0].capacity * shards.size();
+    }
+
+    /**
+     * @brief The number of shards
+     *
+     * @return The number of independently locked shards
+     */
+    uint64_t shard_count() const
+    {
+        return shards.size();
+    }
+
+private:
+    /**
+     * @brief A part of the cache with its own lock, holding its entries from most to least recently used
+     *
+     */
+    struct shard
+    {
+        mutex shard_mutex;
+        list<pair<uint64_t, uint64_t> > entries;
+        unordered_map<uint64_t, list<pair<uint64_t, uint64_t> >::iterator> index;
+        uint64_t capacity = 1;
+    };
+
+    /**
+     * @brief Find the shard that holds a key, mixing the bits so that nearby keys spread over the shards
+     *
+     * @param key The key
+     * @return The shard
+     */
+    shard &shard_for(const uint64_t &key)
+    {
+        uint64_t mixed = key * 0x9e3779b97f4a7c15ULL;
+        return shards[(mixed >> 32) % shards.size()];
+    }
+
+    vector<shard> shards;
+    atomic<uint64_t> hits{0}, misses{0};
+};
@@ -1,7 +1,8 @@
 /**
  * @file main.cpp
  * @author Cassandra Masschelein
- * @brief A program that will read data from a map file, truck file, and parcel file and create various route schedules for delivery. User must input COMMON DEPOT into the program as a main argument
+ * @brief A program that will read data from a map file, truck file, and parcel files and create various route schedules for delivery. User may input a COMMON DEPOT into the program as a main argument for trucks that do not name their own depot,
+ * and may ask for the schedulers to save checkpoints with --checkpoint=PATH and to continue from them with --resume
  * @version 0.1
  * @date 2021-12-26
  * 
@@ -12,13 +13,22 @@
 /* C++ Header Files */
 #include "domain.hpp"
 #include "schedule.hpp"
+#include "thread_pool.hpp"
+#include "loader.hpp"
+#include "profile.hpp"
+#include "checkpoint.hpp"
+#include "bounds.hpp"
+#include "results.hpp"
+#include "spill.hpp"
+#include "consolidate.hpp"
+#include "exact.hpp"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
-#include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 
 using namespace std;
 
@@ -34,400 +44,395 @@ void load_fleet(const vector<trucks> &list_of_trucks, fleet &newfleet)
         newfleet.add_truck(truck);
 }
 
-int main(int argc, char* argv[])
+/**
+ * @brief Measure the wall time of a function call
+ * 
+ * @param f The function to be called
+ * @return The time the call took (in ms)
+ */
+template <class function_type>
+double elapsed_ms(function_type f)
 {
-    /* Check that the input data files follow the specified format and contain valid data. */
-    string correct_common_depot = "The common depot for all the trucks must be a single city name. This name must be spelled properly and it must start with a capital letter. For example if your desired common depot was Toronto you would simply run the program with the argument: Toronto \n";
-    string correct_truck_data = "The truck data file must be formatted such that each line contains a truck ID followed by its capacity (in cm^3) with the data separated by a comma. Both numbers must be inputted as integers. An example line of data for a truck with ID: 101 and capacity: 150cm^3 would be \n 101, 150 \n";
-    string correct_parcel_data = "The parcel data file must be formatted such that each line contains a parcel ID followed by its source city, destination city, and its volume (in cm^3). The data must be separated by a comma, and both the ID and volume must be integer values. An example line of data for a parcel with ID: 50, source city: Hamilton, destination city: Toronto, volume: 7cm^3 would be \n 50, Hamilton, Toronto, 7 \n";
-    string correct_map_data = "The map data file must be formatted such that each line contains two cities followed by the distance between them (in km). The data must be separated by a comma and the distance must be an integer value. An example line of data for the distance between Hamilton and Toronto which have a distance of 69km would be \n Hamilton, Toronto, 69 \n";
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
 
-    /* Validate program argument. */
-    if (argc < 2)
+/**
+ * @brief Write one row of the route statistics file for the fleet built by a scheduling algorithm
+ * 
+ * @param route_stats The route statistics file
+ * @param scheduler_name The name of the scheduling algorithm
+ * @param scheduled The fleet built by the scheduling algorithm
+ * @param dmap The distance map
+ * @param runtime The time the scheduling algorithm took (in ms)
+ * @param bounds The lower bounds for the parcels the scheduling algorithm loaded
+ */
+void write_fleet_stats(ofstream &route_stats, const string &scheduler_name, const fleet &scheduled, const distanceMap &dmap, const double &runtime, const schedule_bounds &bounds)
+{
+    route_stats << scheduler_name << ", " << profile_call("stats/free_vol_in_used_trucks", [&] { return scheduled.free_vol_in_used_trucks(); })
+                << ", " << profile_call("stats/avg_capacity_used", [&] { return scheduled.avg_capacity_used(); })
+                << ", " << "+-" << profile_call("stats/std_dev_capacity_used", [&] { return scheduled.std_dev_capacity_used(); })
+                << ", " << profile_call("stats/avg_distance_travelled", [&] { return scheduled.avg_distance_travelled(dmap); })
+                << ", " << "+-" << profile_call("stats/std_dev_distance_travelled", [&] { return scheduled.std_dev_distance_travelled(dmap); })
+                << ", " << runtime;
+    /* The weight and pallet slots used are only reported when some truck is limited in that dimension. */
+    for (uint64_t i = 1; i < capacity_dimensions; i++)
     {
-        cout << "This program must take the common depot as the single argument! Please include the depot location! \n";
-        cout << correct_common_depot;
-        return -1;
-    }
-    else if (argc > 2)
-    {
-        cout << "This program only takes one argument! Please only include the name of the depot location. \n";
-        cout << correct_common_depot;
-        return -1;
+        capacity_dimension dimension = (capacity_dimension)i;
+        if (scheduled.dimension_limited(dimension))
+            route_stats << ", " << scheduled.avg_capacity_used(dimension) << ", " << "+-" << scheduled.std_dev_capacity_used(dimension);
+        else
+            route_stats << ", " << "n/a" << ", " << "n/a";
     }
+    route_stats << ", " << profile_call("stats/total_cost", [&] { return scheduled.total_cost(dmap); });
+    /* How far the schedule is from the lower bounds, a gap of 0 means the schedule cannot be improved in that measure. */
+    route_stats << ", " << bounds.trucks << ", " << optimality_gap(scheduled.number_trucks_used(), bounds.trucks)
+                << ", " << bounds.distance << ", " << optimality_gap(scheduled.total_distance_travelled(dmap), bounds.distance) << "\n";
+}
+
+/**
+ * @brief Print the parcels that a scheduling algorithm could not load, formatted a block at a time as they are visited so they
+ * never have to be held together
+ * 
+ * @tparam parcel_source A function taking a visitor and calling it with each parcel that was not loaded
+ * @param scheduler_name The name of the scheduling algorithm
+ * @param unpacked_count The number of parcels that were not loaded
+ * @param for_each_parcel The function
+ */
+template <class parcel_source>
+void report_unpacked(const string &scheduler_name, const uint64_t &unpacked_count, parcel_source for_each_parcel)
+{
+    const uint64_t block_bytes = 1 << 16;
+    string text = "Using the " + scheduler_name + " scheduling algorithm ";
+    if (unpacked_count == 0)
+        text += "all parcels were packed onto trucks. \n";
     else
     {
-        try
-        {
-            string common_depot = argv[1];
-            uint64_t char_counter = 0;
-            for (const char &c : common_depot)
+        text += "the following parcels could not be packed onto trucks: ";
+        for_each_parcel([&](const parcels &parcel) {
+            text += to_string(parcel.this_id());
+            text += ", ";
+            if (text.size() >= block_bytes)
             {
-                char_counter++;
-                if (char_counter == 1 and not (isalpha(c) and isupper(c)))
-                    throw invalid_argument("Depot name must start with a capital letter!");
-                if (char_counter > 1 and not (isalpha(c) and islower(c)))
-                    throw invalid_argument("Depot name must be a proper city name that is capitalized!");
+                cout.write(text.data(), (streamsize)text.size());
+                text.clear();
             }
-        }
-        catch (const invalid_argument &ex) 
-        {
-            cerr << "Invalid argument: " << ex.what() << '\n';
-            cout << correct_common_depot;
-            return -1;
-        } 
+        });
+        text += "\n";
     }
+    cout.write(text.data(), (streamsize)text.size());
+}
 
-    /**
-     * @brief The common depot for all the trucks to start their routes from
-     * 
-     */
-    string COMMON_DEPOT = argv[1];
-    cout << "Reading file contents and preparing to create a delivery schedule for your parcels... \n";
-
-    /* Open the data file containing the truck information. */
-    ifstream truck_data("truck-data.csv");
-    if (!truck_data.is_open())
-    {
-        cout << "Error opening truck data file!";
-        return -1;
-    }
+/**
+ * @brief Print the parcels that a scheduling algorithm could not load
+ * 
+ * @param scheduler_name The name of the scheduling algorithm
+ * @param unpacked The parcels that were not loaded
+ */
+void report_unpacked(const string &scheduler_name, const vector<parcels> &unpacked)
+{
+    report_unpacked(scheduler_name, unpacked.size(), [&unpacked](auto visit) {
+        for (const parcels &parcel : unpacked)
+            visit(parcel);
+    });
+}
 
-    /* Read csv file containing truck data row by row and split each row by comma delimeter. */
-    vector<uint64_t> row;
-    string line, entry; // A line is a row, and an entry is a comma separated value
-    uint64_t line_number = 0;
-    uint64_t arg_counter;
-    vector<vector<uint64_t> > truck_file_contents; // Store the data in a vector
+int main(int argc, char* argv[])
+{
+    /* Check that the input data files follow the specified format and contain valid data. */
+    string correct_common_depot = "The common depot for the trucks must be a single city name. This name must be spelled properly and it must start with a capital letter. For example if your desired common depot was Toronto you would simply run the program with the argument: Toronto \nThe common depot may be left out if every truck in the truck data file names its own depot. \n";
+    string correct_truck_data = "The truck data file must be formatted such that each line contains a truck ID followed by its capacity (in cm^3) and optionally its depot, with the data separated by a comma. Both numbers must be inputted as integers. An example line of data for a truck with ID: 101 and capacity: 150cm^3 starting from Toronto would be \n 101, 150, Toronto \nA truck may also be limited by weight (in kg) and by pallet slots, given as whole numbers after the depot, which may be left empty for a truck from the common depot. For example \n 101, 150, Toronto, 800, 4 \nA truck may also have a shift limit (in minutes) after its pallet slots, and a limit that does not apply may be left empty. For example \n 101, 150, Toronto, , , 480 \nA truck may also have a dispatch cost and a cost per km (both in cents) after its shift limit, and a cost that does not apply may be left empty. For example \n 101, 150, Toronto, , , , 5000, 120 \n";
+    string correct_parcel_data = "The parcel data file must be formatted such that each line contains a parcel ID followed by its source city, destination city, and its volume (in cm^3). The data must be separated by a comma, and both the ID and volume must be integer values. An example line of data for a parcel with ID: 50, source city: Hamilton, destination city: Toronto, volume: 7cm^3 would be \n 50, Hamilton, Toronto, 7 \nA parcel may also have a weight (in kg) and a number of pallet slots after its volume. For example \n 50, Hamilton, Toronto, 7, 12, 1 \nA parcel may also have a delivery window, given as the earliest and latest delivery times (in minutes from the start of the day) after its pallet slots. For example \n 50, Hamilton, Toronto, 7, 12, 1, 60, 180 \n";
+    string correct_map_data = "The map data file must be formatted such that each line contains two cities followed by the distance between them (in km). The data must be separated by a comma and the distance must be an integer value. An example line of data for the distance between Hamilton and Toronto which have a distance of 69km would be \n Hamilton, Toronto, 69 \n";
 
-    while (getline(truck_data, line))
+    string correct_options = "The options --checkpoint=PATH, --resume, and --pickup may come before or after the common depot. With --checkpoint each scheduling algorithm saves its progress to files starting with PATH, and with --resume it continues from those files if they exist. With --pickup each parcel is picked up at its source city instead of being loaded at the depot. The option --results=PATH writes the route and parcel manifest of every truck and the unpacked parcels of every scheduling algorithm to PATH, in the format chosen by --results_format=csv|jsonl|binary (csv by default). The option --parcels=LIST reads the parcels from a comma separated list of parcel data files instead of parcel-data.csv, such as one file from each sorting centre, and a file name may use the wildcards * and ? to read every matching file, for example --parcels=centres/*.csv \nThe option --memory_budget=MB keeps the parcels within about MB megabytes of memory by writing them to sorted files in the temporary directory, or in the directory given by --spill_dir=PATH, and streaming them back to the scheduling algorithms, which make the same schedules as with the parcels in memory. It cannot be used with --checkpoint. \nThe option --consolidate merges parcels with the same source city, destination city, and delivery window into shipments of at most a quarter of the median truck capacity, or of PERCENT of it with --consolidate=PERCENT, and schedules the shipments instead of each parcel. The trucks still list every parcel they carry. It cannot be used with --memory_budget. \nThe option --exact=unpacked or --exact=trucks also schedules the parcels with an exact packer that searches for the schedule that leaves the least volume unpacked, or for the one that uses the fewest trucks among those, for at most 10 seconds or the number of seconds given by --exact_seconds=S (0 for no limit). It reports whether its schedule is proven to be the best, or how far from the best it could be. It is meant for a few hundred parcels, ignores delivery windows and shift limits, and cannot be used with --pickup or --memory_budget. \nA data file may be compressed with gzip or zstd, and truck-data.csv.gz or truck-data.csv.zst is read when truck-data.csv is not there, and likewise for the parcel and map files. \n";
+
+    /* Separate the options from the common depot argument. */
+    vector<string> arguments;
+    checkpoint_spec checkpoints;
+    checkpoints.path = "";
+    bool pickup_delivery = false;
+    string results_path = "";
+    string parcel_files = "parcel-data.csv";
+    result_format results_format = result_format::csv;
+    uint64_t memory_budget_mb = 0; // No budget, the parcels are held in memory
+    uint64_t shipment_percent = 0; // The parcels are not merged into shipments
+    bool exact = false;            // The exact packer is not run
+    exact_objective exact_goal = exact_objective::least_unpacked;
+    uint64_t exact_seconds = 10;
+    spill_spec spill;
+    for (int i = 1; i < argc; i++)
     {
-        arg_counter = 0;
-        line_number++;
-        row.clear();
-        stringstream str(line);
-
-        while (getline(str, entry, ','))
+        string arg = argv[i];
+        if (arg.rfind("--checkpoint=", 0) == 0 and arg.size() > 13)
+            checkpoints.path = arg.substr(13);
+        else if (arg == "--resume")
+            checkpoints.resume = true;
+        else if (arg == "--pickup")
+            pickup_delivery = true;
+        else if (arg.rfind("--results=", 0) == 0 and arg.size() > 10)
+            results_path = arg.substr(10);
+        else if (arg.rfind("--parcels=", 0) == 0 and arg.size() > 10)
+            parcel_files = arg.substr(10);
+        else if (arg.rfind("--spill_dir=", 0) == 0 and arg.size() > 12)
+            spill.directory = arg.substr(12);
+        else if (arg == "--consolidate")
+            shipment_percent = 25;
+        else if (arg.rfind("--consolidate=", 0) == 0)
         {
-            arg_counter++;
-            if (arg_counter > 2) // Check that a line in the data file has the correct number of entries
-                throw invalid_argument("Too many data entries!");
-
-            try 
+            try
             {
-                size_t pos;
-                uint64_t truck_data = stoull(entry, &pos);
-                if (pos < entry.size()) 
-                    throw invalid_argument("Trailing characters after number!");
-
-                row.push_back(truck_data); // Add the comma separated value to the row vector
+                shipment_percent = read_number(arg.substr(14));
+                if (shipment_percent == 0)
+                    throw invalid_argument("The shipment size must be at least 1 percent of a truck!");
             }
-
-            catch (const invalid_argument &ex) 
-            {
-                cerr << "Invalid data entry: " << entry << " on line" << line_number << " of the truck-data.csv file. " << ex.what() << '\n';
-                cout << correct_truck_data;
-                return -1;
-            } 
-            catch (const out_of_range &ex) 
+            catch (const exception &ex)
             {
-                cerr << "Number out of range: " << entry << " on line" << line_number << " of truck-data.csv file." << '\n';
-                cout << correct_truck_data;
+                cout << "Invalid shipment size " << arg.substr(14) << ": " << ex.what() << " \n";
+                cout << correct_options;
                 return -1;
             }
         }
-
-        truck_file_contents.push_back(row); // Add the row vector to the truck data vector
-    }
-
-    cout << "Truck data has been successfully read. \n";
-    truck_data.close();
-
-    /* Open the data file containing the parcel information. */
-    ifstream parcel_data("parcel-data.csv");
-    if (!parcel_data.is_open())
-    {
-        cout << "Error opening parcel data file!";
-        return -1;
-    }
-
-    /* Read csv file containing parcel data row by row and split each row by comma delimeter. */
-    vector<string> parcel_row;
-    line_number = 0;
-    vector<vector<string> > parcel_file_contents; // Store the data in a vector
-
-    while (getline(parcel_data, line))
-    {
-        arg_counter = 0;
-        line_number++;
-        parcel_row.clear();
-        stringstream str(line);
-
-        while (getline(str, entry, ','))
+        else if (arg.rfind("--exact=", 0) == 0)
         {
-            arg_counter++;
-            if (arg_counter > 4) // Check that a line in the data file has the correct number of entries
-                throw invalid_argument("Too many data entries!");
-            
             try
             {
-                if (arg_counter == 1 or arg_counter == 4) // Validate parcel ID and volume
-                {    
-                    uint64_t char_counter = 0;
-                    for (const char &c : entry)
-                    {
-                        char_counter++;
-                        if (isspace(c) and char_counter == 1) // Ignore leading space character
-                            continue;
-                        else if (!isdigit(c))
-                            throw invalid_argument("ID and volume must only contain digits!");
-                    }
-
-                    entry.erase(remove(entry.begin(), entry.end(), ' '), entry.end()); // Remove whitespace characters
-                    parcel_row.push_back(entry); // Add the comma separated value to the row vector
-                }
-
-                else if (arg_counter == 2 or arg_counter == 3) // Validate the to and from city names
-                {
-                    string city = "";
-                    uint64_t char_counter = 0;
-                    for (const char &c : entry)
-                    {
-                        char_counter++;
-                        if (isspace(c) and char_counter == 1) // Ignore leading space character
-                            continue;
-                        else if (!isalpha(c))
-                            throw invalid_argument("City name must only contain alphabet characters!");
-                        else
-                            city.push_back(c);
-                    }
-                    parcel_row.push_back(city); // Add the comma separated value to the row vector
-                }
+                exact_goal = parse_exact_objective(arg.substr(8));
+                exact = true;
             }
-            
-            catch(const invalid_argument &ex)
+            catch (const invalid_argument &ex)
             {
-                cerr << "Invalid data entry: " << entry << " found on line " << line_number << " of the parcel-data.csv file. " << ex.what() << '\n';
-                cout << correct_parcel_data;
+                cout << ex.what() << "\n";
+                cout << correct_options;
                 return -1;
             }
-
-            catch (const out_of_range &ex) 
+        }
+        else if (arg.rfind("--exact_seconds=", 0) == 0)
+        {
+            try
             {
-                cerr << "Number out of range: " << entry << " found on line" << line_number << " of the parcel-data.csv file. " << ex.what() << '\n';
-                cout << correct_parcel_data;
+                exact_seconds = read_number(arg.substr(16));
+            }
+            catch (const exception &ex)
+            {
+                cout << "Invalid time limit " << arg.substr(16) << ": " << ex.what() << " \n";
+                cout << correct_options;
                 return -1;
             }
         }
-        parcel_file_contents.push_back(parcel_row); // Add the row vector to the parcel data vector
-    }
-
-    cout << "Parcel data has been successfully read. \n";
-    parcel_data.close();
-
-    /* Open the data file containing the map information. */
-    ifstream map_data("map-data.csv");
-    if (!map_data.is_open())
-    {
-        cout << "Error opening map data file!";
-        return -1;
-    }
-
-    /* Read csv file containing map data row by row and split each row by comma delimeter. */
-    vector<string> map_row;
-    line_number = 0;
-    vector<vector<string> > map_file_contents; // Store the data in a vector
-
-    while (getline(map_data, line))
-    {
-        arg_counter = 0;
-        line_number++;
-        map_row.clear();
-        stringstream str(line);
-
-        while (getline(str, entry, ','))
+        else if (arg.rfind("--memory_budget=", 0) == 0)
         {
-            arg_counter++;
-            if (arg_counter > 3) // Check that a line in the data file has the correct number of entries
-                throw invalid_argument("Too many data entries!");
-            
             try
             {
-                if (arg_counter == 1 or arg_counter == 2) // Validate the city names
-                {
-                    uint64_t char_counter = 0;
-                    string city = "";
-                    for (const char &c : entry)
-                    {
-                        char_counter++;
-                        if (isspace(c) and char_counter == 1) // Ignore leading space character
-                            continue;
-                        else if (!isalpha(c))
-                            throw invalid_argument("City name must only contain alphabet characters!");
-                        else
-                            city.push_back(c);
-                    }
-                    map_row.push_back(city); // Add the comma separated value to the row vector
-                }
-
-                if (arg_counter == 3) // Validate the distance
-                {
-                    uint64_t char_counter = 0;
-                    for (const char &c : entry)
-                    {
-                        char_counter++;
-                        if (isspace(c) and char_counter == 1) // Ignore leading space character
-                            continue;
-                        else if (!isdigit(c))
-                            throw invalid_argument("Distance value must only contain digits!");
-                    }
-
-                    entry.erase(remove(entry.begin(), entry.end(), ' '), entry.end()); // Remove whitespace characters
-                    map_row.push_back(entry); // Add the comma separated value to the row vector
-                }
+                memory_budget_mb = read_number(arg.substr(16));
+                if (memory_budget_mb == 0)
+                    throw invalid_argument("The memory budget must be at least 1 MB!");
             }
-            catch(const invalid_argument &ex)
+            catch (const exception &ex)
             {
-                cerr << "Invalid data entry:" << entry << " found on line " << line_number << " of the map-data.csv file. " << ex.what() << '\n';
-                cout << correct_map_data;
+                cout << "Invalid memory budget " << arg.substr(16) << ": " << ex.what() << " \n";
+                cout << correct_options;
                 return -1;
             }
-
-            catch (const out_of_range &ex) 
+        }
+        else if (arg.rfind("--results_format=", 0) == 0)
+        {
+            try
+            {
+                results_format = parse_result_format(arg.substr(17));
+            }
+            catch (const invalid_argument &ex)
             {
-                cerr << "Number out of range: " << entry << " found on line" << line_number << " of the map-data.csv file. " << ex.what() << '\n';
-                cout << correct_map_data;
+                cout << ex.what() << "\n";
+                cout << correct_options;
                 return -1;
             }
         }
-        map_file_contents.push_back(map_row); // Add the row vector to the map data vector
+        else if (arg.rfind("--", 0) == 0)
+        {
+            cout << "Unknown option " << arg << "! \n";
+            cout << correct_options;
+            return -1;
+        }
+        else
+            arguments.push_back(arg);
+    }
+    if (checkpoints.resume and checkpoints.path.empty())
+    {
+        cout << "The --resume option needs the --checkpoint option to name the checkpoint files! \n";
+        cout << correct_options;
+        return -1;
+    }
+    if (memory_budget_mb != 0 and not checkpoints.path.empty())
+    {
+        cout << "The --memory_budget option cannot be used with the --checkpoint option! \n";
+        cout << correct_options;
+        return -1;
+    }
+    if (memory_budget_mb != 0 and shipment_percent != 0)
+    {
+        cout << "The --memory_budget option cannot be used with the --consolidate option! \n";
+        cout << correct_options;
+        return -1;
+    }
+    if (exact and (memory_budget_mb != 0 or pickup_delivery))
+    {
+        cout << "The --exact option cannot be used with the --memory_budget or --pickup options! \n";
+        cout << correct_options;
+        return -1;
     }
 
-    cout << "Map data has been successfully read. \n";
-    map_data.close();
-    
-    /* Use the data from the map-data.csv to create a distanceMap object and add corresponding map entries. */
-    distanceMap newMap;
-    for (vector<string> &map_entry : map_file_contents)
+    /* Validate program argument. */
+    if (arguments.size() > 1)
+    {
+        cout << "This program only takes one argument! Please only include the name of the depot location. \n";
+        cout << correct_common_depot;
+        return -1;
+    }
+    else if (arguments.size() == 1)
     {
-        /* Extract the distance between cities as an integer value. */
-        try 
+        PROFILE_SCOPE("validate/arguments");
+        try
         {
-            size_t pos;
-            uint64_t distance = stoull(map_entry[2], &pos);
-            if (pos < map_entry[2].size()) 
-                throw invalid_argument("Trailing characters after number!");
-
-            string city_1 = map_entry.at(0);
-            string city_2 = map_entry.at(1);
-
-            newMap.add_distance(city_1, city_2, distance); // Add the map entry into the distance map
+            string common_depot = arguments[0];
+            uint64_t char_counter = 0;
+            for (const char &c : common_depot)
+            {
+                char_counter++;
+                if (char_counter == 1 and not (isalpha(c) and isupper(c)))
+                    throw invalid_argument("Depot name must start with a capital letter!");
+                if (char_counter > 1 and not (isalpha(c) and islower(c)))
+                    throw invalid_argument("Depot name must be a proper city name that is capitalized!");
+            }
         }
-
         catch (const invalid_argument &ex) 
         {
-            cerr << "Invalid distance found: " << ex.what() << '\n';
-            cout << correct_map_data;
+            cerr << "Invalid argument: " << ex.what() << '\n';
+            cout << correct_common_depot;
             return -1;
         } 
-        catch (const out_of_range &ex) 
-        {
-            cerr << "Distance number out of range: " << ex.what() << '\n';
-            cout << correct_map_data;
-            return -1;
-        }
     }
-    
-    cout << "Created distance map for parcel delivery: \n";
-    newMap.print_distance_map(); // Print the distance map
 
-    /* Use the data from the truck-data.csv to create truck objects and add them to a fleet of trucks. */
+    /**
+     * @brief The common depot for the trucks that do not name their own depot to start their routes from
+     * 
+     */
+    string COMMON_DEPOT = (arguments.size() == 1) ? arguments[0] : "";
+    cout << "Reading file contents and preparing to create a delivery schedule for your parcels... \n";
+
+    /* Read the truck, parcel, and map data files. */
     vector<trucks> list_of_trucks; // Store the trucks read from the file
-    /* Make copies for each scheduling algorithm. */
-    vector<trucks> list_of_trucks_random;
-    vector<trucks> list_of_trucks_most;
-    vector<trucks> list_of_trucks_short;
-    /* Make sure all trucks have a unique ID. */
-    vector<uint64_t> unique_truck;
+    try
+    {
+        list_of_trucks = read_truck_file(find_data_file("truck-data.csv"), COMMON_DEPOT);
+    }
+    catch (const file_invalidation::data_error &ex)
+    {
+        cerr << ex.what() << '\n';
+        cout << correct_truck_data;
+        return -1;
+    }
+    cout << "Truck data has been successfully read. \n";
 
-    /* Create truck objects and add them to each list for respective scheduling algorithms. */
-    for (const vector<uint64_t> &truck_data : truck_file_contents)
+    /* The parcel files are read at the same time when there are several, and every file with invalid data is reported. With a memory
+       budget the files are read one after another instead, and each parcel goes straight into a store for each parcel order. Each store
+       is given a quarter of the budget, and the last quarter is shared by the stores of parcels the schedules could not load. */
+    thread_pool pool;
+    vector<parcels> list_of_parcels; // Store the parcels read from the files
+    vector<shard_report> shard_reports;
+    spill.budget_bytes = max<uint64_t>(memory_budget_mb * (1ULL << 20) / 4, 1);
+    external_parcels<randomScheduler::order_policy> input_order_parcels(spill);
+    external_parcels<mostparcelScheduler::order_policy> volume_order_parcels(spill);
+    external_parcels<shortrouteScheduler::order_policy> destination_order_parcels(spill);
+    try
     {
-        try
+        vector<string> parcel_paths = find_parcel_shards(parcel_files);
+        if (memory_budget_mb != 0)
         {
-            trucks newtruck(truck_data[0], truck_data[1], COMMON_DEPOT);
-            list_of_trucks.push_back(newtruck);
-            list_of_trucks_random.push_back(newtruck);
-            list_of_trucks_most.push_back(newtruck);
-            list_of_trucks_short.push_back(newtruck);
-            unique_truck.push_back(newtruck.my_id());
-        }
-        catch(const exception &e)
-        {
-            cerr << e.what() << '\n';
-            return -1;
+            profile_call("spill/parcels", [&] {
+                stream_parcel_files(parcel_paths, [&](const parcels &parcel) {
+                    input_order_parcels.add(parcel);
+                    volume_order_parcels.add(parcel);
+                    destination_order_parcels.add(parcel);
+                });
+                input_order_parcels.finish();
+                volume_order_parcels.finish();
+                destination_order_parcels.finish();
+            });
         }
+        else if (parcel_paths.size() == 1)
+            list_of_parcels = read_parcel_file(parcel_paths[0]);
+        else
+            list_of_parcels = read_parcel_shards(parcel_paths, &pool, shard_reports);
     }
-
-    /* Make sure that all trucks have a unique ID. */
-    for (const uint64_t &id : unique_truck)
+    catch (const file_invalidation::data_error &ex)
     {
-        if (count(unique_truck.begin(), unique_truck.end(), id) != 1)
+        if (shard_reports.empty())
+            cerr << ex.what() << '\n';
+        for (const shard_report &report : shard_reports)
         {
-            cout << "The parcel ID must be unique! \n";
-            return -1;
+            if (report.error.empty())
+                cerr << report.path << ": " << report.parcels << " parcels read \n";
+            else
+                cerr << report.path << ": " << report.error << '\n';
         }
+        cout << correct_parcel_data;
+        return -1;
     }
-
-    /* Use the data from the parcel-data.csv to create parcel objects. */
-    vector<parcels> list_of_parcels; // Store the parcels read from the file
-    vector<uint64_t> unique_parcel; // Make sure all parcels have a unique ID
-    for (vector<string> &parcel_data : parcel_file_contents)
+    catch (const spill_invalidation::spill_error &ex)
     {
-        /* Validate the parcel ID. */
-        try 
-        {
-            size_t pos1;
-            size_t pos2;
-            uint64_t parcel_id = stoull(parcel_data[0], &pos1);
-            uint64_t parcel_volume = stoull(parcel_data[3], &pos2);
-            if (pos1 < parcel_data[0].size()) 
-                throw invalid_argument("Trailing characters after parcel ID!");
-            
-            if (pos2 < parcel_data[3].size())
-                throw invalid_argument("Trailing characters after parcel volume!");
+        cerr << ex.what() << '\n';
+        return -1;
+    }
+    if (memory_budget_mb != 0)
+        cout << "Parcel data has been successfully read, " << destination_order_parcels.size() << " parcels are kept in " << destination_order_parcels.run_count() << " sorted files. \n";
+    else if (shard_reports.empty())
+        cout << "Parcel data has been successfully read. \n";
+    else
+        cout << "Parcel data has been successfully read from " << shard_reports.size() << " files. \n";
 
-            string from_city = parcel_data[1];
-            string to_city = parcel_data[2];
+    vector<map_entry> map_file_contents; // Store the map entries read from the file
+    try
+    {
+        map_file_contents = read_map_file(find_data_file("map-data.csv"));
+    }
+    catch (const file_invalidation::data_error &ex)
+    {
+        cerr << ex.what() << '\n';
+        cout << correct_map_data;
+        return -1;
+    }
+    cout << "Map data has been successfully read. \n";
 
-            parcels newparcel(parcel_id, parcel_volume, from_city, to_city);
-            list_of_parcels.push_back(newparcel); // Add the parcel to the storage container
-            unique_parcel.push_back(newparcel.this_id());
-        }
+    /* Use the data from the map-data.csv to create a distanceMap object and add corresponding map entries. */
+    distanceMap newMap = build_distance_map(map_file_contents);
+    cout << "Created distance map for parcel delivery: \n";
+    newMap.print_distance_map(); // Print the distance map
 
-        catch (const invalid_argument &ex) 
-        {
-            cerr << "Invalid number: " << ex.what() << '\n';
-            cout << correct_parcel_data;
-            return -1;
-        } 
-        catch (const out_of_range &ex) 
-        {
-            cerr << "Invalid number: " << ex.what() << '\n';
-            cout << correct_parcel_data;
-            return -1;
-        }
+    /* Compute the shortest distance between every pair of cities, or reuse the matrix saved by an earlier run on the same map.
+       Maps too large for a complete matrix compute each distance when it is first needed and cache the recent ones instead. */
+    const uint64_t matrix_limit_bytes = 1ULL << 30, lazy_cache_entries = 1ULL << 22;
+    if ((uint64_t)newMap.number_of_cities() * newMap.number_of_cities() * sizeof(uint64_t) > matrix_limit_bytes)
+    {
+        newMap.use_lazy_distances(lazy_cache_entries);
+        cout << "The map is too large for a complete distance matrix, so distances will be computed as they are needed. \n";
     }
-
-    /* Make sure all the parcels have a unique ID. */
-    for (const uint64_t &id : unique_parcel)
+    else if (not newMap.load_matrix("map-data.bin"))
     {
-        if (count(unique_parcel.begin(), unique_parcel.end(), id) != 1)
-        {
-            cout << "The parcel ID must be unique! \n";
-            return -1;
-        }
+        profile_call("build/all_pairs", [&] { newMap.complete(&pool); });
+        if (not newMap.save_matrix("map-data.bin"))
+            cout << "The distance matrix could not be saved to the map-data.bin file. \n";
     }
+    /* On a machine with several NUMA nodes each node gets its own copy of the matrix, so the schedulers never read it across nodes. */
+    newMap.replicate(pool);
+
+    /* Make copies of the trucks for each scheduling algorithm. */
+    vector<trucks> list_of_trucks_random = list_of_trucks;
+    vector<trucks> list_of_trucks_most = list_of_trucks;
+    vector<trucks> list_of_trucks_short = list_of_trucks;
+    vector<trucks> list_of_trucks_cost = list_of_trucks;
+    vector<trucks> list_of_trucks_exact = list_of_trucks;
 
     cout << "Generating possible delivery schedules to deliver your parcels...\n";
 
@@ -439,26 +444,75 @@ int main(int argc, char* argv[])
         return -1;
     }
 
-    /* Run some scheduling experiments using the data that was read from the input files. */
-    randomScheduler pack_random_parcels(list_of_parcels, list_of_trucks_random);
-    vector<parcels> randomparcel_unpacked = pack_random_parcels.schedule();
-
-    mostparcelScheduler pack_most_parcels(list_of_parcels, list_of_trucks_most);
-    vector<parcels> mostparcel_unpacked = pack_most_parcels.schedule();
-
-    shortrouteScheduler pack_short_parcels(list_of_parcels, list_of_trucks_short);
-    vector<parcels> shortparcel_unpacked = pack_short_parcels.schedule();
+    /* Each scheduling algorithm saves its checkpoints to its own files, at most about 16 times per run so saving stays cheap on big days. */
+    checkpoints.every_parcels = max<uint64_t>(checkpoints.every_parcels, list_of_parcels.size() / 16);
+    auto checkpoints_for = [&checkpoints](const string &scheduler_name) {
+        checkpoint_spec spec = checkpoints;
+        if (not spec.path.empty())
+            spec.path += "." + scheduler_name;
+        return spec;
+    };
+
+    /* Run some scheduling experiments using the data that was read from the input files. Each depot is scheduled as its own task. */
+    vector<parcels> randomparcel_unpacked, mostparcel_unpacked, shortparcel_unpacked, lowcost_unpacked, exact_unpacked;
+    /* With a memory budget the parcels each schedule could not load are kept in stores of their own, and read back from them. */
+    spill_spec unpacked_spill = spill;
+    unpacked_spill.budget_bytes = max<uint64_t>(spill.budget_bytes / 4, 1);
+    external_unpacked randomparcel_left(unpacked_spill), mostparcel_left(unpacked_spill), shortparcel_left(unpacked_spill), lowcost_left(unpacked_spill);
+    double random_ms, most_ms, short_ms, cost_ms, exact_ms = 0; // The runtime of each scheduling algorithm
+    exact_result exact_report;
+    const chrono::steady_clock::time_point no_deadline = chrono::steady_clock::time_point::max();
+    try
+    {
+        if (memory_budget_mb != 0)
+        {
+            random_ms = elapsed_ms([&] { profile_call("schedule/random", [&] { schedule_depots_external<randomScheduler>(input_order_parcels, list_of_trucks_random, newMap, randomparcel_left, no_deadline, pickup_delivery); }); });
+            most_ms = elapsed_ms([&] { profile_call("schedule/mostparcel", [&] { schedule_depots_external<mostparcelScheduler>(volume_order_parcels, list_of_trucks_most, newMap, mostparcel_left, no_deadline, pickup_delivery); }); });
+            short_ms = elapsed_ms([&] { profile_call("schedule/shortroute", [&] { schedule_depots_external<shortrouteScheduler>(destination_order_parcels, list_of_trucks_short, newMap, shortparcel_left, no_deadline, pickup_delivery); }); });
+            cost_ms = elapsed_ms([&] { profile_call("schedule/lowcost", [&] { schedule_depots_external<lowcostScheduler>(destination_order_parcels, list_of_trucks_cost, newMap, lowcost_left, no_deadline, pickup_delivery); }); });
+        }
+        else if (shipment_percent != 0)
+        {
+            random_ms = elapsed_ms([&] { randomparcel_unpacked = profile_call("schedule/random", [&] { return schedule_consolidated<randomScheduler>(list_of_parcels, list_of_trucks_random, newMap, pool, shipment_percent, no_deadline, checkpoints_for("random"), pickup_delivery); }); });
+            most_ms = elapsed_ms([&] { mostparcel_unpacked = profile_call("schedule/mostparcel", [&] { return schedule_consolidated<mostparcelScheduler>(list_of_parcels, list_of_trucks_most, newMap, pool, shipment_percent, no_deadline, checkpoints_for("mostparcel"), pickup_delivery); }); });
+            short_ms = elapsed_ms([&] { shortparcel_unpacked = profile_call("schedule/shortroute", [&] { return schedule_consolidated<shortrouteScheduler>(list_of_parcels, list_of_trucks_short, newMap, pool, shipment_percent, no_deadline, checkpoints_for("shortroute"), pickup_delivery); }); });
+            cost_ms = elapsed_ms([&] { lowcost_unpacked = profile_call("schedule/lowcost", [&] { return schedule_consolidated<lowcostScheduler>(list_of_parcels, list_of_trucks_cost, newMap, pool, shipment_percent, no_deadline, checkpoints_for("lowcost"), pickup_delivery); }); });
+        }
+        else
+        {
+            random_ms = elapsed_ms([&] { randomparcel_unpacked = profile_call("schedule/random", [&] { return schedule_depots<randomScheduler>(list_of_parcels, list_of_trucks_random, newMap, pool, no_deadline, checkpoints_for("random"), pickup_delivery); }); });
+            most_ms = elapsed_ms([&] { mostparcel_unpacked = profile_call("schedule/mostparcel", [&] { return schedule_depots<mostparcelScheduler>(list_of_parcels, list_of_trucks_most, newMap, pool, no_deadline, checkpoints_for("mostparcel"), pickup_delivery); }); });
+            short_ms = elapsed_ms([&] { shortparcel_unpacked = profile_call("schedule/shortroute", [&] { return schedule_depots<shortrouteScheduler>(list_of_parcels, list_of_trucks_short, newMap, pool, no_deadline, checkpoints_for("shortroute"), pickup_delivery); }); });
+            cost_ms = elapsed_ms([&] { lowcost_unpacked = profile_call("schedule/lowcost", [&] { return schedule_depots<lowcostScheduler>(list_of_parcels, list_of_trucks_cost, newMap, pool, no_deadline, checkpoints_for("lowcost"), pickup_delivery); }); });
+        }
+        /* The exact packer searches until it proves its schedule is the best or runs out of time. */
+        if (exact)
+        {
+            chrono::steady_clock::time_point exact_deadline = exact_seconds == 0 ? no_deadline : chrono::steady_clock::now() + chrono::seconds(exact_seconds);
+            exact_ms = elapsed_ms([&] { exact_unpacked = profile_call("schedule/exact", [&] { return schedule_exact(list_of_parcels, list_of_trucks_exact, newMap, pool, exact_goal, exact_deadline, &exact_report); }); });
+        }
+    }
+    catch(const exception &e)
+    {
+        cerr << e.what() << '\n';
+        return -1;
+    }
 
     /* Add these trucks to the fleet for deliveries. */
     fleet randomfleet;
     fleet mostparcelfleet;
     fleet shortroutefleet;
+    fleet lowcostfleet;
+    fleet exactfleet;
 
     try
     {
         load_fleet(list_of_trucks_random, randomfleet);
         load_fleet(list_of_trucks_most, mostparcelfleet);
         load_fleet(list_of_trucks_short, shortroutefleet);
+        load_fleet(list_of_trucks_cost, lowcostfleet);
+        if (exact)
+            load_fleet(list_of_trucks_exact, exactfleet);
     }
     catch(const exception &e)
     {
@@ -469,11 +523,24 @@ int main(int argc, char* argv[])
     
     try
     {
-        route_stats << "Scheduler" << ", " << "Free Volume in Used Trucks (cm^3)" << ", " << "Average Capacity Used (%)" << ", " << "Std Dev Average Capacity" << ", " << "Avg Distance (km)" << ", " << "Std Dev Average Distance" << "\n";
-        route_stats << "Random Parcels" << ", " << randomfleet.free_vol_in_used_trucks() << ", " << randomfleet.avg_capacity_used() << ", " << "+-" << randomfleet.std_dev_capacity_used() << ", " << mostparcelfleet.avg_distance_travelled(newMap) << ", " << "+-" << randomfleet.std_dev_distance_travelled(newMap) << "\n";
-        route_stats << "Most Parcels" << ", " << mostparcelfleet.free_vol_in_used_trucks() << ", " << mostparcelfleet.avg_capacity_used() << ", " << "+-" << mostparcelfleet.std_dev_capacity_used() << ", " << mostparcelfleet.avg_distance_travelled(newMap) << ", " << "+-" << mostparcelfleet.std_dev_distance_travelled(newMap) << "\n";
-        route_stats << "Short Route" << ", " << shortroutefleet.free_vol_in_used_trucks() << ", " << shortroutefleet.avg_capacity_used() << ", " << "+-" << shortroutefleet.std_dev_capacity_used() << ", " << shortroutefleet.avg_distance_travelled(newMap) << ", " << "+-" << shortroutefleet.std_dev_distance_travelled(newMap) << "\n";
-        
+        route_stats << "Scheduler" << ", " << "Free Volume in Used Trucks (cm^3)" << ", " << "Average Capacity Used (%)" << ", " << "Std Dev Average Capacity" << ", " << "Avg Distance (km)" << ", " << "Std Dev Average Distance" << ", " << "Runtime (ms)";
+        for (uint64_t i = 1; i < capacity_dimensions; i++)
+            route_stats << ", " << "Average " << capacity_dimension_names[i] << " Used (%)" << ", " << "Std Dev Average " << capacity_dimension_names[i];
+        route_stats << ", " << "Total Cost (cents)" << ", " << "Trucks Lower Bound" << ", " << "Trucks Gap (%)" << ", " << "Distance Lower Bound (km)" << ", " << "Distance Gap (%)" << "\n";
+        auto bounds_for = [&](const vector<trucks> &scheduled_trucks) {
+            return profile_call("stats/lower_bounds", [&] {
+                if (memory_budget_mb == 0)
+                    return lower_bounds(scheduled_trucks, list_of_parcels, newMap, pickup_delivery);
+                auto for_each_parcel = [&](auto visit) { destination_order_parcels.for_each([&](const parcels &parcel, const uint64_t &) { visit(parcel); }); };
+                return lower_bounds_streamed(scheduled_trucks, for_each_parcel, newMap, pickup_delivery);
+            });
+        };
+        write_fleet_stats(route_stats, "Random Parcels", randomfleet, newMap, random_ms, bounds_for(list_of_trucks_random));
+        write_fleet_stats(route_stats, "Most Parcels", mostparcelfleet, newMap, most_ms, bounds_for(list_of_trucks_most));
+        write_fleet_stats(route_stats, "Short Route", shortroutefleet, newMap, short_ms, bounds_for(list_of_trucks_short));
+        write_fleet_stats(route_stats, "Low Cost", lowcostfleet, newMap, cost_ms, bounds_for(list_of_trucks_cost));
+        if (exact)
+            write_fleet_stats(route_stats, "Exact", exactfleet, newMap, exact_ms, bounds_for(list_of_trucks_exact));
     }
     catch(const map_invalidation::map_error &e)
     {
@@ -487,37 +554,94 @@ int main(int argc, char* argv[])
     mostparcelfleet.print_fleet(); // Print out the fleet schedule for this scheduling algorithm
     cout << "The scheduling algorithm that prioritizes shortest routes suggests using the following delivery routes: \n";
     shortroutefleet.print_fleet(); // Print out the fleet schedule for this scheduling algorithm
-
-    if (randomparcel_unpacked.size() == 0)
-        cout << "Using the Random Parcel scheduling algorithm all parcels were packed onto trucks. \n";
-    else
+    cout << "The scheduling algorithm that prioritizes the lowest running cost suggests using the following delivery routes: \n";
+    lowcostfleet.print_fleet(); // Print out the fleet schedule for this scheduling algorithm
+    if (exact)
     {
-        cout << "Using the Random Parcel scheduling algorithm the following parcels could not be packed onto trucks: ";
-        for (const parcels &parcel : randomparcel_unpacked)
-            cout << parcel.this_id() << ", ";
-        cout << "\n";
+        cout << "The exact packer suggests using the following delivery routes: \n";
+        exactfleet.print_fleet(); // Print out the fleet schedule for the exact packer
     }
 
-    if (mostparcel_unpacked.size() == 0)
-        cout << "Using the Most Parcel scheduling algorithm all parcels were packed onto trucks. \n";
-    else
+    /* The parcels a schedule could not load are read back from its store when there is a memory budget. */
+    auto left_behind = [](const external_unpacked &store) {
+        return [&store](auto visit) { store.for_each([&](const parcels &parcel, const uint64_t &) { visit(parcel); }); };
+    };
+    auto report_schedule_unpacked = [&](const string &scheduler_name, const vector<parcels> &unpacked, const external_unpacked &store) {
+        if (memory_budget_mb == 0)
+            report_unpacked(scheduler_name, unpacked);
+        else
+            report_unpacked(scheduler_name, store.size(), left_behind(store));
+    };
+    try
     {
-        cout << "Using the Most Parcel scheduling algorithm the following parcels could not be packed onto trucks: ";
-        for (const parcels &parcel : mostparcel_unpacked)
-            cout << parcel.this_id() << ", ";
-        cout << "\n";
+        report_schedule_unpacked("Random Parcel", randomparcel_unpacked, randomparcel_left);
+        report_schedule_unpacked("Most Parcel", mostparcel_unpacked, mostparcel_left);
+        report_schedule_unpacked("Short Route", shortparcel_unpacked, shortparcel_left);
+        report_schedule_unpacked("Low Cost", lowcost_unpacked, lowcost_left);
+    }
+    catch (const spill_invalidation::spill_error &e)
+    {
+        cerr << e.what() << '\n';
+        return -1;
+    }
+    if (exact)
+    {
+        report_unpacked("Exact", exact_unpacked);
+        string goal = exact_goal == exact_objective::least_unpacked ? "leaves the least volume unpacked" : "uses the fewest trucks of the schedules that leave the least volume unpacked";
+        if (exact_report.optimal)
+            cout << "The exact packer proved that its schedule " << goal << ", after searching " << exact_report.nodes << " partial schedules. \n";
+        else
+            cout << "The exact packer ran out of time before proving its schedule is the best, it leaves " << exact_report.unpacked_volume << "cm^3 unpacked on " << exact_report.trucks_used << " trucks, and no schedule leaves less than " << exact_report.unpacked_volume_bound << "cm^3 unpacked or uses fewer than " << exact_report.trucks_bound << " trucks while leaving no more unpacked, a gap of at most " << exact_report.gap_percent() << "%. \n";
     }
 
-    if (shortparcel_unpacked.size() == 0)
-        cout << "Using the Short Route scheduling algorithm all parcels were packed onto trucks. \n";
-    else
+    /* Write the routes, manifests, and unpacked parcels of every schedule, formatting the trucks on the thread pool. */
+    if (not results_path.empty())
     {
-        cout << "Using the Short Route scheduling algorithm the following parcels could not be packed onto trucks: ";
-        for (const parcels &parcel : shortparcel_unpacked)
-            cout << parcel.this_id() << ", ";
-        cout << "\n";
+        try
+        {
+            PROFILE_SCOPE("output/results");
+            result_writer results(results_path, results_format, &pool);
+            auto write_schedule_unpacked = [&](const string &scheduler_name, const vector<parcels> &unpacked, const external_unpacked &store) {
+                if (memory_budget_mb == 0)
+                    results.write_unpacked(scheduler_name, unpacked);
+                else
+                    results.write_unpacked(scheduler_name, store.size(), left_behind(store));
+            };
+            results.write_fleet("Random Parcels", randomfleet);
+            write_schedule_unpacked("Random Parcels", randomparcel_unpacked, randomparcel_left);
+            results.write_fleet("Most Parcels", mostparcelfleet);
+            write_schedule_unpacked("Most Parcels", mostparcel_unpacked, mostparcel_left);
+            results.write_fleet("Short Route", shortroutefleet);
+            write_schedule_unpacked("Short Route", shortparcel_unpacked, shortparcel_left);
+            results.write_fleet("Low Cost", lowcostfleet);
+            write_schedule_unpacked("Low Cost", lowcost_unpacked, lowcost_left);
+            if (exact)
+            {
+                results.write_fleet("Exact", exactfleet);
+                results.write_unpacked("Exact", exact_unpacked);
+            }
+            results.close();
+            cout << "The routes and parcel manifests of every truck have been written to the " << results_path << " file. \n";
+        }
+        catch (const result_invalidation::write_error &e)
+        {
+            cerr << e.what() << '\n';
+            return -1;
+        }
+        catch (const spill_invalidation::spill_error &e)
+        {
+            cerr << e.what() << '\n';
+            return -1;
+        }
     }
 
     route_stats.close();
-    cout << "The route statistics have been written to the route-stats.csv file. Here you will find information on each scheduling algorithm regarding the free volume left in the packed trucks, the average capacity used of the loaded trucks, as well as the standard deviation. You will also find information about the average distance travelled by the loaded trucks, as well as the standard deviation. \n";
+    cout << "The route statistics have been written to the route-stats.csv file. Here you will find information on each scheduling algorithm regarding the free volume left in the packed trucks, the average capacity used of the loaded trucks, as well as the standard deviation. You will also find information about the average distance travelled by the loaded trucks, including the drive back to their depot, as well as the standard deviation, the time each scheduling algorithm took, and the total cost of running the loaded trucks. The lower bounds on the number of trucks and the distance needed for the loaded parcels are also given, with the gap between each schedule and its bounds. \n";
+
+#ifdef FEDEX_PROFILE
+    if (profile::write_csv("route-profile.csv"))
+        cout << "The timings and counters of this run have been written to the route-profile.csv file. \n";
+    else
+        cout << "Error opening output file for the run profile!";
+#endif
 }
@@ -0,0 +1,456 @@
+/**
+ * @file pickup.hpp
+ * @author Cassandra Masschelein
+ * @brief Define pickup-and-delivery routes, where a truck collects each parcel from its source city before delivering it
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "timing.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief The load carried when leaving each stop of a route, indexed so that the most load over a range of stops is found, and a
+ * load is added to a range of stops, in logarithmic time. An added load is kept on the largest ranges it covers, and a query
+ * adds the loads kept above the ranges it reads on its way up instead of pushing them down. Stops are added to the end of the route in room reserved by doubling
+ *
+ */
+class load_profile
+{
+public:
+    /**
+     * @brief Index the load carried when leaving each stop of a route
+     *
+     * @param onboard The load carried when leaving each stop
+     */
+    void build(const vector<load_vector> &onboard)
+    {
+        stops = onboard.size();
+        leaves = 1;
+        while (leaves < stops)
+            leaves *= 2;
+        tree.assign(2 * leaves, load_vector{});
+        pending.assign(leaves, load_vector{});
+        copy(onboard.begin(), onboard.end(), tree.begin() + (int64_t)leaves);
+        last_stop = onboard.empty() ? load_vector{} : onboard.back();
+        for (uint64_t node = leaves; node-- > 1;)
+            tree[node] = most_of(tree[2 * node], tree[2 * node + 1]);
+    }
+
+    /**
+     * @brief Add a stop to the end of the route
+     *
+     * @param carried The load carried when leaving the stop
+     */
+    void push_back(const load_vector &carried)
+    {
+        if (stops == leaves) // Reserve room for as many stops again
+        {
+            vector<load_vector> onboard;
+            write(onboard);
+            onboard.push_back(carried);
+            build(onboard);
+            return;
+        }
+        /* A range that was added to is within the stops already on the route, so no load is pending above the new stop. */
+        tree[leaves + stops] = carried;
+        rebuild(leaves + stops);
+        stops++;
+        last_stop = carried;
+    }
+
+    /**
+     * @brief Add a load to every stop in a range of stops
+     *
+     * @param first The position of the first stop of the range
+     * @param last The position after the last stop of the range
+     * @param load The load to be added
+     */
+    void add(uint64_t first, uint64_t last, const load_vector &load)
+    {
+        if (first >= last)
+            return;
+        if (last == stops)
+        {
+            for (uint64_t i = 0; i < capacity_dimensions; i++)
+                last_stop[i] += load[i];
+        }
+        uint64_t first_leaf = first + leaves, last_leaf = last - 1 + leaves;
+        for (first += leaves, last += leaves; first < last; first /= 2, last /= 2)
+        {
+            if (first % 2 == 1)
+                apply(first++, load);
+            if (last % 2 == 1)
+                apply(--last, load);
+        }
+        rebuild(first_leaf);
+        rebuild(last_leaf);
+    }
+
+    /**
+     * @brief The most load carried when leaving any stop in a range of stops
+     *
+     * @param first The position of the first stop of the range
+     * @param last The position after the last stop of the range
+     * @return The largest load in each capacity dimension
+     */
+    load_vector most(uint64_t first, uint64_t last) const
+    {
+        load_vector left{}, right{};
+        bool left_read = false, right_read = false;
+        for (first += leaves, last += leaves; first < last;)
+        {
+            if (first % 2 == 1)
+            {
+                left = most_of(left, tree[first++]);
+                left_read = true;
+            }
+            if (last % 2 == 1)
+            {
+                right = most_of(right, tree[--last]);
+                right_read = true;
+            }
+            first /= 2;
+            last /= 2;
+            /* The ranges read on each side are under the node before first and the node at last, so they carry the load kept there. */
+            if (left_read)
+                add_kept(left, first - 1);
+            if (right_read)
+                add_kept(right, last);
+        }
+        for (uint64_t node = first - 1; left_read and node > 1;)
+            add_kept(left, node /= 2);
+        for (uint64_t node = last; right_read and node > 1;)
+            add_kept(right, node /= 2);
+        return most_of(left, right);
+    }
+
+    /**
+     * @brief The load carried when leaving the last stop of the route
+     *
+     * @return The load in each capacity dimension
+     */
+    const load_vector &last() const
+    {
+        return last_stop;
+    }
+
+    /**
+     * @brief The most load carried when leaving any stop of the route
+     *
+     * @return The largest load in each capacity dimension
+     */
+    const load_vector &fullest() const
+    {
+        return tree[1];
+    }
+
+    /**
+     * @brief The load carried when leaving each stop, with every added load pushed down to the stops
+     *
+     * @param onboard Set to the load carried when leaving each stop
+     */
+    void write(vector<load_vector> &onboard)
+    {
+        for (uint64_t node = 1; node < leaves; node++)
+            push_node(node);
+        onboard.assign(tree.begin() + (int64_t)leaves, tree.begin() + (int64_t)(leaves + stops));
+    }
+
+private:
+    /**
+     * @brief The larger of two loads in each dimension
+     *
+     * @param a The first load
+     * @param b The second load
+     * @return The largest amount in each dimension
+     */
+    static load_vector most_of(const load_vector &a, const load_vector &b)
+    {
+        load_vector largest;
+        for (uint64_t i = 0; i < capacity_dimensions; i++)
+            largest[i] = max(a[i], b[i]);
+        return largest;
+    }
+
+    /**
+     * @brief Add a load to every stop under a node, keeping it at the node until it is pushed down
+     *
+     * @param node The node
+     * @param load The load to be added
+     */
+    void apply(const uint64_t &node, const load_vector &load)
+    {
+        for (uint64_t i = 0; i < capacity_dimensions; i++)
+            tree[node][i] += load[i];
+        if (node < leaves)
+        {
+            for (uint64_t i = 0; i < capacity_dimensions; i++)
+                pending[node][i] += load[i];
+        }
+    }
+
+    /**
+     * @brief Push the load kept at a node down to its two halves
+     *
+     * @param node The node
+     */
+    void push_node(const uint64_t &node)
+    {
+        if (pending[node] == load_vector{})
+            return;
+        apply(2 * node, pending[node]);
+        apply(2 * node + 1, pending[node]);
+        pending[node] = load_vector{};
+    }
+
+    /**
+     * @brief Add the load kept at a node to a load read from under it
+     *
+     * @param load The load read from under the node
+     * @param node The node
+     */
+    void add_kept(load_vector &load, const uint64_t &node) const
+    {
+        if (node == 0 or node >= leaves)
+            return;
+        for (uint64_t i = 0; i < capacity_dimensions; i++)
+            load[i] += pending[node][i];
+    }
+
+    /**
+     * @brief Recompute the most load of every range above a stop
+     *
+     * @param leaf The node of the stop
+     */
+    void rebuild(uint64_t leaf)
+    {
+        for (leaf /= 2; leaf >= 1; leaf /= 2)
+        {
+            tree[leaf] = most_of(tree[2 * leaf], tree[2 * leaf + 1]);
+            for (uint64_t i = 0; i < capacity_dimensions; i++)
+                tree[leaf][i] += pending[leaf][i];
+        }
+    }
+
+    uint64_t stops = 0, leaves = 0;
+    load_vector last_stop{}; // The load carried when leaving the last stop, kept so that it is read without a query
+    /**
+     * @brief The most load over each range of stops including the loads kept above it, the stops themselves are the second half,
+     * and the load added to each range that is not yet pushed down to its halves
+     *
+     */
+    vector<load_vector> tree;
+    vector<load_vector> pending;
+};
+
+/**
+ * @brief A parcel to be picked up and delivered, with its cities numbered by the planner so that trucks can be checked without comparing names
+ *
+ */
+struct pickup_request
+{
+    const parcels *parcel;
+    uint32_t source, dest; // The numbers of the source and destination cities
+};
+
+/**
+ * @brief Loads parcels onto trucks that pick each parcel up at its source city and deliver it later on the same route. A parcel is
+ * picked up at the last stop in its source city, or at a new stop at the end of the route, and delivered at the next stop in its
+ * destination city after that, or at a new stop at the end of the route. The parcel is on the truck between the two stops, so the
+ * room it needs is checked against the most load carried over those stops. The room left on a truck is the room at its fullest point.
+ * Routes can visit a city many times, so the stops of each truck are indexed by city and each truck is checked in logarithmic time
+ *
+ */
+class pickup_planner
+{
+public:
+    /**
+     * @brief Construct a new pickup planner object
+     *
+     * @param _clock The travel times used to deliver parcels on time, or nullptr to ignore time
+     */
+    explicit pickup_planner(const travel_clock *_clock = nullptr) : clock(_clock) {}
+
+    /**
+     * @brief Index the stops and the load carried along each route. A truck loaded without this planner is taken to carry its
+     * whole load from the depot to the end of its route
+     *
+     * @param truck_list The list of trucks that parcels will be loaded onto
+     */
+    void prepare(const item_span<trucks> &truck_list)
+    {
+        profiles.assign(truck_list.size(), load_profile());
+        stops.assign(truck_list.size(), unordered_map<uint32_t, vector<uint64_t> >());
+        for (uint64_t t_index = 0; t_index < truck_list.size(); t_index++)
+        {
+            trucks &truck = truck_list[t_index];
+            if (truck.onboard.size() != truck.route.size())
+            {
+                load_vector used;
+                for (uint64_t i = 0; i < capacity_dimensions; i++)
+                    used[i] = truck.limits()[i] - truck.avail_load[i];
+                truck.onboard.assign(truck.route.size(), used);
+            }
+            profiles[t_index].build(truck.onboard);
+            for (uint64_t k = 0; k < truck.route.size(); k++)
+                stops[t_index][number(truck.route[k])].push_back(k);
+        }
+    }
+
+    /**
+     * @brief Number the cities of a parcel, once before the trucks are checked
+     *
+     * @param parcel The parcel to be picked up and delivered
+     * @return The request to check trucks with
+     */
+    pickup_request request(const parcels &parcel)
+    {
+        return {&parcel, number(parcel.where_from()), number(parcel.where_to())};
+    }
+
+    /**
+     * @brief Check if a truck can pick a parcel up and deliver it, with room for it at every stop in between and, when time is
+     * considered, without a delivery missing its window or the route passing the shift limit
+     *
+     * @param truck_list The list of trucks
+     * @param t_index The index of the truck
+     * @param req The parcel to be picked up and delivered
+     * @param on_route Set to whether the truck already stops at the destination after the pickup
+     * @return True or False whether the truck can carry the parcel
+     */
+    bool can_pack(const item_span<const trucks> &truck_list, const uint64_t &t_index, const pickup_request &req, bool &on_route) const
+    {
+        const trucks &truck = truck_list[t_index];
+        const parcels &parcel = *req.parcel;
+        uint64_t pickup, delivery, length = truck.route.size();
+        plan(t_index, length, req, pickup, delivery);
+        on_route = delivery < length;
+        load_vector carried = pickup < length ? profiles[t_index].most(pickup, delivery) : profiles[t_index].last();
+        for (uint64_t i = 0; i < capacity_dimensions; i++)
+        {
+            if (carried[i] > truck.limits()[i] or parcel.load()[i] > truck.limits()[i] - carried[i])
+                return false;
+        }
+        if (not clock)
+            return true;
+        if (pickup == length)
+            return clock->can_append_pickup(truck, parcel.where_from(), parcel.where_to(), parcel.window());
+        if (delivery == length)
+            return clock->can_insert(truck, length, parcel.where_to(), parcel.window());
+        return clock->can_join(truck, delivery, parcel.window());
+    }
+
+    /**
+     * @brief Load a parcel onto a truck, adding its pickup and delivery stops to the route if needed
+     *
+     * @param truck_list The list of trucks
+     * @param t_index The index of the truck, checked with can_pack first
+     * @param req The parcel to be picked up and delivered
+     */
+    void pack(const item_span<trucks> &truck_list, const uint64_t &t_index, const pickup_request &req)
+    {
+        trucks &truck = truck_list[t_index];
+        const parcels &parcel = *req.parcel;
+        uint64_t pickup, delivery;
+        plan(t_index, truck.route.size(), req, pickup, delivery);
+        truck.parcels_list.push_back(parcel.this_id());
+        load_profile &profile = profiles[t_index];
+        if (pickup == truck.route.size())
+        {
+            stops[t_index][req.source].push_back(truck.route.size());
+            truck.route.push_back(parcel.where_from());
+            profile.push_back(profile.last());
+            if (clock)
+                clock->time_last_stop(truck, time_window());
+            delivery = truck.route.size();
+        }
+        if (delivery == truck.route.size())
+        {
+            stops[t_index][req.dest].push_back(truck.route.size());
+            truck.route.push_back(parcel.where_to());
+            profile.push_back(profile.last());
+            if (clock)
+                clock->time_last_stop(truck, parcel.window());
+        }
+        else if (clock)
+            clock->join(truck, delivery, parcel.window());
+
+        /* The parcel is on the truck from its pickup stop until its delivery stop. */
+        profile.add(pickup, delivery, parcel.load());
+        for (uint64_t i = 0; i < capacity_dimensions; i++)
+            truck.avail_load[i] = truck.limits()[i] - profile.fullest()[i];
+    }
+
+    /**
+     * @brief Write the load carried when leaving each stop onto the trucks, which is only kept in the planner while parcels are loaded
+     *
+     * @param truck_list The list of trucks
+     */
+    void finish(const item_span<trucks> &truck_list)
+    {
+        for (uint64_t t_index = 0; t_index < truck_list.size() and t_index < profiles.size(); t_index++)
+            profiles[t_index].write(truck_list[t_index].onboard);
+    }
+
+private:
+    /**
+     * @brief The number of a city, numbering it if it has not been seen before
+     *
+     * @param city The city name
+     * @return The number of the city
+     */
+    uint32_t number(const string &city)
+    {
+        return city_numbers.emplace(city, (uint32_t)city_numbers.size()).first->second;
+    }
+
+    /**
+     * @brief Find the stops where a parcel would be picked up and delivered
+     *
+     * @param t_index The index of the truck
+     * @param length The number of stops on the trucks route
+     * @param req The parcel
+     * @param pickup The position of the last stop in the source city, or the length of the route for a new stop at the end
+     * @param delivery The position of the first stop in the destination city after the pickup, or the length of the route for a new stop at the end
+     */
+    void plan(const uint64_t &t_index, const uint64_t &length, const pickup_request &req, uint64_t &pickup, uint64_t &delivery) const
+    {
+        pickup = delivery = length;
+        const unordered_map<uint32_t, vector<uint64_t> > &visits = stops[t_index];
+        auto at_source = visits.find(req.source);
+        if (at_source == visits.end())
+            return;
+        pickup = at_source->second.back();
+        auto at_dest = visits.find(req.dest);
+        if (at_dest == visits.end())
+            return;
+        auto after = upper_bound(at_dest->second.begin(), at_dest->second.end(), pickup);
+        if (after != at_dest->second.end())
+            delivery = *after;
+    }
+
+    /**
+     * @brief The travel times used to deliver parcels on time, time is not considered if it is nullptr
+     *
+     */
+    const travel_clock *clock;
+    /**
+     * @brief The load carried along the route of each truck, and the positions of the stops of each truck in each city
+     *
+     */
+    vector<load_profile> profiles;
+    vector<unordered_map<uint32_t, vector<uint64_t> > > stops;
+    unordered_map<string, uint32_t> city_numbers;
+};
@@ -0,0 +1,228 @@
+/**
+ * @file profile.hpp
+ * @author Cassandra Masschelein
+ * @brief Define scoped timers and counters for finding where the program spends its time. Profiling is compiled in with -DFEDEX_PROFILE and costs nothing otherwise
+ * @version 0.1
+ * @date 2022-01-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <fstream>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/**
+ * @brief The events that are counted while the program runs
+ *
+ */
+enum class profile_counter
+{
+    fields_validated,         // Data file entries that were validated
+    parcels_assigned,         // Parcels loaded onto a truck
+    candidate_trucks_scanned, // Trucks checked for room while choosing a truck for a parcel
+    distance_lookups,         // Calls to distanceMap::distance
+    distance_cache_hits,      // Lazy distances found in the cache
+    distance_cache_misses,    // Lazy distances computed from the road graph
+    allocations,              // Calls to operator new
+    cross_node_steals,        // Tasks a worker took from the queue of a worker on another NUMA node
+    remote_distance_lookups,  // Distance lookups by threads on a NUMA node without its own copy of the distance matrix
+    exact_nodes,              // Search nodes visited by the exact packer
+    num_counters
+};
+
+/**
+ * @brief The names of the counters, in the same order as profile_counter
+ *
+ */
+const char *const profile_counter_names[] = {"fields_validated", "parcels_assigned", "candidate_trucks_scanned", "distance_lookups", "distance_cache_hits", "distance_cache_misses", "allocations", "cross_node_steals", "remote_distance_lookups", "exact_nodes"};
+
+/**
+ * @brief The total time and number of calls recorded by one timer
+ *
+ */
+struct profile_timer
+{
+    string name;
+    atomic<uint64_t> calls{0};
+    atomic<uint64_t> total_ns{0};
+};
+
+/**
+ * @brief The timers and counters of this program
+ *
+ */
+class profile
+{
+public:
+    /**
+     * @brief Find or create the timer with a given name. Each call site looks up its timer once
+     *
+     * @param name The name of the timer
+     * @return The timer
+     */
+    static profile_timer &timer(const string &name)
+    {
+        lock_guard<mutex> lock(registry_mutex());
+        for (profile_timer &t : timers())
+        {
+            if (t.name == name)
+                return t;
+        }
+        timers().emplace_back();
+        timers().back().name = name;
+        return timers().back();
+    }
+
+    /**
+     * @brief Add to a counter
+     *
+     * @param c The counter
+     * @param amount The amount to add
+     */
+    static void count(const profile_counter &c, const uint64_t &amount = 1)
+    {
+        counters()[(uint64_t)c].fetch_add(amount, memory_order_relaxed);
+    }
+
+    /**
+     * @brief Read a counter
+     *
+     * @param c The counter
+     * @return The value of the counter
+     */
+    static uint64_t value(const profile_counter &c)
+    {
+        return counters()[(uint64_t)c].load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief Write every timer and counter to a CSV file
+     *
+     * @param path The path of the profile file
+     * @return True or False whether the file could be written
+     */
+    static bool write_csv(const string &path)
+    {
+        ofstream out(path);
+        if (!out.is_open())
+            return false;
+        out << "Kind, Name, Calls or Count, Total Time (ms)\n";
+        {
+            lock_guard<mutex> lock(registry_mutex());
+            for (const profile_timer &t : timers())
+                out << "timer, " << t.name << ", " << t.calls.load() << ", " << (double)t.total_ns.load() / 1e6 << "\n";
+        }
+        for (uint64_t i = 0; i < (uint64_t)profile_counter::num_counters; i++)
+            out << "counter, " << profile_counter_names[i] << ", " << counters()[i].load() << ", \n";
+        return true;
+    }
+
+private:
+    static mutex &registry_mutex()
+    {
+        static mutex m;
+        return m;
+    }
+
+    /**
+     * @brief The timers, in a deque so that references stay valid as timers are added
+     *
+     */
+    static deque<profile_timer> &timers()
+    {
+        static deque<profile_timer> t;
+        return t;
+    }
+
+    static atomic<uint64_t> *counters()
+    {
+        static atomic<uint64_t> c[(uint64_t)profile_counter::num_counters];
+        return c;
+    }
+};
+
+/**
+ * @brief A timer that records the time from its construction to the end of the enclosing scope
+ *
+ */
+class scoped_timer
+{
+public:
+    explicit scoped_timer(profile_timer &_timer) : timer(_timer), start(chrono::steady_clock::now()) {}
+
+    ~scoped_timer()
+    {
+        timer.calls.fetch_add(1, memory_order_relaxed);
+        timer.total_ns.fetch_add((uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count(), memory_order_relaxed);
+    }
+
+private:
+    profile_timer &timer;
+    chrono::steady_clock::time_point start;
+};
+
+#define FEDEX_PROFILE_JOIN_(a, b) a##b
+#define FEDEX_PROFILE_JOIN(a, b) FEDEX_PROFILE_JOIN_(a, b)
+
+#ifdef FEDEX_PROFILE
+/* Time the rest of the enclosing scope. */
+#define PROFILE_SCOPE(name)                                                                              \
+    static profile_timer &FEDEX_PROFILE_JOIN(profile_timer_, __LINE__) = profile::timer(name);         \
+    scoped_timer FEDEX_PROFILE_JOIN(profile_scope_, __LINE__)(FEDEX_PROFILE_JOIN(profile_timer_, __LINE__))
+/* Add to a counter. */
+#define PROFILE_COUNT(counter, amount) profile::count(profile_counter::counter, amount)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#endif
+
+/**
+ * @brief Time a single call, such as a statistic in the middle of an expression
+ *
+ * @param name The name of the timer
+ * @param f The function to be called
+ * @return The result of the function
+ */
+template <class function_type>
+auto profile_call(const char *name, function_type f) -> decltype(f())
+{
+#ifdef FEDEX_PROFILE
+    scoped_timer timer(profile::timer(name));
+#else
+    (void)name;
+#endif
+    return f();
+}
+
+#ifdef FEDEX_PROFILE
+/* Count every allocation. Each program in this repository is a single translation unit, so these replacements are defined once. */
+void *operator new(size_t size)
+{
+    profile::count(profile_counter::allocations);
+    if (void *p = malloc(size == 0 ? 1 : size))
+        return p;
+    throw bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+#endif
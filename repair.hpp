@@ -0,0 +1,751 @@
+/**
+ * @file repair.hpp
+ * @author Cassandra Masschelein
+ * @brief Repair an existing delivery schedule when parcels or trucks change during the day, without scheduling the whole day again
+ * @version 0.1
+ * @date 2022-02-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "schedule.hpp"
+#include "timing.hpp"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Unique error messages for invalid schedule changes
+ *
+ */
+namespace repair_invalidation
+{
+    /**
+     * @brief Error message for when a change names a parcel that is not in the schedule
+     *
+     */
+    class unknown_parcel : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new unknown parcel object
+         *
+         */
+            unknown_parcel() : invalid_argument("A cancelled parcel is not in the schedule!"){};
+    };
+
+    /**
+     * @brief Error message for when a change names a truck that is not in service
+     *
+     */
+    class unknown_truck : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new unknown truck object
+         *
+         */
+            unknown_truck() : invalid_argument("A broken down truck is not in service in the schedule!"){};
+    };
+
+    /**
+     * @brief Error message for when an added parcel has the ID of a parcel that is already in the schedule
+     *
+     */
+    class duplicate_parcel : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new duplicate parcel object
+         *
+         */
+            duplicate_parcel() : invalid_argument("All parcel IDs in the schedule must be unique!"){};
+    };
+
+    /**
+     * @brief Error message for when a truck was loaded with pickup and delivery, which repair cannot keep
+     *
+     */
+    class pickup_schedule : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new pickup schedule object
+         *
+         */
+            pickup_schedule() : invalid_argument("A pickup and delivery schedule cannot be repaired!"){};
+    };
+}
+
+/**
+ * @brief A set of changes to the parcels and trucks of a schedule that is already in progress
+ *
+ */
+struct fleet_delta
+{
+    vector<parcels> added_parcels;     // New parcels to be delivered
+    vector<uint64_t> cancelled_parcels; // The IDs of parcels that no longer need delivering
+    vector<trucks> added_trucks;       // Trucks that have come into service, with no parcels loaded
+    vector<uint64_t> broken_trucks;    // The IDs of trucks that have gone out of service
+};
+
+/**
+ * @brief The room left on the trucks at one depot, in the order the trucks joined the depot. Finds the first truck with room
+ * for a parcel using a tree of the most room in each dimension over each range of trucks, so ranges without room are skipped
+ *
+ */
+class capacity_index
+{
+public:
+    /**
+     * @brief Add a truck after the trucks already in the index
+     *
+     * @param room The room left on the truck in each capacity dimension
+     * @return The position of the truck in the index
+     */
+    uint64_t add(const load_vector &room)
+    {
+        if (used == leaves)
+        {
+            /* Double the number of positions and rebuild the tree, so adding trucks costs constant time on average. */
+            vector<load_vector> old_leaves(tree.begin() + (int64_t)leaves, tree.begin() + (int64_t)(leaves + used));
+            leaves = max<uint64_t>(1, leaves * 2);
+            tree.assign(2 * leaves, load_vector{});
+            in_service.resize(leaves, false);
+            copy(old_leaves.begin(), old_leaves.end(), tree.begin() + (int64_t)leaves);
+            for (uint64_t node = leaves - 1; node >= 1; node--)
+                combine(node);
+        }
+        in_service[used] = true;
+        update(used, room);
+        return used++;
+    }
+
+    /**
+     * @brief Change the room left on a truck
+     *
+     * @param position The position of the truck in the index
+     * @param room The room left on the truck in each capacity dimension
+     */
+    void update(const uint64_t &position, const load_vector &room)
+    {
+        uint64_t node = leaves + position;
+        tree[node] = room;
+        for (node /= 2; node >= 1; node /= 2)
+            combine(node);
+    }
+
+    /**
+     * @brief Take a truck out of service, so that it is never chosen again
+     *
+     * @param position The position of the truck in the index
+     */
+    void remove(const uint64_t &position)
+    {
+        in_service[position] = false;
+        update(position, load_vector{});
+    }
+
+    /**
+     * @brief Find the first truck with room for a parcel in every dimension, at or after a position
+     *
+     * @param load The room the parcel takes up in each capacity dimension
+     * @param position The position of the truck in the index
+     * @param from The first position that may be chosen
+     * @return True or False whether any truck from that position on has room for the parcel
+     */
+    bool first_fit(const load_vector &load, uint64_t &position, const uint64_t &from = 0) const
+    {
+        return used != 0 and search(1, 0, leaves, load, from, position);
+    }
+
+    /**
+     * @brief The most room left on any one truck in each dimension
+     *
+     * @return The largest room in each capacity dimension
+     */
+    load_vector most_room() const
+    {
+        return used == 0 ? load_vector{} : tree[1];
+    }
+
+private:
+    /**
+     * @brief Set a node of the tree to the most room of its two children in each dimension
+     *
+     * @param node The node
+     */
+    void combine(const uint64_t &node)
+    {
+        for (uint64_t i = 0; i < capacity_dimensions; i++)
+            tree[node][i] = max(tree[2 * node][i], tree[2 * node + 1][i]);
+    }
+
+    /**
+     * @brief Find the first truck under a node with room for a parcel. A range whose most room in some dimension is too
+     * small, or that ends before the first position allowed, is skipped
+     *
+     * @param node The node to search under
+     * @param low The first position under the node
+     * @param high The position after the last one under the node
+     * @param load The room the parcel takes up in each capacity dimension
+     * @param from The first position that may be chosen
+     * @param position The position of the truck in the index
+     * @return True or False whether a truck under the node has room for the parcel
+     */
+    bool search(const uint64_t &node, const uint64_t &low, const uint64_t &high, const load_vector &load, const uint64_t &from, uint64_t &position) const
+    {
+        if (high <= from or not fits(load, tree[node]))
+            return false;
+        if (node >= leaves)
+        {
+            position = low;
+            return in_service[position];
+        }
+        uint64_t middle = (low + high) / 2;
+        return search(2 * node, low, middle, load, from, position) or search(2 * node + 1, middle, high, load, from, position);
+    }
+
+    uint64_t leaves = 0, used = 0;
+    /**
+     * @brief The most room in each dimension over each range of trucks, the trucks themselves are the second half
+     *
+     */
+    vector<load_vector> tree;
+    vector<bool> in_service;
+};
+
+/**
+ * @brief A schedule that can be repaired as parcels and trucks change during the day. Indexing the schedule costs time
+ * proportional to the whole day once, after which each repair only touches the trucks and parcels named by the change.
+ * Parcels keep their truck unless they are cancelled or their truck breaks down. Once any parcel has a time window or any
+ * truck has a shift limit, parcels are only loaded onto trucks that can still deliver them on time. Parcels are always loaded at
+ * the depot, so a schedule made with pickup and delivery is refused
+ *
+ */
+class fleet_repair
+{
+public:
+    /**
+     * @brief Construct a new fleet repair object from a schedule
+     *
+     * @param _truck_list The scheduled trucks, with their loaded parcels and routes
+     * @param parcel_list Every parcel of the day, loaded or not. Parcels that are not on any truck wait for room to free up
+     * @param _dmap The distance map used to find the depot that owns each parcel, and the travel times of the trucks
+     * @throws repair_invalidation::pickup_schedule If any truck was loaded with pickup and delivery, since rebuilding its route
+     * would drop its pickup stops
+     */
+    fleet_repair(const vector<trucks> &_truck_list, const vector<parcels> &parcel_list, const distanceMap &_dmap) : dmap(_dmap), clock(_dmap)
+    {
+        for (const parcels &parcel : parcel_list)
+        {
+            if (not catalogue.emplace(parcel.this_id(), parcel).second)
+                throw repair_invalidation::duplicate_parcel();
+        }
+        for (const trucks &truck : _truck_list)
+        {
+            if (not truck.onboard.empty())
+                throw repair_invalidation::pickup_schedule();
+            uint64_t t_index = add_truck(truck);
+            for (const uint64_t &id : truck.parcels_list)
+            {
+                if (catalogue.count(id) == 0)
+                    throw repair_invalidation::unknown_parcel();
+                parcel_truck[id] = t_index;
+            }
+        }
+        for (const parcels &parcel : parcel_list)
+        {
+            if (parcel_truck.count(parcel.this_id()) == 0)
+                wait(parcel, owning_depot(parcel, depots, dmap));
+        }
+        if (needs_timing(parcel_list, _truck_list))
+            start_timing();
+    }
+
+    /**
+     * @brief Repair the schedule after a change. Cancelled parcels are unloaded, the parcels of broken down trucks are moved to
+     * other trucks from the same depot, and added parcels are loaded onto a truck that already stops at their destination or
+     * else the first truck with room. Parcels that were waiting for room at a depot are tried again, smallest first, if the change
+     * freed up room there, stopping at the first parcel with more volume than any truck the change freed up room on has left
+     *
+     * @param delta The change to the parcels and trucks
+     * @return A list of parcels that could not get loaded on trucks due to lack of capacity, they wait for a later repair
+     */
+    vector<parcels> apply(const fleet_delta &delta)
+    {
+        validate(delta);
+        if (not timed and needs_timing(delta.added_parcels, delta.added_trucks))
+            start_timing();
+        changed.clear();
+        vector<uint64_t> dirty; // Trucks that lost parcels and need their routes rebuilt
+        set<uint64_t> room_freed; // Depots where room became available
+
+        for (const uint64_t &id : delta.cancelled_parcels)
+        {
+            auto loaded = parcel_truck.find(id);
+            if (loaded != parcel_truck.end())
+            {
+                trucks &truck = truck_list[loaded->second];
+                truck.parcels_list.erase(find(truck.parcels_list.begin(), truck.parcels_list.end(), id));
+                for (uint64_t i = 0; i < capacity_dimensions; i++)
+                    truck.avail_load[i] += catalogue.at(id).load()[i];
+                depot_index[truck_depot[loaded->second]].update(truck_position[loaded->second], truck.avail_load);
+                dirty.push_back(loaded->second);
+                room_freed.insert(truck_depot[loaded->second]);
+                parcel_truck.erase(loaded);
+            }
+            else
+                unwait(catalogue.at(id));
+            catalogue.erase(id);
+        }
+
+        /* The parcels of broken down trucks are moved before any new parcels are loaded. */
+        vector<uint64_t> to_load;
+        for (const uint64_t &id : delta.broken_trucks)
+        {
+            uint64_t t_index = truck_lookup.at(id);
+            trucks &truck = truck_list[t_index];
+            in_service[t_index] = false;
+            depot_index[truck_depot[t_index]].remove(truck_position[t_index]);
+            for (const string &stop : truck.route)
+                stop_trucks[stop].erase(t_index);
+            for (const uint64_t &parcel_id : truck.parcels_list)
+            {
+                parcel_truck.erase(parcel_id);
+                to_load.push_back(parcel_id);
+            }
+            changed.push_back(id);
+        }
+
+        /* A new depot can change which depot owns a waiting parcel, so every waiting parcel is tried again. */
+        uint64_t old_depots = depots.size();
+        vector<uint64_t> added;
+        for (const trucks &truck : delta.added_trucks)
+        {
+            uint64_t t_index = add_truck(truck);
+            added.push_back(t_index);
+            room_freed.insert(truck_depot[t_index]);
+            changed.push_back(truck.my_id());
+        }
+        if (depots.size() != old_depots)
+        {
+            for (const uint64_t &id : waiting_ids())
+            {
+                unwait(catalogue.at(id));
+                to_load.push_back(id);
+            }
+        }
+
+        sort(dirty.begin(), dirty.end());
+        dirty.erase(unique(dirty.begin(), dirty.end()), dirty.end());
+        for (const uint64_t &t_index : dirty)
+        {
+            if (in_service[t_index])
+            {
+                rebuild_route(t_index);
+                changed.push_back(truck_list[t_index].my_id());
+            }
+        }
+
+        for (const parcels &parcel : delta.added_parcels)
+        {
+            catalogue.emplace(parcel.this_id(), parcel);
+            to_load.push_back(parcel.this_id());
+        }
+
+        vector<parcels> not_packed_parcels;
+        for (const uint64_t &id : to_load)
+        {
+            const parcels &parcel = catalogue.at(id);
+            uint64_t d;
+            if (not load(parcel, d))
+            {
+                wait(parcel, d);
+                not_packed_parcels.push_back(parcel);
+            }
+        }
+        /* Only the trucks that lost parcels or were added can take a waiting parcel that no truck could take before. */
+        vector<uint64_t> freed = added;
+        for (const uint64_t &t_index : dirty)
+        {
+            if (in_service[t_index])
+                freed.push_back(t_index);
+        }
+        for (const uint64_t &d : room_freed)
+        {
+            /* A parcel waited because no truck had room for it, so only parcels that fit the room left on a freed truck are tried. */
+            auto freed_room = [&]() {
+                uint64_t room = 0;
+                for (const uint64_t &t_index : freed)
+                {
+                    if (truck_depot[t_index] == d)
+                        room = max(room, truck_list[t_index].avail_load[(uint64_t)capacity_dimension::volume]);
+                }
+                return room;
+            };
+            for (auto next = depot_waiting[d].begin(); next != depot_waiting[d].end() and next->first <= freed_room();)
+            {
+                const parcels &parcel = catalogue.at((next++)->second);
+                uint32_t dest = truck_stops.number(parcel.where_to());
+                /* With time tracked a parcel can wait even when there is room, so it is first checked against the freed trucks alone. */
+                if (timed and none_of(freed.begin(), freed.end(), [&](const uint64_t &t_index) { return truck_depot[t_index] == d and can_load(t_index, parcel, dest); }))
+                    continue;
+                uint64_t owner;
+                if (load(parcel, owner))
+                    unwait(parcel);
+            }
+        }
+        sort(changed.begin(), changed.end());
+        changed.erase(unique(changed.begin(), changed.end()), changed.end());
+        return not_packed_parcels;
+    }
+
+    /**
+     * @brief The trucks that are still in service, in the order they were added
+     *
+     * @return A list of the trucks with their loaded parcels and routes
+     */
+    vector<trucks> current_trucks() const
+    {
+        vector<trucks> current;
+        for (uint64_t i = 0; i < truck_list.size(); i++)
+        {
+            if (in_service[i])
+                current.push_back(truck_list[i]);
+        }
+        return current;
+    }
+
+    /**
+     * @brief The parcels that are waiting for room on a truck
+     *
+     * @return A list of the parcels that are not loaded on any truck
+     */
+    vector<parcels> unpacked_parcels() const
+    {
+        vector<parcels> unpacked;
+        for (const uint64_t &id : waiting_ids())
+            unpacked.push_back(catalogue.at(id));
+        return unpacked;
+    }
+
+    /**
+     * @brief The trucks whose load or service changed in the last repair
+     *
+     * @return A list of truck IDs
+     */
+    const vector<uint64_t> &changed_trucks() const
+    {
+        return changed;
+    }
+
+private:
+    /**
+     * @brief Check every ID named by a change before the schedule is touched, so that an invalid change leaves the schedule as it was
+     *
+     * @param delta The change to the parcels and trucks
+     */
+    void validate(const fleet_delta &delta) const
+    {
+        unordered_set<uint64_t> cancelled, broken, added_trucks, added_parcels;
+        for (const uint64_t &id : delta.cancelled_parcels)
+        {
+            if (catalogue.count(id) == 0 or not cancelled.insert(id).second)
+                throw repair_invalidation::unknown_parcel();
+        }
+        for (const uint64_t &id : delta.broken_trucks)
+        {
+            auto found = truck_lookup.find(id);
+            if (found == truck_lookup.end() or not in_service[found->second] or not broken.insert(id).second)
+                throw repair_invalidation::unknown_truck();
+        }
+        for (const trucks &truck : delta.added_trucks)
+        {
+            if (truck_lookup.count(truck.my_id()) != 0 or not added_trucks.insert(truck.my_id()).second)
+                throw fleet_invalidation::unique_id();
+            if (not truck.onboard.empty())
+                throw repair_invalidation::pickup_schedule();
+        }
+        for (const parcels &parcel : delta.added_parcels)
+        {
+            bool replaces = cancelled.count(parcel.this_id()) != 0; // A cancelled parcel ID may be reused in the same change
+            if ((catalogue.count(parcel.this_id()) != 0 and not replaces) or not added_parcels.insert(parcel.this_id()).second)
+                throw repair_invalidation::duplicate_parcel();
+        }
+    }
+
+    /**
+     * @brief Put a parcel in the waiting list of the depot that owns it
+     *
+     * @param parcel The parcel that could not be loaded
+     * @param d The index of the owning depot, or the number of depots if no depot can reach the parcel
+     */
+    void wait(const parcels &parcel, const uint64_t &d)
+    {
+        if (d == depots.size())
+        {
+            unreachable_waiting.insert(parcel.this_id());
+            waiting_depot[parcel.this_id()] = no_depot;
+        }
+        else
+        {
+            depot_waiting[d].insert({parcel.volume(), parcel.this_id()});
+            waiting_depot[parcel.this_id()] = d;
+        }
+    }
+
+    /**
+     * @brief Take a parcel out of the waiting lists
+     *
+     * @param parcel The waiting parcel
+     */
+    void unwait(const parcels &parcel)
+    {
+        auto found = waiting_depot.find(parcel.this_id());
+        if (found->second == no_depot)
+            unreachable_waiting.erase(parcel.this_id());
+        else
+            depot_waiting[found->second].erase({parcel.volume(), parcel.this_id()});
+        waiting_depot.erase(found);
+    }
+
+    /**
+     * @brief The IDs of the waiting parcels, by depot and smallest parcel first
+     *
+     * @return A list of parcel IDs
+     */
+    vector<uint64_t> waiting_ids() const
+    {
+        vector<uint64_t> ids;
+        for (const set<pair<uint64_t, uint64_t> > &queue : depot_waiting)
+        {
+            for (const pair<uint64_t, uint64_t> &entry : queue)
+                ids.push_back(entry.second);
+        }
+        ids.insert(ids.end(), unreachable_waiting.begin(), unreachable_waiting.end());
+        return ids;
+    }
+
+    /**
+     * @brief Add a truck to the end of the truck list and index it by ID, depot, free space, and stops
+     *
+     * @param truck The truck to be added
+     * @return The index of the truck
+     */
+    uint64_t add_truck(const trucks &truck)
+    {
+        uint64_t t_index = truck_list.size();
+        if (not truck_lookup.emplace(truck.my_id(), t_index).second)
+            throw fleet_invalidation::unique_id();
+        uint64_t d = find(depots.begin(), depots.end(), truck.home_depot()) - depots.begin();
+        if (d == depots.size())
+        {
+            depots.push_back(truck.home_depot());
+            depot_index.emplace_back();
+            depot_trucks.emplace_back();
+            depot_waiting.emplace_back();
+        }
+        truck_list.push_back(truck);
+        in_service.push_back(true);
+        truck_depot.push_back(d);
+        truck_position.push_back(depot_index[d].add(truck.avail_load));
+        depot_trucks[d].push_back(t_index);
+        for (const string &stop : truck.route)
+            stop_trucks[stop].insert(t_index);
+        truck_stops.update(truck_list[t_index], t_index);
+        if (timed)
+            retime(t_index);
+        return t_index;
+    }
+
+    /**
+     * @brief Track time on every truck from now on, once the first parcel with a time window or truck with a shift limit appears
+     *
+     */
+    void start_timing()
+    {
+        timed = true;
+        for (uint64_t t_index = 0; t_index < truck_list.size(); t_index++)
+        {
+            if (in_service[t_index])
+                retime(t_index);
+        }
+    }
+
+    /**
+     * @brief Time the route of a truck from the depot, each stop has the window shared by every parcel delivered there
+     *
+     * @param t_index The index of the truck
+     */
+    void retime(const uint64_t &t_index)
+    {
+        trucks &truck = truck_list[t_index];
+        vector<time_window> windows(truck.route.size());
+        for (const uint64_t &id : truck.parcels_list)
+        {
+            const parcels &parcel = catalogue.at(id);
+            time_window &window = windows[find(truck.route.begin(), truck.route.end(), parcel.where_to()) - truck.route.begin()];
+            window.earliest = max(window.earliest, parcel.window().earliest);
+            window.latest = min(window.latest, parcel.window().latest);
+        }
+        clock.retime(truck, windows);
+    }
+
+    /**
+     * @brief Rebuild the route of a truck that lost parcels, keeping the remaining stops in the order they were visited, so that
+     * dropping a stop never makes a later stop late
+     *
+     * @param t_index The index of the truck
+     */
+    void rebuild_route(const uint64_t &t_index)
+    {
+        trucks &truck = truck_list[t_index];
+        unordered_set<string> delivered;
+        for (const uint64_t &id : truck.parcels_list)
+            delivered.insert(catalogue.at(id).where_to());
+        for (const string &stop : truck.route)
+            stop_trucks[stop].erase(t_index);
+        vector<string> visited;
+        visited.swap(truck.route);
+        truck.route.push_back(truck.home_depot());
+        for (uint64_t k = 1; k < visited.size(); k++)
+        {
+            if (delivered.count(visited[k]) != 0)
+                truck.route.push_back(visited[k]);
+        }
+        for (const string &stop : truck.route)
+            stop_trucks[stop].insert(t_index);
+        truck_stops.reindex(truck, t_index);
+        if (timed)
+            retime(t_index);
+    }
+
+    /**
+     * @brief Check if a truck has room for a parcel and, when time is tracked, can still deliver it on time
+     *
+     * @param t_index The index of the truck
+     * @param parcel The parcel to be loaded
+     * @param dest The parcel destination numbered by the stop index
+     * @return True or False whether the parcel can be loaded onto the truck
+     */
+    bool can_load(const uint64_t &t_index, const parcels &parcel, const uint32_t &dest) const
+    {
+        const trucks &truck = truck_list[t_index];
+        return fits(parcel.load(), truck.avail_load) and (not timed or clock.can_pack(truck, truck_stops.position(truck, t_index, dest), parcel));
+    }
+
+    /**
+     * @brief Load a parcel onto a truck from its depot, preferring the largest truck that already stops at its destination.
+     * When the first truck with room cannot deliver the parcel on time, the trucks of the depot are searched in order
+     *
+     * @param parcel The parcel to be loaded
+     * @param d The index of the depot that owns the parcel, or the number of depots if no depot can reach it
+     * @return True or False whether any truck had room for the parcel
+     */
+    bool load(const parcels &parcel, uint64_t &d)
+    {
+        d = owning_depot(parcel, depots, dmap);
+        if (d == depots.size())
+            return false;
+        uint64_t t_index = truck_list.size();
+        uint32_t dest = truck_stops.number(parcel.where_to());
+        auto stops = stop_trucks.find(parcel.where_to());
+        if (stops != stop_trucks.end())
+        {
+            for (const uint64_t &candidate : stops->second)
+            {
+                if (truck_depot[candidate] != d or not can_load(candidate, parcel, dest))
+                    continue;
+                if (t_index == truck_list.size() or larger_volume_truck(truck_list[candidate], truck_list[t_index]) or (truck_list[candidate].volume() == truck_list[t_index].volume() and candidate < t_index))
+                    t_index = candidate;
+            }
+        }
+        uint64_t position;
+        if (t_index == truck_list.size())
+        {
+            if (not depot_index[d].first_fit(parcel.load(), position))
+                return false;
+            t_index = depot_trucks[d][position];
+            /* With time tracked the next truck with room is tried until one can deliver on time, skipping trucks without room. */
+            while (timed and not can_load(t_index, parcel, dest))
+            {
+                if (not depot_index[d].first_fit(parcel.load(), position, position + 1))
+                    return false;
+                t_index = depot_trucks[d][position];
+            }
+        }
+
+        trucks &truck = truck_list[t_index];
+        if (timed)
+            clock.pack(truck, truck_stops.position(truck, t_index, dest), parcel);
+        else
+            truck.pack_truck(parcel);
+        truck_stops.update(truck, t_index);
+        depot_index[d].update(truck_position[t_index], truck.avail_load);
+        stop_trucks[parcel.where_to()].insert(t_index);
+        parcel_truck[parcel.this_id()] = t_index;
+        changed.push_back(truck.my_id());
+        PROFILE_COUNT(parcels_assigned, 1);
+        return true;
+    }
+
+    /**
+     * @brief The distance map used to find the depot that owns each parcel, and the travel times found from it
+     *
+     */
+    const distanceMap &dmap;
+    travel_clock clock;
+    bool timed = false; // If time is tracked on every truck
+    /**
+     * @brief Every truck that has been in service, with the depot, index position, and service state of each
+     *
+     */
+    vector<trucks> truck_list;
+    vector<bool> in_service;
+    vector<uint64_t> truck_depot, truck_position;
+    unordered_map<uint64_t, uint64_t> truck_lookup; // Truck ID to truck index
+    /**
+     * @brief The depots, with the free space index and truck indices of each
+     *
+     */
+    vector<string> depots;
+    vector<capacity_index> depot_index;
+    vector<vector<uint64_t> > depot_trucks;
+    /**
+     * @brief The trucks that stop at each city, and the stop of each truck in each city
+     *
+     */
+    unordered_map<string, unordered_set<uint64_t> > stop_trucks;
+    route_stops truck_stops;
+    /**
+     * @brief Every parcel in the schedule by ID, and the truck each loaded parcel is on
+     *
+     */
+    unordered_map<uint64_t, parcels> catalogue;
+    unordered_map<uint64_t, uint64_t> parcel_truck;
+    /**
+     * @brief The parcels waiting for room, by (volume, ID) at each depot, and the parcels no depot can reach
+     *
+     */
+    vector<set<pair<uint64_t, uint64_t> > > depot_waiting;
+    set<uint64_t> unreachable_waiting;
+    unordered_map<uint64_t, uint64_t> waiting_depot; // Parcel ID to the depot it waits at
+    static constexpr uint64_t no_depot = numeric_limits<uint64_t>::max();
+    /**
+     * @brief The IDs of the trucks changed by the last repair
+     *
+     */
+    vector<uint64_t> changed;
+};
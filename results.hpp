@@ -0,0 +1,444 @@
+/**
+ * @file results.hpp
+ * @author Cassandra Masschelein
+ * @brief Define a buffered writer for the routes, truck manifests, and unpacked parcels of each schedule
+ * @version 0.1
+ * @date 2022-03-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "thread_pool.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <charconv>
+#include <unordered_map>
+#include <optional>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Unique error messages for results that cannot be written
+ *
+ */
+namespace result_invalidation
+{
+    /**
+     * @brief Error message for when the results file cannot be opened or written
+     *
+     */
+    class write_error : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new write error object
+         *
+         * @param path The path of the results file
+         */
+            explicit write_error(const string &path) : invalid_argument("Error writing the results file " + path + "!"){};
+    };
+}
+
+/**
+ * @brief The formats the results can be written in
+ *
+ */
+enum class result_format
+{
+    csv,        // One row per truck with its route and manifest, and one row per schedule with its unpacked parcels
+    json_lines, // One JSON object per line, in the same records as the CSV format
+    binary      // Compact columns of numbers, with each city name written once
+};
+
+/**
+ * @brief Read the name of a result format
+ *
+ * @param name The name given on the command line
+ * @return The result format
+ */
+result_format parse_result_format(const string &name)
+{
+    if (name == "csv")
+        return result_format::csv;
+    if (name == "jsonl")
+        return result_format::json_lines;
+    if (name == "binary")
+        return result_format::binary;
+    throw invalid_argument("Unknown result format " + name + ", the formats are csv, jsonl, and binary!");
+}
+
+/**
+ * @brief Writes the routes and manifests of the trucks of each schedule, and the parcels each schedule could not load, to one file.
+ * Records are formatted into a large buffer that is written to the file in one call when it fills up, and the trucks of a large fleet
+ * are formatted in chunks on the thread pool and written in order, so writing keeps up with scheduling
+ *
+ */
+class result_writer
+{
+public:
+    /**
+     * @brief Construct a new result writer object, creating the results file
+     *
+     * @param _path The path of the results file
+     * @param _format The format of the results
+     * @param _pool The thread pool that formats chunks of trucks, or nullptr to format them on the calling thread
+     * @param _buffer_bytes How much is formatted before it is written to the file
+     */
+    result_writer(const string &_path, const result_format &_format, thread_pool *_pool = nullptr, const uint64_t &_buffer_bytes = 1 << 22)
+        : path(_path), format(_format), pool(_pool), buffer_bytes(max<uint64_t>(_buffer_bytes, 1))
+    {
+        out.open(path, ios::binary | ios::trunc);
+        if (!out.is_open())
+            throw result_invalidation::write_error(path);
+        buffer.reserve(buffer_bytes);
+        if (format == result_format::csv)
+            buffer += "Scheduler, Truck, Depot, Route, Parcels\n";
+        else if (format == result_format::binary)
+            buffer += binary_magic;
+    }
+
+    /**
+     * @brief Write the route and manifest of every truck in a fleet
+     *
+     * @param scheduler_name The name of the scheduling algorithm that built the fleet
+     * @param scheduled The fleet
+     */
+    void write_fleet(const string &scheduler_name, const fleet &scheduled)
+    {
+        const vector<trucks> &fleet_trucks = scheduled.trucks_in_fleet();
+        if (format == result_format::binary)
+        {
+            write_binary_fleet(scheduler_name, scheduled);
+            return;
+        }
+        /* Format a wave of chunks at a time, so that at most a few chunks wait in memory to be written. */
+        uint64_t chunks = (fleet_trucks.size() + chunk_trucks - 1) / chunk_trucks;
+        uint64_t wave = pool ? 2 * pool->size() : 1;
+        vector<string> formatted(wave);
+        optional<thread_pool::task_group> formatters;
+        if (pool)
+            formatters.emplace(*pool);
+        for (uint64_t first_chunk = 0; first_chunk < chunks; first_chunk += wave)
+        {
+            uint64_t last_chunk = min(chunks, first_chunk + wave);
+            for (uint64_t c = first_chunk; c < last_chunk; c++)
+            {
+                auto task = [&, c] {
+                    string &text = formatted[c - first_chunk];
+                    text.clear();
+                    for (uint64_t t = c * chunk_trucks; t < min(fleet_trucks.size(), (c + 1) * chunk_trucks); t++)
+                        format_truck(text, scheduler_name, fleet_trucks[t], scheduled.manifest(fleet_trucks[t].my_id()));
+                };
+                if (formatters)
+                    formatters->submit(task);
+                else
+                    task();
+            }
+            if (formatters)
+                formatters->wait();
+            for (uint64_t c = first_chunk; c < last_chunk; c++)
+                append(formatted[c - first_chunk]);
+        }
+    }
+
+    /**
+     * @brief Write the parcels a schedule could not load
+     *
+     * @param scheduler_name The name of the scheduling algorithm
+     * @param unpacked The parcels that were not loaded
+     */
+    void write_unpacked(const string &scheduler_name, const vector<parcels> &unpacked)
+    {
+        write_unpacked(scheduler_name, unpacked.size(), [&unpacked](auto visit) {
+            for (const parcels &parcel : unpacked)
+                visit(parcel);
+        });
+    }
+
+    /**
+     * @brief Write the parcels a schedule could not load as they are visited, so they never have to be held together. The parcel
+     * IDs go into the buffer one at a time and it is written to the file whenever it is full
+     *
+     * @tparam parcel_source A function taking a visitor and calling it with each parcel that was not loaded
+     * @param scheduler_name The name of the scheduling algorithm
+     * @param unpacked_count The number of parcels the source visits
+     * @param for_each_parcel The function
+     */
+    template <class parcel_source>
+    void write_unpacked(const string &scheduler_name, const uint64_t &unpacked_count, parcel_source for_each_parcel)
+    {
+        string text;
+        char separator = format == result_format::csv ? ';' : ',';
+        if (format == result_format::csv)
+        {
+            text += scheduler_name;
+            text += ", , , , ";
+        }
+        else if (format == result_format::json_lines)
+        {
+            text += "{\"scheduler\":";
+            append_json_string(text, scheduler_name);
+            text += ",\"unpacked\":[";
+        }
+        else
+        {
+            put_value<uint8_t>(text, unpacked_block);
+            put_string(text, scheduler_name);
+            put_value<uint64_t>(text, unpacked_count);
+        }
+        append(text);
+        bool first = true;
+        for_each_parcel([&](const parcels &parcel) {
+            if (format == result_format::binary)
+                put_value<uint64_t>(buffer, parcel.this_id());
+            else
+            {
+                if (not first)
+                    buffer += separator;
+                append_number(buffer, parcel.this_id());
+            }
+            first = false;
+            if (buffer.size() >= buffer_bytes)
+                flush();
+        });
+        if (format == result_format::csv)
+            append("\n");
+        else if (format == result_format::json_lines)
+            append("]}\n");
+    }
+
+    /**
+     * @brief Write everything that is still buffered and close the results file
+     *
+     */
+    void close()
+    {
+        flush();
+        out.close();
+        if (out.fail())
+            throw result_invalidation::write_error(path);
+    }
+
+private:
+    /**
+     * @brief Add a whole number to formatted text without going through a stream
+     *
+     * @param text The text being formatted
+     * @param value The number
+     */
+    static void append_number(string &text, const uint64_t &value)
+    {
+        char digits[20];
+        to_chars_result end = to_chars(digits, digits + sizeof(digits), value);
+        text.append(digits, end.ptr);
+    }
+
+    /**
+     * @brief Add a quoted JSON string to formatted text
+     *
+     * @param text The text being formatted
+     * @param value The string, quotes and backslashes are escaped
+     */
+    static void append_json_string(string &text, const string &value)
+    {
+        text += '"';
+        for (const char &c : value)
+        {
+            if (c == '"' or c == '\\')
+                text += '\\';
+            text += c;
+        }
+        text += '"';
+    }
+
+    /**
+     * @brief Add a value to binary output in the byte order of this machine, as checkpoints are
+     *
+     * @tparam value_type The type of the value
+     * @param text The output being built
+     * @param value The value
+     */
+    template <class value_type>
+    static void put_value(string &text, const value_type &value)
+    {
+        text.append((const char *)&value, sizeof(value));
+    }
+
+    /**
+     * @brief Add a string to binary output, after its length
+     *
+     * @param text The output being built
+     * @param value The string
+     */
+    static void put_string(string &text, const string &value)
+    {
+        put_value<uint32_t>(text, (uint32_t)value.size());
+        text += value;
+    }
+
+    /**
+     * @brief Format the record of one truck as text
+     *
+     * @param text The text being formatted
+     * @param scheduler_name The name of the scheduling algorithm
+     * @param truck The truck
+     * @param manifest The IDs of the parcels loaded on the truck
+     */
+    void format_truck(string &text, const string &scheduler_name, const trucks &truck, const vector<uint64_t> &manifest) const
+    {
+        if (format == result_format::csv)
+        {
+            text += scheduler_name;
+            text += ", ";
+            append_number(text, truck.my_id());
+            text += ", ";
+            text += truck.home_depot();
+            text += ", ";
+            for (uint64_t i = 0; i < truck.route.size(); i++)
+            {
+                if (i != 0)
+                    text += ';';
+                text += truck.route[i];
+            }
+            text += ", ";
+            for (uint64_t i = 0; i < manifest.size(); i++)
+            {
+                if (i != 0)
+                    text += ';';
+                append_number(text, manifest[i]);
+            }
+            text += '\n';
+            return;
+        }
+        text += "{\"scheduler\":";
+        append_json_string(text, scheduler_name);
+        text += ",\"truck\":";
+        append_number(text, truck.my_id());
+        text += ",\"depot\":";
+        append_json_string(text, truck.home_depot());
+        text += ",\"route\":[";
+        for (uint64_t i = 0; i < truck.route.size(); i++)
+        {
+            if (i != 0)
+                text += ',';
+            append_json_string(text, truck.route[i]);
+        }
+        text += "],\"parcels\":[";
+        for (uint64_t i = 0; i < manifest.size(); i++)
+        {
+            if (i != 0)
+                text += ',';
+            append_number(text, manifest[i]);
+        }
+        text += "]}\n";
+    }
+
+    /**
+     * @brief Write a fleet as columns: the truck IDs, the depot and route stops as city codes, and the manifests. Cities that have not
+     * been written before are listed first, and are given the next codes in order
+     *
+     * @param scheduler_name The name of the scheduling algorithm
+     * @param scheduled The fleet
+     */
+    void write_binary_fleet(const string &scheduler_name, const fleet &scheduled)
+    {
+        const vector<trucks> &fleet_trucks = scheduled.trucks_in_fleet();
+        vector<uint32_t> depots, route_lengths, stops, manifest_lengths;
+        vector<string> new_cities;
+        auto code = [&](const string &city) {
+            auto found = city_codes.emplace(city, (uint32_t)city_codes.size());
+            if (found.second)
+                new_cities.push_back(city);
+            return found.first->second;
+        };
+        for (const trucks &truck : fleet_trucks)
+        {
+            depots.push_back(code(truck.home_depot()));
+            route_lengths.push_back((uint32_t)truck.route.size());
+            for (const string &stop : truck.route)
+                stops.push_back(code(stop));
+            manifest_lengths.push_back((uint32_t)scheduled.manifest(truck.my_id()).size());
+        }
+
+        string text;
+        put_value<uint8_t>(text, cities_block);
+        put_value<uint64_t>(text, new_cities.size());
+        for (const string &city : new_cities)
+            put_string(text, city);
+        put_value<uint8_t>(text, fleet_block);
+        put_string(text, scheduler_name);
+        put_value<uint64_t>(text, fleet_trucks.size());
+        for (const trucks &truck : fleet_trucks)
+            put_value<uint64_t>(text, truck.my_id());
+        for (const vector<uint32_t> *column : {&depots, &route_lengths})
+            text.append((const char *)column->data(), column->size() * sizeof(uint32_t));
+        put_value<uint64_t>(text, stops.size());
+        text.append((const char *)stops.data(), stops.size() * sizeof(uint32_t));
+        text.append((const char *)manifest_lengths.data(), manifest_lengths.size() * sizeof(uint32_t));
+        append(text);
+        for (const trucks &truck : fleet_trucks)
+        {
+            const vector<uint64_t> &manifest = scheduled.manifest(truck.my_id());
+            buffer.append((const char *)manifest.data(), manifest.size() * sizeof(uint64_t));
+            if (buffer.size() >= buffer_bytes)
+                flush();
+        }
+    }
+
+    /**
+     * @brief Add formatted output to the buffer, writing the buffer to the file once it is full
+     *
+     * @param text The formatted output
+     */
+    void append(const string &text)
+    {
+        buffer += text;
+        if (buffer.size() >= buffer_bytes)
+            flush();
+    }
+
+    /**
+     * @brief Write the buffer to the results file in one call
+     *
+     */
+    void flush()
+    {
+        out.write(buffer.data(), (streamsize)buffer.size());
+        if (!out)
+            throw result_invalidation::write_error(path);
+        buffer.clear();
+    }
+
+    /**
+     * @brief The results file, its path, and its format
+     *
+     */
+    ofstream out;
+    string path;
+    result_format format;
+    /**
+     * @brief The thread pool that formats chunks of trucks, the calling thread formats them if it is nullptr
+     *
+     */
+    thread_pool *pool;
+    /**
+     * @brief The output that has not been written yet, and how large it grows before it is written
+     *
+     */
+    string buffer;
+    uint64_t buffer_bytes;
+    /**
+     * @brief The code of each city already written to a binary results file
+     *
+     */
+    unordered_map<string, uint32_t> city_codes;
+    static constexpr uint64_t chunk_trucks = 1024; // The number of trucks formatted by each task
+    static constexpr const char *binary_magic = "FDXRES01";
+    static constexpr uint8_t cities_block = 0, fleet_block = 1, unpacked_block = 2;
+};
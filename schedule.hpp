@@ -12,32 +12,24 @@
 /* C++ Header Files */
 #pragma once
 #include "domain.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+#include "checkpoint.hpp"
+#include "timing.hpp"
+#include "pickup.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <random>
+#include <chrono>
+#include <sstream>
+#include <unordered_set>
+#include <unordered_map>
+#include <limits>
 
 using namespace std;
 
-/**
- * @brief Find the trucks that have enough room to pack a parcel
- * 
- * @param p_volume The volume of the parcel
- * @param truck_list The list of potential trucks
- * @return The subset of trucks that have enough room to pack the parcel
- */
-vector<trucks> enough_space(const uint64_t &p_volume, vector<trucks> &truck_list)
-{
-    vector<trucks> has_space;
-    for (const trucks &truck : truck_list)
-    {
-        if (truck.avail_space >= p_volume)
-            has_space.push_back(truck);
-    }
-    return has_space;
-}
-
 /**
  * @brief Check if truck A has a larger capacity than truck B
  * 
@@ -75,388 +67,1115 @@ bool smaller_destination_parcel(const parcels &a, const parcels &b)
 }
 
 /**
- * @brief Check is the parcel destination is already in the trucks route
+ * @brief Parcel ordering policy that loads parcels in the reverse of the order they were read
  * 
- * @param potential_trucks A list of trucks that could deliver the parcel
- * @param p The parcel to be packed and delivered
- * @return Either the same list of trucks or a subset of the list who have the destination already on route
  */
-vector<trucks> on_route(vector<trucks> &potential_trucks, const parcels &p)
+struct reverse_input_order
 {
     /**
-     * @brief A list of trucks that have the parcel destination already on route
+     * @brief Arrange the parcels into the sequence they will be loaded onto trucks
      * 
+     * @param parcel_list The list of parcels to be loaded
+     * @param order The indices of the parcels in loading sequence
      */
-    vector<trucks> route_trucks;
-    for (const trucks &truck : potential_trucks)
+    static void arrange(const item_span<const parcels> &parcel_list, vector<uint64_t> &order)
     {
-        for (const string &stop : truck.route)
-        {
-            if (stop == p.where_to()) // Check if the parcels destination is already on route
-            {
-                route_trucks.push_back(truck);
-                break;
-            }
-        }
+        order.resize(parcel_list.size());
+        for (uint64_t i = 0; i < order.size(); i++)
+            order[i] = order.size() - 1 - i;
     }
-    if (route_trucks.size() != 0) // If no trucks already had the parcels destination on route, return the original list
-        return route_trucks;
-    return potential_trucks;
-}
+
+    /**
+     * @brief Check if one parcel is loaded before another, by the position each was read at
+     * 
+     * @param a The first parcel
+     * @param a_read The position the first parcel was read at
+     * @param b The second parcel
+     * @param b_read The position the second parcel was read at
+     * @return True or False whether the first parcel is loaded first
+     */
+    static bool precedes(const parcels &, const uint64_t &a_read, const parcels &, const uint64_t &b_read)
+    {
+        return a_read > b_read;
+    }
+};
+
+/**
+ * @brief Parcel ordering policy that loads parcels in priority sequence, ties are loaded in the order they were read
+ * 
+ * @tparam before A comparison that is true if parcel A should be loaded before parcel B
+ */
+template <bool (*before)(const parcels &, const parcels &)>
+struct priority_order
+{
+    /**
+     * @brief Arrange the parcels into the sequence they will be loaded onto trucks
+     * 
+     * @param parcel_list The list of parcels to be loaded
+     * @param order The indices of the parcels in loading sequence
+     */
+    static void arrange(const item_span<const parcels> &parcel_list, vector<uint64_t> &order)
+    {
+        order.resize(parcel_list.size());
+        for (uint64_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        stable_sort(order.begin(), order.end(), [&parcel_list](const uint64_t &a, const uint64_t &b) { return before(parcel_list[a], parcel_list[b]); });
+    }
+
+    /**
+     * @brief Check if one parcel is loaded before another, in the same sequence as arrange
+     * 
+     * @param a The first parcel
+     * @param a_read The position the first parcel was read at
+     * @param b The second parcel
+     * @param b_read The position the second parcel was read at
+     * @return True or False whether the first parcel is loaded first
+     */
+    static bool precedes(const parcels &a, const uint64_t &a_read, const parcels &b, const uint64_t &b_read)
+    {
+        if (before(a, b))
+            return true;
+        return not before(b, a) and a_read < b_read;
+    }
+};
 
 /**
- * @brief A random scheduler that determines what parcels go on which trucks, and what route the trucks will take
+ * @brief Truck selection policy that picks one of the candidate trucks at random
  * 
  */
-class randomScheduler
+class random_truck
 {
 public:
     /**
-     * @brief Construct a new random Scheduler object
+     * @brief Construct a new random truck policy seeded from the system random device
      * 
-     * @param _parcel_list The list of parcels to be loaded on trucks and delivered
-     * @param _truck_list The list of trucks available for delivering parcels
      */
-    randomScheduler(const vector<parcels> &_parcel_list, vector<trucks> &_truck_list) : truck_list(_truck_list), parcel_list(_parcel_list) {}
+    random_truck() : mt(random_device{}()) {}
 
     /**
-     * @brief Schedule the given parcels onto the given trucks. Mutate truck objects but NOT parcel objects
+     * @brief Every truck with room is a separate chance, so trucks that are the same in every way cannot stand in for each other
      * 
-     * @return A list of parcels that could not get loaded on trucks due to lack of capacity
      */
-    vector<parcels> schedule()
+    static constexpr bool interchangeable_trucks = false;
+
+    /**
+     * @brief Choose the truck to load a parcel onto
+     * 
+     * @param truck_list The list of all trucks
+     * @param candidates The indices of the trucks the parcel could be loaded onto, never empty
+     * @param parcel The parcel to be loaded
+     * @return The index of the chosen truck
+     */
+    uint64_t pick(const item_span<const trucks> &, const vector<uint64_t> &candidates, const parcels &)
     {
-        for (const parcels &parcel : parcel_list)
-            parcel_queue.push_back(parcel);
-        
-        /**
-         * @brief A list of parcels that could not be loaded onto a truck for delivery
-         * 
-         */
-        vector<parcels> not_packed_parcels;
+        uniform_int_distribution<uint64_t> uid(0, candidates.size() - 1);
+        return candidates[uid(mt)];
+    }
 
-        /* Load the parcels onto random trucks. */
-        while (not parcel_queue.empty())
-        {   
-            /**
-             * @brief The parcel to be loaded onto a truck
-             * 
-             */
-            parcels parcel = parcel_queue[parcel_queue.size() - 1];
-            parcel_queue.pop_back(); // Remove the last item in the parcel queue
-
-            /* Create a priority queue of trucks based on increasing volume. */
-            /**
-             * @brief A list of trucks this parcel will fit on
-             * 
-             */
-            vector<trucks> truck_candidates;
-            for (const trucks &truck : truck_list)
-            {
-                if (truck.avail_space >= parcel.volume())
-                    truck_candidates.push_back(truck);
-            }
+    /**
+     * @brief Seed the random number generator, so that the same seed always makes the same schedule
+     * 
+     * @param s The seed
+     */
+    void seed(const uint64_t &s)
+    {
+        mt.seed((mt19937::result_type)s);
+    }
 
-            if (truck_candidates.empty())
-                not_packed_parcels.push_back(parcel); // We are unable to deliver the parcel
-            else
-            {
-                uint64_t avail_length = truck_candidates.size();
-                random_device rd;
-                mt19937 mt(rd());
-                uniform_int_distribution<uint64_t> uid(0, avail_length - 1);
-                /**
-                 * @brief A randomly choosen truck to load the parcel onto
-                 * 
-                 */
-                trucks load_truck = truck_candidates[uid(mt)];
-
-                uint64_t index = 0;
-                for (trucks &truck : truck_list)
-                {
-                    if (truck.my_id() == load_truck.my_id())
-                    {
-                        truck_list[index].pack_truck(parcel);
-                        break;
-                    }
-                    index += 1;
-                }
-            }
-        }
-        return not_packed_parcels;
+    /**
+     * @brief This policy does not use distances
+     * 
+     */
+    void use_map(const distanceMap &) {}
+
+    /**
+     * @brief Save the state of the random number generator to a checkpoint
+     * 
+     * @param writer The checkpoint being built
+     */
+    void save_state(checkpoint_writer &writer) const
+    {
+        ostringstream state;
+        state << mt;
+        writer.put(state.str());
+    }
+
+    /**
+     * @brief Restore the state of the random number generator from a checkpoint
+     * 
+     * @param reader The checkpoint being read
+     */
+    void restore_state(checkpoint_reader &reader)
+    {
+        istringstream state(reader.get_string());
+        state >> mt;
+        if (!state)
+            reader.reject();
     }
+
 private:
     /**
-     * @brief The list of trucks that are available for delivering parcels
+     * @brief The random number generator used to choose trucks
      * 
      */
-    vector<trucks> &truck_list;
+    mt19937 mt;
+};
+
+/**
+ * @brief Truck selection policy that picks the candidate truck with the largest capacity, ties go to the truck read first
+ * 
+ */
+struct largest_truck
+{
     /**
-     * @brief The list of parcels that need to be delivered
+     * @brief Of trucks that are the same in every way this policy always picks the one read first, so only that one is offered
      * 
      */
-    const vector<parcels> &parcel_list;
+    static constexpr bool interchangeable_trucks = true;
+
     /**
-     * @brief The list of parcels to be packed onto trucks in priority sequence
+     * @brief Choose the truck to load a parcel onto
      * 
+     * @param truck_list The list of all trucks
+     * @param candidates The indices of the trucks the parcel could be loaded onto, never empty
+     * @param parcel The parcel to be loaded
+     * @return The index of the chosen truck
      */
-    vector<parcels> parcel_queue;
+    uint64_t pick(const item_span<const trucks> &truck_list, const vector<uint64_t> &candidates, const parcels &) const
+    {
+        uint64_t best = candidates[0];
+        for (const uint64_t &index : candidates)
+        {
+            if (larger_volume_truck(truck_list[index], truck_list[best]))
+                best = index;
+        }
+        return best;
+    }
+
+    /**
+     * @brief This policy does not use distances
+     * 
+     */
+    void use_map(const distanceMap &) {}
+
+    /**
+     * @brief This policy has no state to save to a checkpoint
+     * 
+     */
+    void save_state(checkpoint_writer &) const {}
+
+    /**
+     * @brief This policy has no state to restore from a checkpoint
+     * 
+     */
+    void restore_state(checkpoint_reader &) {}
 };
 
 /**
- * @brief A small package large truck scheduler that determines what parcels go on which trucks, and what route the trucks wil take
+ * @brief Truck selection policy that picks the candidate truck that adds the least to the cost of the fleet. Sending out a truck
+ * without parcels costs its dispatch cost and the round trip from its depot, and loading a truck that is already out costs the
+ * detour to its closed tour, which is nothing if it already stops at the parcel destination. The depot, last stop, and stops of
+ * each route are kept by city index and brought up to date as the route grows, so each candidate costs three distance lookups.
+ * Ties go to the larger truck and then to the truck read first
  * 
  */
-class mostparcelScheduler
+class cheapest_truck
 {
 public:
     /**
-     * @brief Construct a new mostparcel Scheduler object
+     * @brief Trucks that are the same in every way add the same cost, and ties go to the truck read first, so only that one is offered
      * 
-     * @param _parcel_list The list of parcels to be loaded on trucks and delivered
-     * @param _truck_list The list of trucks available for delivering parcels
      */
-    mostparcelScheduler(const vector<parcels> &_parcel_list, vector<trucks> &_truck_list) : truck_list(_truck_list), parcel_list(_parcel_list) {}
+    static constexpr bool interchangeable_trucks = true;
 
     /**
-     * @brief Schedule parcels on trucks, priority given to smaller parcels and larger trucks to pack most parcels and use least trucks
+     * @brief Measure detours with a distance map, without one this policy picks the largest truck
      * 
-     * @return A list of parcels that could not get loaded on trucks due to lack of capacity
+     * @param _dmap The distance map
      */
-    vector<parcels> schedule()
+    void use_map(const distanceMap &_dmap)
+    {
+        dmap = &_dmap;
+        tours.clear();
+    }
+
+    /**
+     * @brief Choose the truck to load a parcel onto
+     * 
+     * @param truck_list The list of all trucks
+     * @param candidates The indices of the trucks the parcel could be loaded onto, never empty
+     * @param parcel The parcel to be loaded
+     * @return The index of the chosen truck
+     */
+    uint64_t pick(const item_span<const trucks> &truck_list, const vector<uint64_t> &candidates, const parcels &parcel)
     {
-        /* Add the parcels to the parcel queue in priority sequence. */
-        for (const parcels &parcel : parcel_list)
+        if (not dmap)
+            return largest_truck().pick(truck_list, candidates, parcel);
+        uint32_t dest;
+        try
         {
-            /* Check if the parcel queue has items and the given parcel has a lower priority than the last parcel in the queue. */
-            if (not parcel_queue.empty() and not smaller_volume_parcel(parcel, parcel_queue.at(parcel_queue.size() - 1)))
+            dest = dmap->city_id(parcel.where_to());
+        }
+        catch (const map_invalidation::map_error &)
+        {
+            return largest_truck().pick(truck_list, candidates, parcel);
+        }
+        if (tours.size() != truck_list.size())
+            tours.assign(truck_list.size(), tour());
+        uint64_t best = candidates[0], best_cost = added_cost(truck_list[best], tours[best], dest);
+        for (uint64_t i = 1; i < candidates.size(); i++)
+        {
+            uint64_t index = candidates[i], cost = added_cost(truck_list[index], tours[index], dest);
+            if (cost < best_cost or (cost == best_cost and larger_volume_truck(truck_list[index], truck_list[best])))
             {
-                uint64_t i = parcel_queue.size();
-                /* Find where in the priority queue the parcel should be inserted. */
-                while (i > 0 and not smaller_volume_parcel(parcel, parcel_queue[i - 1]))
-                    i -= 1;
-                parcel_queue.insert(parcel_queue.begin() + (int64_t)i, parcel);
+                best = index;
+                best_cost = cost;
             }
-            else // The queue is empty so add the parcel to the queue
-                parcel_queue.push_back(parcel);
         }
+        return best;
+    }
 
-        /**
-         * @brief A list of parcels that could not be loaded onto a truck for delivery
-         * 
-         */
-        vector<parcels> not_packed_parcels;
-        /* Load the parcels onto the trucks in priority sequence. */
-        while (not parcel_queue.empty())
-        {   
-            truck_queue.clear(); // Re-initialize the queue for this parcel
-            parcels parcel = parcel_queue[parcel_queue.size() - 1];
-            parcel_queue.pop_back(); // Remove the last item in the parcel queue
-
-            /**
-             * @brief A list of trucks this parcel will fit on to be sorted
-             * 
-             */
-            vector<trucks> truck_candidates;
-            /* Create a priority queue of trucks based on increasing volume. */
-            for (const trucks &truck : truck_list)
-            {
-                if (truck.avail_space >= parcel.volume())
-                    truck_candidates.push_back(truck);
-            }
+    /**
+     * @brief This policy has no state to save to a checkpoint, the routes it follows are saved with the trucks
+     * 
+     */
+    void save_state(checkpoint_writer &) const {}
 
-            if (truck_candidates.empty())
-                not_packed_parcels.push_back(parcel); // We are unable to deliver the parcel
-            else
+    /**
+     * @brief This policy has no state to restore from a checkpoint
+     * 
+     */
+    void restore_state(checkpoint_reader &)
+    {
+        tours.clear();
+    }
+
+private:
+    /**
+     * @brief The stops of a route by city index, as far as the route has been followed
+     * 
+     */
+    struct tour
+    {
+        uint64_t known_stops = 0;
+        uint32_t depot = 0, last = 0;
+        unordered_set<uint32_t> stops;
+    };
+
+    /**
+     * @brief The cost of loading a parcel onto a truck, found from the change to its closed tour
+     * 
+     * @param truck The truck
+     * @param route The stops of the trucks route, brought up to date here
+     * @param dest The index of the parcel destination
+     * @return The added cost (in cents), or the largest cost if the truck cannot reach the destination
+     */
+    uint64_t added_cost(const trucks &truck, tour &route, const uint32_t &dest) const
+    {
+        uint64_t dispatch = truck.parcels_list.empty() ? truck.fixed_cost() : 0;
+        try
+        {
+            for (; route.known_stops < truck.route.size(); route.known_stops++)
             {
-                /**
-                 * @brief Generate a list of trucks that already have the parcel destination on their routes, or use the original list if no trucks are on route
-                 * 
-                 */
-                vector<trucks> checked_route = on_route(truck_candidates, parcel);
-                for (const trucks &truck : checked_route)
-                {
-                    if (not truck_queue.empty() and not larger_volume_truck(truck, truck_queue.at(truck_queue.size() - 1)))
-                    {
-                        /* Check if the truck queue has items and the given truck has a lower priority than the last truck in the queue. */
-                        uint64_t i = truck_queue.size();
-                        /* Find where in the priority queue the truck should be inserted. */
-                        while (i > 0 and not larger_volume_truck(truck, truck_queue[i - 1]))
-                            i -= 1;
-                        truck_queue.insert(truck_queue.begin() + (int64_t)i, truck);
-                    }
-                    else // The queue is empty so add the truck to the queue
-                        truck_queue.push_back(truck);
-                }
-                /* Pack the parcel in the highest priority truck (the last truck in the truck queue). */
-                /**
-                 * @brief The truck with the highest priority
-                 * 
-                 */
-                trucks load_truck = truck_queue.at(truck_queue.size() - 1); 
-                uint64_t index = 0;
-                /* Pack the highest priority truck. */
-                for (trucks &truck : truck_list)
-                {
-                    if (truck.my_id() == load_truck.my_id())
-                    {
-                        truck_list[index].pack_truck(parcel);
-                        break;
-                    }
-                    index += 1;
-                }
+                route.last = dmap->city_id(truck.route[route.known_stops]);
+                if (route.known_stops == 0)
+                    route.depot = route.last;
+                route.stops.insert(route.last);
             }
+            if (route.stops.count(dest) != 0)
+                return dispatch;
+            uint64_t detour = dmap->distance(route.last, dest) + dmap->distance(dest, route.depot) - dmap->distance(route.last, route.depot);
+            return dispatch + truck.km_cost() * detour;
+        }
+        catch (const map_invalidation::map_error &)
+        {
+            return numeric_limits<uint64_t>::max();
         }
-        return not_packed_parcels;
     }
-private:
-/**
- * @brief The list of trucks that are available to pack
- * 
- */
-    vector<trucks> &truck_list;
+
     /**
-     * @brief The list of parcels to be packed onto trucks
+     * @brief The distance map detours are measured with, and the stops of each route
      * 
      */
-    const vector<parcels> &parcel_list;
+    const distanceMap *dmap = nullptr;
+    vector<tour> tours;
+};
+
+/**
+ * @brief Route affinity policy that gives no preference to any truck
+ * 
+ */
+struct no_route_affinity
+{
+    static constexpr bool enabled = false;
+
     /**
-     * @brief The list of trucks available to pack in priority sequence
+     * @brief Check if a truck should be preferred for delivering a parcel
      * 
+     * @return Always false
      */
-    vector<trucks> truck_queue;
+    static bool prefers(const trucks &, const parcels &)
+    {
+        return false;
+    }
+};
+
+/**
+ * @brief Route affinity policy that prefers trucks which already have the parcel destination on their route
+ * 
+ */
+struct destination_on_route
+{
+    static constexpr bool enabled = true;
+
     /**
-     * @brief The list of parcels to be packed onto trucks in priority sequence
+     * @brief Check if a truck should be preferred for delivering a parcel
      * 
+     * @param truck The truck that could deliver the parcel
+     * @param p The parcel to be delivered
+     * @return If the parcel destination is already a stop on the trucks route
      */
-    vector<parcels> parcel_queue;
+    static bool prefers(const trucks &truck, const parcels &p)
+    {
+        return find(truck.route.begin(), truck.route.end(), p.where_to()) != truck.route.end();
+    }
 };
 
 /**
- * @brief A small parcel destination large truck scheduler that determines what parcels go on which trucks, and what route the trucks wil take
+ * @brief A scheduling engine that determines what parcels go on which trucks, and what route the trucks will take.
+ * The engine is specialized at compile time by three policies so that no virtual calls are made while packing
  * 
+ * @tparam parcel_order Arranges the parcels into the sequence they are loaded
+ * @tparam truck_choice Chooses a truck from the trucks that have room for a parcel
+ * @tparam route_affinity Narrows the candidate trucks to those preferred for a parcel, if any
  */
-class shortrouteScheduler
+template <class parcel_order, class truck_choice, class route_affinity>
+class scheduler
 {
 public:
     /**
-     * @brief Construct a new shortroute Scheduler object
+     * @brief Construct a new scheduler object
      * 
      * @param _parcel_list The list of parcels to be loaded on trucks and delivered
      * @param _truck_list The list of trucks available for delivering parcels
      */
-    shortrouteScheduler(const vector<parcels> &_parcel_list, vector<trucks> &_truck_list) : truck_list(_truck_list), parcel_list(_parcel_list) {}
+    scheduler(const item_span<const parcels> &_parcel_list, const item_span<trucks> &_truck_list) : truck_list(_truck_list), parcel_list(_parcel_list) {}
 
     /**
-     * @brief Schedule parcels on trucks, priority given to parcels with smaller destinations and larger trucks to put parcels with same destination on same trucks
+     * @brief The parcel ordering policy, so that parcels kept outside the scheduler can be given to it in the same sequence
+     * 
+     */
+    using order_policy = parcel_order;
+
+    /**
+     * @brief Schedule the given parcels onto the given trucks. Mutate truck objects but NOT parcel objects
      * 
      * @return A list of parcels that could not get loaded on trucks due to lack of capacity
      */
     vector<parcels> schedule()
     {
-        /* Add the parcels to the parcel queue in priority sequence. */
-        for (const parcels &parcel : parcel_list)
+        /**
+         * @brief The indices of the parcels that could not be loaded onto a truck for delivery
+         * 
+         */
+        vector<uint64_t> not_packed;
+        bool out_of_time = false;
+        uint64_t first = 0; // The position in the parcel queue to start loading from
+        /* Add the parcels to the parcel queue in priority sequence, unless a checkpoint says where an earlier run stopped. */
+        if (not (checkpoints.resume and restore_checkpoint(first, out_of_time, not_packed)))
+            parcel_order::arrange(parcel_list, parcel_queue);
+        prepare_trucks();
+
+        /* Load the parcels onto the trucks in priority sequence. */
+        for (uint64_t i = first; i < parcel_queue.size(); i++)
         {
-            /* Check if the parcel queue has items and the given parcel has a lower priority than the last parcel in the queue. */
-            if (not parcel_queue.empty() and not smaller_destination_parcel(parcel, parcel_queue.at(parcel_queue.size() - 1)))
-            {
-                uint64_t i = parcel_queue.size();
-                /* Find where in the priority queue the parcel should be inserted. */
-                while (i > 0 and not smaller_destination_parcel(parcel, parcel_queue[i - 1]))
-                    i -= 1;
-                parcel_queue.insert(parcel_queue.begin() + (int64_t)i, parcel);
-            }
-            else // The queue is empty so add the parcel to the queue
-                parcel_queue.push_back(parcel);
+            if (not checkpoints.path.empty() and i != first and i % checkpoints.every_parcels == 0)
+                save_checkpoint(i, out_of_time, not_packed);
+            const parcels &parcel = parcel_list[parcel_queue[i]];
+            /* Check the deadline every so often, once it has passed the remaining parcels are left unpacked. */
+            if (i % 64 == 0 and deadline != chrono::steady_clock::time_point::max())
+                out_of_time = out_of_time or chrono::steady_clock::now() >= deadline;
+            if (out_of_time or not load(parcel))
+                not_packed.push_back(parcel_queue[i]); // We are unable to deliver the parcel
         }
+        finish_trucks();
+        if (not checkpoints.path.empty())
+            save_checkpoint(parcel_queue.size(), out_of_time, not_packed);
+        parcel_queue.clear();
 
         /**
          * @brief A list of parcels that could not be loaded onto a truck for delivery
          * 
          */
         vector<parcels> not_packed_parcels;
-        /* Load the parcels onto the trucks in priority sequence. */
-        while (not parcel_queue.empty())
-        {   
-            truck_queue.clear();
-            parcels parcel = parcel_queue[parcel_queue.size() - 1];
-            parcel_queue.pop_back(); // remove the last item in the parcel queue
-
-            /**
-             * @brief A list of trucks this parcel will fit on to be sorted
-             * 
-             */
-            vector<trucks> truck_candidates;
-            /* Create a priority queue of trucks based on increasing volume. */
-            for (const trucks &truck : truck_list)
+        not_packed_parcels.reserve(not_packed.size());
+        for (const uint64_t &index : not_packed)
+            not_packed_parcels.push_back(parcel_list[index]);
+        return not_packed_parcels;
+    }
+
+    /**
+     * @brief Get the trucks ready for parcels that are given one at a time with load, instead of the parcels the scheduler was
+     * constructed with. The parcels must be given in the sequence of the parcel ordering policy for the schedule to be the same
+     * 
+     */
+    void prepare_trucks()
+    {
+        if (clock)
+        {
+            for (trucks &truck : truck_list)
+                clock->prepare(truck);
+            if (not pickup_delivery)
+                stops.prepare(truck_list);
+        }
+        if (pickup_delivery)
+        {
+            planner = pickup_planner(clock);
+            planner.prepare(truck_list);
+        }
+        group_trucks();
+    }
+
+    /**
+     * @brief Write back onto the trucks what the scheduler keeps about them while parcels are given with load, once the last parcel is loaded
+     * 
+     */
+    void finish_trucks()
+    {
+        if (pickup_delivery)
+            planner.finish(truck_list);
+    }
+
+    /**
+     * @brief Load one parcel onto the truck chosen for it
+     * 
+     * @param parcel The parcel to be loaded
+     * @return True or False whether any truck could take the parcel
+     */
+    bool load(const parcels &parcel)
+    {
+        uint64_t t_index;
+        if (not select_truck(parcel, t_index))
+            return false;
+        if (pickup_delivery)
+            planner.pack(truck_list, t_index, request);
+        else if (clock)
+        {
+            clock->pack(truck_list[t_index], stops.position(truck_list[t_index], t_index, destination), parcel);
+            stops.update(truck_list[t_index], t_index);
+        }
+        else
+            truck_list[t_index].pack_truck(parcel);
+        split_class(t_index);
+        PROFILE_COUNT(parcels_assigned, 1);
+        return true;
+    }
+
+    /**
+     * @brief The truck selection policy, so that it can be configured before scheduling
+     * 
+     * @return The truck selection policy used by this scheduler
+     */
+    truck_choice &truck_policy()
+    {
+        return chooser;
+    }
+
+    /**
+     * @brief Set a time limit for scheduling. Parcels that have not been loaded when the deadline passes are returned as unpacked
+     * 
+     * @param _deadline The time by which scheduling must stop
+     */
+    void set_deadline(const chrono::steady_clock::time_point &_deadline)
+    {
+        deadline = _deadline;
+    }
+
+    /**
+     * @brief Deliver every parcel within its time window and keep every route within its trucks shift limit, using the travel times
+     * of a clock. Without a clock time is not considered
+     * 
+     * @param _clock The travel clock, or nullptr to ignore time
+     */
+    void set_travel_clock(const travel_clock *_clock)
+    {
+        clock = _clock;
+    }
+
+    /**
+     * @brief Pick each parcel up at its source city instead of loading every parcel at the depot. A truck visits the source city
+     * of each of its parcels before the destination, and only needs room for the parcels it carries at each point of its route.
+     * The route affinity policy then prefers trucks that already stop at the destination after the pickup
+     * 
+     * @param _pickup_delivery True or False whether parcels are picked up at their source city
+     */
+    void set_pickup_delivery(const bool &_pickup_delivery)
+    {
+        pickup_delivery = _pickup_delivery;
+    }
+
+    /**
+     * @brief Save the progress of scheduling to a checkpoint file every so often, and optionally resume from that file.
+     * A resumed run makes exactly the same schedule as a run that was never stopped
+     * 
+     * @param _checkpoints Where and how often to save checkpoints, and whether to resume
+     */
+    void set_checkpoints(const checkpoint_spec &_checkpoints)
+    {
+        checkpoints = _checkpoints;
+        checkpoints.every_parcels = max<uint64_t>(checkpoints.every_parcels, 1);
+    }
+
+private:
+    /**
+     * @brief Save the truck loads and routes, the rest of the parcel queue, the unpacked parcels, and the truck selection policy state
+     * 
+     * @param next The position in the parcel queue of the next parcel to be loaded
+     * @param out_of_time If the deadline has passed
+     * @param not_packed The indices of the parcels that could not be loaded so far
+     */
+    void save_checkpoint(const uint64_t &next, const bool &out_of_time, const vector<uint64_t> &not_packed)
+    {
+        finish_trucks();
+        checkpoint_writer writer;
+        writer.put(checkpoint_magic);
+        writer.put(fingerprint());
+        writer.put((uint64_t)pickup_delivery);
+        writer.put(next);
+        writer.put((uint64_t)out_of_time);
+        writer.put(vector<uint64_t>(parcel_queue.begin() + (int64_t)next, parcel_queue.end()));
+        writer.put(not_packed);
+        writer.put(truck_list.size());
+        for (const trucks &truck : truck_list)
+        {
+            for (const uint64_t &room : truck.avail_load)
+                writer.put(room);
+            writer.put(truck.parcels_list);
+            writer.put(truck.route.size());
+            for (const string &stop : truck.route)
+                writer.put(stop);
+            writer.put(truck.timing.size());
+            for (const stop_time &stop : truck.timing)
             {
-                if (truck.avail_space >= parcel.volume())
-                    truck_candidates.push_back(truck);
+                for (const uint64_t &value : {stop.arrival, stop.start, stop.window.earliest, stop.window.latest, stop.slack, stop.waited, stop.head_slack})
+                    writer.put(value);
             }
-            if (truck_candidates.empty())
-                not_packed_parcels.push_back(parcel); // We are unable to deliver the parcel
-            else
+            writer.put(truck.onboard.size());
+            for (const load_vector &carried : truck.onboard)
             {
-                /**
-                 * @brief Generate a list of trucks that already have the parcel destination on their routes, or use the original list if no trucks are on route
-                 * 
-                 */
-                vector<trucks> checked_route = on_route(truck_candidates, parcel); // A list of trucks that already have the parcel destination on their route
-                for (const trucks &truck : checked_route)
-                {
-                    if (not truck_queue.empty() and not larger_volume_truck(truck, truck_queue.at(truck_queue.size() - 1)))
-                    {
-                        /* Check if the truck queue has items and the given truck has a lower priority than the last truck in the queue. */
-                        uint64_t i = truck_queue.size();
-                        /* Find where in the priority queue the truck should be inserted. */
-                        while (i > 0 and not larger_volume_truck(truck, truck_queue[i - 1]))
-                            i -= 1;
-                        truck_queue.insert(truck_queue.begin() + (int64_t)i, truck);
-                    }
-                    else // The queue is empty so add the truck to the queue
-                        truck_queue.push_back(truck);
-                }
-                /* Pack the parcel in the highest priority truck (the last truck in the truck queue). */
-                /**
-                 * @brief The truck with the highest priority
-                 * 
-                 */
-                trucks load_truck = truck_queue.at(truck_queue.size() - 1); 
-                uint64_t index = 0;
-
-                for (trucks &truck : truck_list)
+                for (const uint64_t &amount : carried)
+                    writer.put(amount);
+            }
+        }
+        chooser.save_state(writer);
+        if (not writer.commit(checkpoints.path))
+            throw checkpoint_invalidation::save_error(checkpoints.path);
+    }
+
+    /**
+     * @brief Restore the state saved by save_checkpoint
+     * 
+     * @param first The position in the parcel queue of the next parcel to be loaded
+     * @param out_of_time If the deadline had passed
+     * @param not_packed The indices of the parcels that could not be loaded so far
+     * @return True or False whether there was a checkpoint to resume from
+     */
+    bool restore_checkpoint(uint64_t &first, bool &out_of_time, vector<uint64_t> &not_packed)
+    {
+        checkpoint_reader reader(checkpoints.path);
+        if (not reader.exists())
+            return false;
+        if (reader.get() != checkpoint_magic or reader.get() != fingerprint() or reader.get() != (uint64_t)pickup_delivery)
+            reader.reject();
+        first = reader.get();
+        out_of_time = reader.get() != 0;
+        vector<uint64_t> remaining = reader.get_vector();
+        not_packed = reader.get_vector();
+        if (first > parcel_list.size() or first + remaining.size() != parcel_list.size() or reader.get() != truck_list.size())
+            reader.reject();
+        for (const uint64_t &index : remaining)
+        {
+            if (index >= parcel_list.size())
+                reader.reject();
+        }
+        for (const uint64_t &index : not_packed)
+        {
+            if (index >= parcel_list.size())
+                reader.reject();
+        }
+        /* The positions before the resume point have already been loaded and are never read. */
+        parcel_queue.assign(first, 0);
+        parcel_queue.insert(parcel_queue.end(), remaining.begin(), remaining.end());
+        for (trucks &truck : truck_list)
+        {
+            for (uint64_t &room : truck.avail_load)
+                room = reader.get();
+            truck.parcels_list = reader.get_vector();
+            truck.route.resize(reader.get());
+            for (string &stop : truck.route)
+                stop = reader.get_string();
+            uint64_t timed_stops = reader.get();
+            if (timed_stops > truck.route.size())
+                reader.reject();
+            truck.timing.resize(timed_stops);
+            for (stop_time &stop : truck.timing)
+            {
+                for (uint64_t *value : {&stop.arrival, &stop.start, &stop.window.earliest, &stop.window.latest, &stop.slack, &stop.waited, &stop.head_slack})
+                    *value = reader.get();
+            }
+            uint64_t carried_stops = reader.get();
+            if (carried_stops > truck.route.size())
+                reader.reject();
+            truck.onboard.resize(carried_stops);
+            for (load_vector &carried : truck.onboard)
+            {
+                for (uint64_t &amount : carried)
+                    amount = reader.get();
+            }
+        }
+        chooser.restore_state(reader);
+        return true;
+    }
+
+    /**
+     * @brief Identify the trucks and parcels being scheduled, computed once
+     * 
+     * @return The schedule fingerprint
+     */
+    uint64_t fingerprint()
+    {
+        if (not fingerprint_known)
+        {
+            data_fingerprint = schedule_fingerprint(parcel_list, truck_list);
+            fingerprint_known = true;
+        }
+        return data_fingerprint;
+    }
+
+    /**
+     * @brief Group the trucks that are still empty and the same in every way into classes, so that a parcel is checked against
+     * one truck of each class instead of all of them. A class is searched through its first truck, and the next truck of the class
+     * is searched once the first one is given a parcel. Truck selection policies that would not always pick the first truck of a
+     * class search every truck
+     * 
+     */
+    void group_trucks()
+    {
+        search_list.clear();
+        next_in_class.assign(truck_list.size(), no_next);
+        /* The last truck of each class so far, by the state that makes trucks interchangeable. */
+        unordered_map<string, uint64_t> class_tail;
+        string key;
+        for (uint64_t i = 0; i < truck_list.size(); i++)
+        {
+            const trucks &truck = truck_list[i];
+            if (truck_choice::interchangeable_trucks and truck.parcels_list.empty())
+            {
+                key = class_key(truck);
+                auto found = class_tail.find(key);
+                if (found != class_tail.end())
                 {
-                    if (truck.my_id() == load_truck.my_id())
-                    {
-                        truck_list[index].pack_truck(parcel);
-                        break;
-                    }
-                    index += 1;
+                    next_in_class[found->second] = i;
+                    found->second = i;
+                    continue;
                 }
+                class_tail.emplace(key, i);
             }
+            search_list.push_back(i);
         }
-        return not_packed_parcels;
     }
 
-private:
     /**
-     * @brief The list of trucks that are available to pack
+     * @brief Describe everything about an empty truck that a parcel could be checked against, the capacities, room, route, timing,
+     * load carried, shift limit, and costs, so that two trucks with the same description are interchangeable
+     * 
+     * @param truck The truck
+     * @return The description of the truck
+     */
+    static string class_key(const trucks &truck)
+    {
+        ostringstream key;
+        for (const uint64_t &value : truck.limits())
+            key << value << ',';
+        for (const uint64_t &value : truck.avail_load)
+            key << value << ',';
+        key << truck.max_duration() << ',' << truck.fixed_cost() << ',' << truck.km_cost() << ',' << truck.home_depot() << '\n';
+        for (const string &stop : truck.route)
+            key << stop << '\n';
+        for (const stop_time &stop : truck.timing)
+            key << stop.arrival << ',' << stop.start << ',' << stop.window.earliest << ',' << stop.window.latest << ',' << stop.slack << ',' << stop.waited << ',' << stop.head_slack << ',';
+        for (const load_vector &carried : truck.onboard)
+        {
+            for (const uint64_t &amount : carried)
+                key << amount << ',';
+        }
+        return key.str();
+    }
+
+    /**
+     * @brief Search the next truck of a class once the truck searched for it has been given a parcel
+     * 
+     * @param t_index The index of the truck that was given a parcel
+     */
+    void split_class(const uint64_t &t_index)
+    {
+        uint64_t next = next_in_class[t_index];
+        if (next == no_next)
+            return;
+        next_in_class[t_index] = no_next;
+        search_list.insert(upper_bound(search_list.begin(), search_list.end(), next), next);
+    }
+
+    /**
+     * @brief Choose the truck to load a parcel onto
+     * 
+     * @param parcel The parcel to be loaded
+     * @param t_index The index of the chosen truck
+     * @return True or False whether any truck has room for the parcel
+     */
+    bool select_truck(const parcels &parcel, uint64_t &t_index)
+    {
+        truck_candidates.clear();
+        route_candidates.clear();
+        if (pickup_delivery)
+            request = planner.request(parcel);
+        else if (clock)
+            destination = stops.number(parcel.where_to());
+        PROFILE_COUNT(candidate_trucks_scanned, search_list.size());
+        for (const uint64_t &i : search_list)
+        {
+            bool preferred = false;
+            if (pickup_delivery)
+            {
+                if (not planner.can_pack(truck_list, i, request, preferred))
+                    continue;
+            }
+            else if (not fits(parcel.load(), truck_list[i].avail_load))
+                continue;
+            else if (clock)
+            {
+                uint64_t k = stops.position(truck_list[i], i, destination);
+                if (not clock->can_pack(truck_list[i], k, parcel))
+                    continue;
+                preferred = k < truck_list[i].route.size(); // The stop found for the clock also tells if the destination is on route
+            }
+            else
+                preferred = route_affinity::enabled and route_affinity::prefers(truck_list[i], parcel);
+            truck_candidates.push_back(i);
+            if (route_affinity::enabled and preferred)
+                route_candidates.push_back(i);
+        }
+        if (truck_candidates.empty())
+            return false;
+        /* Give priority to trucks that already have the parcel destination on their route. */
+        t_index = chooser.pick(truck_list, route_candidates.empty() ? truck_candidates : route_candidates, parcel);
+        return true;
+    }
+
+    /**
+     * @brief The list of trucks that are available for delivering parcels
+     * 
+     */
+    item_span<trucks> truck_list;
+    /**
+     * @brief The list of parcels that need to be delivered
+     * 
+     */
+    item_span<const parcels> parcel_list;
+    /**
+     * @brief The policy used to choose a truck for each parcel
      * 
      */
-    vector<trucks> &truck_list;
+    truck_choice chooser;
     /**
-     * @brief The list of parcels to be packed onto trucks
+     * @brief The time by which scheduling must stop, no limit by default
      * 
      */
-    const vector<parcels> &parcel_list;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
     /**
-     * @brief The list of trucks available to pack in priority sequence
+     * @brief The indices of the parcels to be packed onto trucks in priority sequence
      * 
      */
-    vector<trucks> truck_queue;
+    vector<uint64_t> parcel_queue;
     /**
-     * @brief The list of parcels to be packed onto trucks in priority sequence
+     * @brief The indices of the trucks with enough room for the current parcel, reused between parcels
      * 
      */
-    vector<parcels> parcel_queue;
-};
\ No newline at end of file
+    vector<uint64_t> truck_candidates;
+    /**
+     * @brief The indices of the candidate trucks preferred by the route affinity policy, reused between parcels
+     * 
+     */
+    vector<uint64_t> route_candidates;
+    /**
+     * @brief The indices of the trucks searched for each parcel in order, one for each class of interchangeable empty trucks and
+     * every truck that has been given a parcel, and the next truck of the class of each searched truck
+     * 
+     */
+    vector<uint64_t> search_list;
+    vector<uint64_t> next_in_class;
+    static constexpr uint64_t no_next = numeric_limits<uint64_t>::max();
+    /**
+     * @brief Where and how often checkpoints are saved, no checkpoints by default
+     * 
+     */
+    checkpoint_spec checkpoints;
+    /**
+     * @brief The travel times used to deliver parcels on time, time is not considered by default
+     * 
+     */
+    const travel_clock *clock = nullptr;
+    /**
+     * @brief The stops of each truck by city when time is considered, and the current parcel destination numbered by it
+     * 
+     */
+    route_stops stops;
+    uint32_t destination = 0;
+    /**
+     * @brief If parcels are picked up at their source city, and the planner that tracks the load carried along each route
+     * 
+     */
+    bool pickup_delivery = false;
+    pickup_planner planner;
+    pickup_request request; // The current parcel with its cities numbered by the planner
+    uint64_t data_fingerprint = 0;
+    bool fingerprint_known = false;
+    static constexpr uint64_t checkpoint_magic = 0x3554504b43584446ULL; // "FDXCKPT5"
+};
+
+/**
+ * @brief A random scheduler that loads each parcel onto a randomly chosen truck with enough room
+ * 
+ */
+using randomScheduler = scheduler<reverse_input_order, random_truck, no_route_affinity>;
+
+/**
+ * @brief A small package large truck scheduler, priority given to smaller parcels and larger trucks to pack most parcels and use least trucks
+ * 
+ */
+using mostparcelScheduler = scheduler<priority_order<smaller_volume_parcel>, largest_truck, destination_on_route>;
+
+/**
+ * @brief A small parcel destination large truck scheduler, priority given to parcels with smaller destinations and larger trucks to put parcels with same destination on same trucks
+ * 
+ */
+using shortrouteScheduler = scheduler<priority_order<smaller_destination_parcel>, largest_truck, destination_on_route>;
+
+/**
+ * @brief A low cost scheduler, parcels with smaller destinations go first and each goes to the truck that adds the least to the cost of the fleet,
+ * weighing the dispatch cost of a new truck against the detours of trucks that are already out
+ * 
+ */
+using lowcostScheduler = scheduler<priority_order<smaller_destination_parcel>, cheapest_truck, no_route_affinity>;
+
+/**
+ * @brief Find the depot that owns a parcel, which is the depot in the parcels source city or else the depot closest to it
+ * 
+ * @param parcel The parcel to be delivered
+ * @param depots The list of depot cities
+ * @param dmap The distance map
+ * @return The index of the owning depot, or the number of depots if no depot can reach the parcels source city
+ */
+uint64_t owning_depot(const parcels &parcel, const vector<string> &depots, const distanceMap &dmap)
+{
+    if (depots.size() == 1)
+        return 0; // A single depot owns every parcel
+    const string source = parcel.where_from();
+    for (uint64_t i = 0; i < depots.size(); i++)
+    {
+        if (depots[i] == source)
+            return i;
+    }
+    uint64_t owner = depots.size();
+    uint64_t owner_distance = 0;
+    for (uint64_t i = 0; i < depots.size(); i++)
+    {
+        try
+        {
+            uint64_t d = dmap.distance(source, depots[i]);
+            if (owner == depots.size() or d < owner_distance)
+            {
+                owner = i;
+                owner_distance = d;
+            }
+        }
+        catch (const map_invalidation::map_error &)
+        {
+            continue; // This depot cannot reach the source city
+        }
+    }
+    return owner;
+}
+
+/**
+ * @brief The lists used to split a schedule by depot, kept between calls to schedule_depots so that scheduling again with similar
+ * trucks and parcels reuses their memory
+ * 
+ */
+struct depot_workspace
+{
+    vector<string> depots;
+    vector<vector<uint64_t> > depot_truck_index;  // The indices of the trucks of each depot, in the order they were given
+    vector<vector<uint64_t> > depot_parcel_index; // The indices of the parcels each depot owns
+    vector<vector<trucks> > depot_trucks;          // A copy of the trucks of each depot
+    vector<vector<parcels> > depot_parcels;        // A copy of the parcels each depot owns
+    vector<vector<parcels> > depot_unpacked;       // The parcels each depot could not load
+};
+
+/**
+ * @brief Check if every truck starts from the same depot, so that its trucks and parcels can be scheduled in place without being split
+ * 
+ * @param truck_list The list of trucks, each with its own depot
+ * @return True or False whether there is at least one truck and all of them share a depot
+ */
+bool shares_one_depot(const item_span<trucks> &truck_list)
+{
+    for (const trucks &truck : truck_list)
+    {
+        if (truck.home_depot() != truck_list[0].home_depot())
+            return false;
+    }
+    return not truck_list.empty();
+}
+
+/**
+ * @brief Split the trucks by depot, keeping the depots and the trucks within a depot in the order they were read
+ * 
+ * @param truck_list The list of trucks, each with its own depot
+ * @param w The lists to split the trucks in, set to the depots and the indices of the trucks of each depot, with an empty list of parcel indices for each depot
+ */
+void split_trucks(const item_span<trucks> &truck_list, depot_workspace &w)
+{
+    w.depots.clear();
+    for (vector<uint64_t> &depot : w.depot_truck_index)
+        depot.clear();
+    for (uint64_t i = 0; i < truck_list.size(); i++)
+    {
+        uint64_t d = find(w.depots.begin(), w.depots.end(), truck_list[i].home_depot()) - w.depots.begin();
+        if (d == w.depots.size())
+        {
+            w.depots.push_back(truck_list[i].home_depot());
+            if (w.depot_truck_index.size() < w.depots.size())
+                w.depot_truck_index.emplace_back();
+        }
+        w.depot_truck_index[d].push_back(i);
+    }
+    w.depot_truck_index.resize(w.depots.size());
+    w.depot_parcel_index.resize(w.depots.size());
+    w.depot_trucks.resize(w.depots.size());
+    w.depot_parcels.resize(w.depots.size());
+    w.depot_unpacked.resize(w.depots.size());
+    for (vector<uint64_t> &depot : w.depot_parcel_index)
+        depot.clear();
+}
+
+/**
+ * @brief Copy the trucks and parcels of one depot into its own lists. Called from a task on the NUMA node the depot is scheduled on,
+ * so that the copies are placed on that node
+ * 
+ * @param truck_list The list of trucks that was split
+ * @param parcel_list The list of parcels that was split
+ * @param w The lists the trucks and parcels were split in
+ * @param d The index of the depot
+ */
+void place_depot(const item_span<trucks> &truck_list, const item_span<const parcels> &parcel_list, depot_workspace &w, const uint64_t &d)
+{
+    w.depot_trucks[d].clear();
+    for (const uint64_t &index : w.depot_truck_index[d])
+        w.depot_trucks[d].push_back(truck_list[index]);
+    w.depot_parcels[d].clear();
+    for (const uint64_t &index : w.depot_parcel_index[d])
+        w.depot_parcels[d].push_back(parcel_list[index]);
+}
+
+/**
+ * @brief Put the packed trucks of each depot back in the order they were read
+ * 
+ * @param truck_list The list of trucks that was split, replaced by the packed trucks
+ * @param w The lists the trucks were split in
+ */
+void gather_trucks(const item_span<trucks> &truck_list, const depot_workspace &w)
+{
+    for (uint64_t d = 0; d < w.depots.size(); d++)
+    {
+        for (uint64_t k = 0; k < w.depot_truck_index[d].size(); k++)
+            truck_list[w.depot_truck_index[d][k]] = w.depot_trucks[d][k];
+    }
+}
+
+/**
+ * @brief Schedule parcels onto trucks that start from several depots. Each depot is scheduled independently as a task on the thread pool using its own trucks and the parcels it owns.
+ * The depots are spread over the NUMA nodes of the pool, and each depot task copies its trucks and parcels on its own node. When every truck starts from the same depot the trucks and parcels are scheduled where they are, without copying them
+ * 
+ * @tparam scheduler_type The scheduler used for every depot
+ * @param parcel_list The list of parcels to be loaded on trucks and delivered
+ * @param truck_list The list of trucks available for delivering parcels, each with its own depot
+ * @param dmap The distance map used to find the depot that owns each parcel, and the travel times when parcels have time windows or trucks have shift limits
+ * @param pool The thread pool that runs the depot tasks
+ * @param deadline The time by which scheduling must stop, no limit by default
+ * @param checkpoints Where and how often to save checkpoints, each depot saves to the path followed by .depot and its number
+ * @param pickup_delivery Pick each parcel up at its source city instead of loading every parcel at the depot
+ * @param workspace The lists to split the schedule by depot in, or nullptr to use new lists
+ * @return A list of parcels that could not get loaded on trucks, either due to lack of capacity, because no depot can reach them, or because the deadline passed
+ */
+template <class scheduler_type>
+vector<parcels> schedule_depots(const item_span<const parcels> &parcel_list, const item_span<trucks> &truck_list, const distanceMap &dmap, thread_pool &pool, const chrono::steady_clock::time_point &deadline = chrono::steady_clock::time_point::max(), const checkpoint_spec &checkpoints = checkpoint_spec(), const bool &pickup_delivery = false, depot_workspace *workspace = nullptr)
+{
+    /* Time is only tracked when some delivery is constrained in time, so that schedules without windows cost nothing extra. */
+    travel_clock clock(dmap);
+    bool timed = needs_timing(parcel_list, truck_list);
+    auto schedule_depot = [&](const item_span<const parcels> &own_parcels, const item_span<trucks> &own_trucks, const uint64_t &d) {
+        scheduler_type depot_scheduler(own_parcels, own_trucks);
+        depot_scheduler.set_deadline(deadline);
+        depot_scheduler.truck_policy().use_map(dmap);
+        if (timed)
+            depot_scheduler.set_travel_clock(&clock);
+        depot_scheduler.set_pickup_delivery(pickup_delivery);
+        if (not checkpoints.path.empty())
+        {
+            checkpoint_spec depot_checkpoints = checkpoints;
+            depot_checkpoints.path += ".depot" + to_string(d);
+            depot_scheduler.set_checkpoints(depot_checkpoints);
+        }
+        return depot_scheduler.schedule();
+    };
+
+    /* A single depot owns every parcel, so its trucks and parcels are scheduled in place. */
+    if (shares_one_depot(truck_list))
+        return schedule_depot(parcel_list, truck_list, 0);
+
+    depot_workspace own_workspace;
+    depot_workspace &w = workspace ? *workspace : own_workspace;
+    split_trucks(truck_list, w);
+
+    /**
+     * @brief A list of parcels that could not be loaded onto a truck for delivery
+     * 
+     */
+    vector<parcels> not_packed_parcels;
+    for (uint64_t i = 0; i < parcel_list.size(); i++)
+    {
+        uint64_t d = owning_depot(parcel_list[i], w.depots, dmap);
+        if (d == w.depots.size())
+            not_packed_parcels.push_back(parcel_list[i]);
+        else
+            w.depot_parcel_index[d].push_back(i);
+    }
+
+    /* Schedule every depot as its own task so that large and small depots are balanced across the workers. A depot always goes to
+       the same node, so the lists of a reused workspace stay on the node they were first filled on. */
+    thread_pool::task_group depot_tasks(pool);
+    for (uint64_t d = 0; d < w.depots.size(); d++)
+    {
+        depot_tasks.submit_to_node(d, [&, d] {
+            place_depot(truck_list, parcel_list, w, d);
+            w.depot_unpacked[d] = schedule_depot(w.depot_parcels[d], w.depot_trucks[d], d);
+        });
+    }
+    depot_tasks.wait();
+
+    gather_trucks(truck_list, w);
+    for (uint64_t d = 0; d < w.depots.size(); d++)
+        not_packed_parcels.insert(not_packed_parcels.end(), w.depot_unpacked[d].begin(), w.depot_unpacked[d].end());
+    return not_packed_parcels;
+}
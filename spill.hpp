@@ -0,0 +1,592 @@
+/**
+ * @file spill.hpp
+ * @author Cassandra Masschelein
+ * @brief Define a parcel store that keeps parcels on disk in sorted runs when there are too many to hold in memory, and streams them
+ * to the schedulers in priority sequence
+ * @version 0.1
+ * @date 2022-04-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include "schedule.hpp"
+#include "timing.hpp"
+#include "profile.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <optional>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * @brief Unique error messages for parcels that cannot be kept on disk
+ *
+ */
+namespace spill_invalidation
+{
+    /**
+     * @brief Error message for when a run file cannot be written or read back
+     *
+     */
+    class spill_error : public invalid_argument
+    {
+        public:
+        /**
+         * @brief Construct a new spill error object
+         *
+         * @param path The path of the run file
+         */
+            explicit spill_error(const string &path) : invalid_argument("Error keeping parcels in the run file " + path + "!"){};
+    };
+}
+
+/**
+ * @brief Where the parcels that do not fit in memory are kept, and how much memory they may use
+ *
+ */
+struct spill_spec
+{
+    string directory = filesystem::temp_directory_path().string(); // The directory the run files are written to
+    uint64_t budget_bytes = 1ULL << 28;                             // The memory the parcels of one store may take up
+};
+
+/**
+ * @brief Writes parcels to a run file, each after the position it was read at
+ *
+ */
+class run_writer
+{
+public:
+    /**
+     * @brief Construct a new run writer object, creating the run file
+     *
+     * @param _path The path of the run file
+     */
+    explicit run_writer(const string &_path) : path(_path), out(_path, ios::binary | ios::trunc)
+    {
+        if (!out.is_open())
+            throw spill_invalidation::spill_error(path);
+    }
+
+    /**
+     * @brief Write a parcel
+     *
+     * @param parcel The parcel
+     * @param read_at The position the parcel was read at
+     */
+    void put(const parcels &parcel, const uint64_t &read_at)
+    {
+        put_value(read_at);
+        put_value(parcel.this_id());
+        for (const uint64_t &amount : parcel.load())
+            put_value(amount);
+        put_value(parcel.window().earliest);
+        put_value(parcel.window().latest);
+        put_string(parcel.where_from());
+        put_string(parcel.where_to());
+        if (buffer.size() >= buffer_bytes)
+            flush();
+    }
+
+    /**
+     * @brief Write everything that is still buffered and close the run file
+     *
+     */
+    void close()
+    {
+        flush();
+        out.close();
+        if (out.fail())
+            throw spill_invalidation::spill_error(path);
+    }
+
+private:
+    void put_value(const uint64_t &value)
+    {
+        buffer.append((const char *)&value, sizeof(value));
+    }
+
+    void put_string(const string &value)
+    {
+        put_value(value.size());
+        buffer += value;
+    }
+
+    void flush()
+    {
+        out.write(buffer.data(), (streamsize)buffer.size());
+        if (!out)
+            throw spill_invalidation::spill_error(path);
+        buffer.clear();
+    }
+
+    string path;
+    ofstream out;
+    string buffer;
+    static constexpr uint64_t buffer_bytes = 1 << 16;
+};
+
+/**
+ * @brief Reads the parcels of a run file back one at a time, through a buffer of a chosen size
+ *
+ */
+class run_reader
+{
+public:
+    /**
+     * @brief Construct a new run reader object and read the first parcel
+     *
+     * @param _path The path of the run file
+     * @param buffer_bytes The size of the read buffer
+     */
+    run_reader(const string &_path, const uint64_t &buffer_bytes) : path(_path), buffer(max<uint64_t>(buffer_bytes, 1 << 12))
+    {
+        in.rdbuf()->pubsetbuf(buffer.data(), (streamsize)buffer.size());
+        in.open(path, ios::binary);
+        if (!in.is_open())
+            throw spill_invalidation::spill_error(path);
+        next();
+    }
+
+    /**
+     * @brief Move on to the next parcel of the run
+     *
+     * @return True or False whether there was another parcel
+     */
+    bool next()
+    {
+        uint64_t id;
+        if (not in.read((char *)&position, sizeof(position)))
+        {
+            current.reset();
+            return false;
+        }
+        load_vector load;
+        time_window window;
+        if (not get(id) or not get(load) or not get(window.earliest) or not get(window.latest))
+            throw spill_invalidation::spill_error(path);
+        string from_city = get_string(), to_city = get_string();
+        current.emplace(id, load, from_city, to_city, window);
+        return true;
+    }
+
+    /**
+     * @brief Check if there is a current parcel, there is none once the run has been read
+     *
+     * @return True or False whether there is a current parcel
+     */
+    bool has_parcel() const
+    {
+        return current.has_value();
+    }
+
+    /**
+     * @brief The current parcel, which is there until next returns false
+     *
+     * @return The parcel
+     */
+    const parcels &parcel() const
+    {
+        return *current;
+    }
+
+    /**
+     * @brief The position the current parcel was read at
+     *
+     * @return The position
+     */
+    const uint64_t &read_at() const
+    {
+        return position;
+    }
+
+private:
+    template <class value_type>
+    bool get(value_type &value)
+    {
+        return (bool)in.read((char *)&value, sizeof(value));
+    }
+
+    string get_string()
+    {
+        uint64_t length;
+        if (not get(length) or length > max_city_length)
+            throw spill_invalidation::spill_error(path);
+        string value(length, '\0');
+        if (not in.read(value.data(), (streamsize)length))
+            throw spill_invalidation::spill_error(path);
+        return value;
+    }
+
+    string path;
+    vector<char> buffer; // Set as the buffer of the file before it is opened, so that every reader uses its share of the budget
+    ifstream in;
+    optional<parcels> current;
+    uint64_t position = 0;
+    static constexpr uint64_t max_city_length = 1 << 16;
+};
+
+/**
+ * @brief The parcels of a schedule, kept in the sequence a parcel ordering policy loads them in. Parcels are added as they are read
+ * and held in memory until they take up the budget, then they are sorted and written to a run file on disk. Once every parcel has
+ * been added the runs are merged as the parcels are visited, so the parcels come out in the same sequence as if they had all been
+ * sorted in memory, and at most the budget is held at any time. Parcels that fit within the budget are never written to disk
+ *
+ * @tparam parcel_order The parcel ordering policy of the schedulers the parcels are given to
+ */
+template <class parcel_order>
+class external_parcels
+{
+public:
+    /**
+     * @brief Construct a new external parcels object
+     *
+     * @param _spec Where the run files are written and how much memory the parcels may take up
+     */
+    explicit external_parcels(const spill_spec &_spec) : spec(_spec)
+    {
+        spec.budget_bytes = max<uint64_t>(spec.budget_bytes, 1);
+        random_device seed;
+        file_prefix = (filesystem::path(spec.directory) / ("fedex-run-" + to_string(seed()) + "-")).string();
+    }
+
+    ~external_parcels()
+    {
+        for (const string &path : runs)
+        {
+            error_code ignored;
+            filesystem::remove(path, ignored);
+        }
+    }
+
+    external_parcels(const external_parcels &) = delete;
+    external_parcels &operator=(const external_parcels &) = delete;
+
+    /**
+     * @brief Add the next parcel read, writing the parcels held so far to a run file once they take up the budget
+     *
+     * @param parcel The parcel
+     */
+    void add(const parcels &parcel)
+    {
+        add(parcel, count);
+    }
+
+    /**
+     * @brief Add a parcel at a position of its own instead of the position it was read at, writing the parcels held so far to a run
+     * file once they take up the budget
+     *
+     * @param parcel The parcel
+     * @param position The position the parcel is kept at, which the parcel ordering policy sees in place of where it was read
+     */
+    void add(const parcels &parcel, const uint64_t &position)
+    {
+        held.push_back(parcel);
+        held_at.push_back(position);
+        count++;
+        held_bytes += parcel_bytes(parcel);
+        timed = timed or not parcel.window().unconstrained();
+        if (held_bytes >= spec.budget_bytes)
+            spill();
+    }
+
+    /**
+     * @brief Sort the parcels still held after the last one has been added, and merge runs until few enough are left to be read at the same time
+     *
+     */
+    void finish()
+    {
+        if (not runs.empty() and not held.empty())
+            spill();
+        else
+            sort_held();
+        while (runs.size() > max_open_runs)
+        {
+            PROFILE_SCOPE("spill/merge_runs");
+            vector<string> merged(runs.begin(), runs.begin() + max_open_runs);
+            string path = file_prefix + to_string(next_run++) + ".bin";
+            run_writer writer(path);
+            merge(merged, [&](const parcels &parcel, const uint64_t &read_at) { writer.put(parcel, read_at); });
+            writer.close();
+            for (const string &done : merged)
+                filesystem::remove(done);
+            runs.erase(runs.begin(), runs.begin() + max_open_runs);
+            runs.push_back(path);
+        }
+    }
+
+    /**
+     * @brief Visit every parcel in the sequence of the parcel ordering policy. The parcels are read back from the run files, each
+     * through a buffer of an equal share of the budget
+     *
+     * @tparam parcel_visitor A function taking a parcel and the position it was read at
+     * @param visit The function
+     */
+    template <class parcel_visitor>
+    void for_each(parcel_visitor visit) const
+    {
+        if (runs.empty())
+        {
+            for (const uint64_t &index : order)
+                visit(held[index], held_at[index]);
+            return;
+        }
+        merge(runs, visit);
+    }
+
+    /**
+     * @brief The number of parcels added
+     *
+     * @return The number of parcels
+     */
+    uint64_t size() const
+    {
+        return count;
+    }
+
+    /**
+     * @brief The number of run files the parcels are kept in, 0 if they are all in memory
+     *
+     * @return The number of run files
+     */
+    uint64_t run_count() const
+    {
+        return runs.size();
+    }
+
+    /**
+     * @brief Check if any parcel has a delivery window, so that time is only tracked when it needs to be
+     *
+     * @return True or False whether some parcel has a delivery window
+     */
+    bool has_windows() const
+    {
+        return timed;
+    }
+
+private:
+    /**
+     * @brief The memory a parcel takes up while it is held
+     *
+     * @param parcel The parcel
+     * @return The number of bytes
+     */
+    static uint64_t parcel_bytes(const parcels &parcel)
+    {
+        return sizeof(parcels) + 2 * sizeof(uint64_t) + parcel.where_from().size() + parcel.where_to().size();
+    }
+
+    /**
+     * @brief Sort the parcels held in memory into the sequence of the parcel ordering policy
+     *
+     */
+    void sort_held()
+    {
+        order.resize(held.size());
+        for (uint64_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        sort(order.begin(), order.end(), [this](const uint64_t &a, const uint64_t &b) { return parcel_order::precedes(held[a], held_at[a], held[b], held_at[b]); });
+    }
+
+    /**
+     * @brief Sort the parcels held in memory and write them to a new run file, then let their memory go
+     *
+     */
+    void spill()
+    {
+        PROFILE_SCOPE("spill/write_run");
+        sort_held();
+        string path = file_prefix + to_string(next_run++) + ".bin";
+        runs.push_back(path);
+        run_writer writer(path);
+        for (const uint64_t &index : order)
+            writer.put(held[index], held_at[index]);
+        writer.close();
+        held.clear();
+        held_at.clear();
+        order.clear();
+        held_bytes = 0;
+    }
+
+    /**
+     * @brief Merge sorted run files into one sequence, always taking the run whose next parcel the ordering policy loads first
+     *
+     * @tparam parcel_visitor A function taking a parcel and the position it was read at
+     * @param paths The run files
+     * @param visit The function
+     */
+    template <class parcel_visitor>
+    void merge(const vector<string> &paths, parcel_visitor visit) const
+    {
+        vector<unique_ptr<run_reader> > readers;
+        readers.reserve(paths.size());
+        for (const string &path : paths)
+            readers.push_back(make_unique<run_reader>(path, spec.budget_bytes / (paths.size() + 1)));
+        auto later = [&readers](const uint64_t &a, const uint64_t &b) {
+            return parcel_order::precedes(readers[b]->parcel(), readers[b]->read_at(), readers[a]->parcel(), readers[a]->read_at());
+        };
+        priority_queue<uint64_t, vector<uint64_t>, decltype(later)> heads(later);
+        for (uint64_t i = 0; i < readers.size(); i++)
+        {
+            if (readers[i]->has_parcel())
+                heads.push(i);
+        }
+        while (not heads.empty())
+        {
+            uint64_t r = heads.top();
+            heads.pop();
+            visit(readers[r]->parcel(), readers[r]->read_at());
+            if (readers[r]->next())
+                heads.push(r);
+        }
+    }
+
+    /**
+     * @brief Where the run files go and how much memory the parcels may take up
+     *
+     */
+    spill_spec spec;
+    string file_prefix;
+    /**
+     * @brief The run files written so far, in the order they were written
+     *
+     */
+    vector<string> runs;
+    uint64_t next_run = 0;
+    /**
+     * @brief The parcels held in memory, the position each was read at, and their sequence once sorted
+     *
+     */
+    vector<parcels> held;
+    vector<uint64_t> held_at;
+    vector<uint64_t> order;
+    uint64_t held_bytes = 0;
+    uint64_t count = 0;
+    bool timed = false;
+    static constexpr uint64_t max_open_runs = 64; // The most runs merged at once, larger sets are merged in passes
+};
+
+/**
+ * @brief Parcel ordering policy for the parcels a schedule could not load, which keeps them in the order of the position each was
+ * left behind at
+ *
+ */
+struct unpacked_order
+{
+    /**
+     * @brief Check if one parcel comes before another, by the position each was left behind at
+     *
+     * @param a The first parcel
+     * @param a_at The position the first parcel was left behind at
+     * @param b The second parcel
+     * @param b_at The position the second parcel was left behind at
+     * @return True or False whether the first parcel comes first
+     */
+    static bool precedes(const parcels &, const uint64_t &a_at, const parcels &, const uint64_t &b_at)
+    {
+        return a_at < b_at;
+    }
+
+    /**
+     * @brief The position of a parcel left behind, the parcels no depot can reach by the position they were read at and then the
+     * parcels of each depot by the position they were streamed at. The depot goes in the top bits, so up to 2^24 depots and 2^40
+     * parcels can be told apart
+     *
+     * @param group 0 for a parcel no depot can reach, otherwise one more than the index of the depot that could not load it
+     * @param index The position the parcel was read or streamed at
+     * @return The position
+     */
+    static uint64_t position(const uint64_t &group, const uint64_t &index)
+    {
+        return group << 40 | index;
+    }
+};
+
+/**
+ * @brief The parcels a schedule could not load, kept like the parcels themselves so they are written to disk once they take up the budget
+ *
+ */
+using external_unpacked = external_parcels<unpacked_order>;
+
+/**
+ * @brief Schedule parcels that are kept by an external parcel store onto trucks that start from several depots. The parcels are
+ * streamed once in priority sequence and each is loaded by the scheduler of the depot that owns it, so every depot loads its parcels
+ * in the same sequence and makes the same schedule as schedule_depots, without the parcels ever being held in memory together.
+ * The depots take turns on the calling thread as the parcels stream past, and checkpoints are not saved
+ * 
+ * @tparam scheduler_type The scheduler used for every depot
+ * @param parcel_store The parcels to be loaded on trucks and delivered, in the parcel order of the scheduler
+ * @param truck_list The list of trucks available for delivering parcels, each with its own depot
+ * @param dmap The distance map used to find the depot that owns each parcel, and the travel times when parcels have time windows or trucks have shift limits
+ * @param not_packed_parcels The store the parcels that could not get loaded on trucks are added to, and finished, so that they are
+ * visited in the same order as schedule_depots returns them
+ * @param deadline The time by which scheduling must stop, no limit by default
+ * @param pickup_delivery Pick each parcel up at its source city instead of loading every parcel at the depot
+ */
+template <class scheduler_type>
+void schedule_depots_external(const external_parcels<typename scheduler_type::order_policy> &parcel_store, const item_span<trucks> &truck_list, const distanceMap &dmap, external_unpacked &not_packed_parcels, const chrono::steady_clock::time_point &deadline = chrono::steady_clock::time_point::max(), const bool &pickup_delivery = false)
+{
+    travel_clock clock(dmap);
+    bool timed = parcel_store.has_windows() or needs_timing(item_span<const parcels>(), truck_list);
+    depot_workspace w;
+    bool one_depot = shares_one_depot(truck_list);
+    if (one_depot)
+        w.depots.push_back(truck_list[0].home_depot());
+    else
+    {
+        split_trucks(truck_list, w);
+        for (uint64_t d = 0; d < w.depots.size(); d++)
+            place_depot(truck_list, item_span<const parcels>(), w, d);
+    }
+
+    /* Each depot has its own scheduler over its own trucks, and is given its parcels one at a time. */
+    deque<scheduler_type> depot_schedulers;
+    for (uint64_t d = 0; d < w.depots.size(); d++)
+    {
+        scheduler_type &depot_scheduler = depot_schedulers.emplace_back(item_span<const parcels>(), one_depot ? truck_list : item_span<trucks>(w.depot_trucks[d]));
+        depot_scheduler.set_deadline(deadline);
+        depot_scheduler.truck_policy().use_map(dmap);
+        if (timed)
+            depot_scheduler.set_travel_clock(&clock);
+        depot_scheduler.set_pickup_delivery(pickup_delivery);
+        depot_scheduler.prepare_trucks();
+    }
+
+    /* The deadline is checked every so often for each depot, at the same points of its parcel sequence as schedule_depots checks it. */
+    vector<uint64_t> depot_loaded(w.depots.size(), 0);
+    vector<bool> out_of_time(w.depots.size(), false);
+    uint64_t streamed = 0;
+    parcel_store.for_each([&](const parcels &parcel, const uint64_t &read_at) {
+        uint64_t d = owning_depot(parcel, w.depots, dmap);
+        if (d == w.depots.size())
+        {
+            not_packed_parcels.add(parcel, unpacked_order::position(0, read_at));
+            return;
+        }
+        if (depot_loaded[d]++ % 64 == 0 and deadline != chrono::steady_clock::time_point::max())
+            out_of_time[d] = out_of_time[d] or chrono::steady_clock::now() >= deadline;
+        if (out_of_time[d] or not depot_schedulers[d].load(parcel))
+            not_packed_parcels.add(parcel, unpacked_order::position(d + 1, streamed));
+        streamed++;
+    });
+    for (scheduler_type &depot_scheduler : depot_schedulers)
+        depot_scheduler.finish_trucks();
+    if (not one_depot)
+        gather_trucks(truck_list, w);
+
+    /* The parcels no depot can reach come first in the order they were read, then the parcels each depot could not load. */
+    not_packed_parcels.finish();
+}
@@ -0,0 +1,640 @@
+/**
+ * @file thread_pool.hpp
+ * @author Cassandra Masschelein
+ * @brief Define a work-stealing thread pool for running independent scheduling tasks in parallel, with its workers kept on the NUMA nodes of the machine
+ * @version 0.1
+ * @date 2022-01-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "profile.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <limits>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief The NUMA nodes of the machine and the CPUs of each that this process may run on. Memory on a node is faster to reach from
+ * its own CPUs than from the CPUs of another node, so work and the data it uses are best kept on the same node
+ *
+ */
+struct numa_topology
+{
+    vector<vector<int> > node_cpus; // The CPUs of each node, empty for a node whose CPUs are not known
+
+    /**
+     * @brief Find the nodes from the Linux sysfs node directories, keeping only the CPUs in the affinity mask of this process. A
+     * machine whose nodes cannot be read is treated as one node
+     *
+     * @return The topology
+     */
+    static numa_topology detect()
+    {
+        numa_topology topology;
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        for (uint64_t node = 0;; node++)
+        {
+            ifstream cpulist("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+            if (!cpulist.is_open())
+                break;
+            string ranges;
+            getline(cpulist, ranges);
+            vector<int> cpus;
+            for (int cpu : parse_cpu_list(ranges))
+            {
+                if (not masked or (cpu < CPU_SETSIZE and CPU_ISSET(cpu, &allowed)))
+                    cpus.push_back(cpu);
+            }
+            if (not cpus.empty()) // Nodes with memory but no CPUs this process may use take no workers
+                topology.node_cpus.push_back(cpus);
+        }
+#endif
+        if (topology.node_cpus.empty())
+            topology.node_cpus.emplace_back();
+        return topology;
+    }
+
+    /**
+     * @brief Read a CPU list such as 0-3,8-11 from sysfs
+     *
+     * @param ranges The CPU list
+     * @return The CPUs in the list
+     */
+    static vector<int> parse_cpu_list(const string &ranges)
+    {
+        vector<int> cpus;
+        stringstream list(ranges);
+        string range;
+        while (getline(list, range, ','))
+        {
+            uint64_t dash = range.find('-');
+            try
+            {
+                int first = stoi(range.substr(0, dash));
+                int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++)
+                    cpus.push_back(cpu);
+            }
+            catch (const logic_error &) // An empty or malformed range holds no CPUs
+            {
+            }
+        }
+        return cpus;
+    }
+
+    /**
+     * @brief The number of nodes
+     *
+     * @return The number of nodes, at least 1
+     */
+    uint64_t nodes() const
+    {
+        return node_cpus.size();
+    }
+};
+
+/**
+ * @brief A pool of worker threads where each worker has its own queue of tasks, and idle workers steal tasks from busy workers. The
+ * workers are spread over the NUMA nodes in proportion to their CPUs and each is kept on the CPUs of its node, so a task submitted
+ * to a node runs there and the memory it first touches is placed there. An idle worker steals from the workers of its own node
+ * before it steals from another node. One pool is made by each program and shared by every parallel stage, each of which waits
+ * for its own tasks through a task_group
+ *
+ */
+class thread_pool
+{
+public:
+    /**
+     * @brief Construct a new thread pool object
+     *
+     * @param num_workers The number of worker threads, by default one per hardware thread
+     * @param _topology The NUMA nodes to spread the workers over, by default the nodes of this machine. Workers are only kept on
+     * their node's CPUs when there is more than one node
+     */
+    explicit thread_pool(const uint64_t &num_workers = thread::hardware_concurrency(), const numa_topology &_topology = numa_topology::detect())
+        : topology(_topology), queues(max<uint64_t>(num_workers, 1)), worker_node(queues.size(), 0), node_workers(topology.nodes()), next_node_queue(topology.nodes()), bound_queued(topology.nodes(), 0)
+    {
+        /* Give each node a share of the workers in proportion to its CPUs, so that the workers of a node fill it evenly. */
+        uint64_t total_cpus = 0;
+        for (const vector<int> &cpus : topology.node_cpus)
+            total_cpus += cpus.size();
+        for (uint64_t i = 0; i < queues.size(); i++)
+        {
+            if (total_cpus != 0)
+            {
+                uint64_t slot = i * total_cpus / queues.size();
+                while (slot >= topology.node_cpus[worker_node[i]].size())
+                    slot -= topology.node_cpus[worker_node[i]++].size();
+            }
+            node_workers[worker_node[i]].push_back(i);
+        }
+        for (uint64_t i = 0; i < queues.size(); i++)
+            workers.emplace_back([this, i] { run(i); });
+    }
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    /**
+     * @brief Destroy the thread pool object once all submitted tasks are finished
+     *
+     */
+    ~thread_pool()
+    {
+        {
+            lock_guard<mutex> lock(pool_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &worker : workers)
+            worker.join();
+    }
+
+    /**
+     * @brief Submit a task to the pool. Tasks submitted from a worker go onto that workers own queue
+     *
+     * @param task The task to be run
+     */
+    void submit(function<void()> task)
+    {
+        uint64_t target = (this_worker_pool == this) ? this_worker : next_queue++ % queues.size();
+        {
+            lock_guard<mutex> lock(pool_mutex);
+            pending += 1;
+            queued += 1;
+        }
+        {
+            lock_guard<mutex> lock(queues[target].queue_mutex);
+            queues[target].tasks.push_back(move(task));
+        }
+        wake.notify_one();
+    }
+
+    /**
+     * @brief Submit a task to be run on a NUMA node, so that the memory it allocates and first writes is placed on that node. The task
+     * goes onto the queue of one of the node's workers, and only a worker of another node that has nothing else to do takes it away,
+     * unless the task is bound to the node
+     *
+     * @param node The node, which is wrapped around the number of nodes
+     * @param task The task to be run
+     * @param bound True or False whether only the workers of the node may run the task
+     */
+    void submit_to_node(const uint64_t &node, function<void()> task, const bool &bound = false)
+    {
+        uint64_t n = node % topology.nodes();
+        if (node_workers[n].empty()) // More nodes than workers
+        {
+            submit(move(task));
+            return;
+        }
+        uint64_t target = node_workers[n][next_node_queue[n]++ % node_workers[n].size()];
+        {
+            lock_guard<mutex> lock(pool_mutex);
+            pending += 1;
+            (bound ? bound_queued[n] : queued) += 1;
+        }
+        {
+            lock_guard<mutex> lock(queues[target].queue_mutex);
+            (bound ? queues[target].bound_tasks : queues[target].tasks).push_back(move(task));
+        }
+        wake.notify_all(); // The worker the task was placed for may not be the one woken by notify_one
+    }
+
+    /**
+     * @brief A set of tasks submitted to a pool that is waited for on its own, so that callers sharing the pool each wait only for
+     * their own tasks. A worker that waits for a group runs other queued tasks until the group is finished instead of blocking, so a
+     * task may itself submit a group and wait for it
+     *
+     */
+    class task_group
+    {
+    public:
+        /**
+         * @brief Construct a new task group object
+         *
+         * @param _pool The pool the tasks of the group run on
+         */
+        explicit task_group(thread_pool &_pool) : pool(_pool) {}
+
+        /**
+         * @brief Destroy the task group object once its tasks are finished, without rethrowing their exceptions
+         *
+         */
+        ~task_group()
+        {
+            pool.help_until(pending);
+        }
+
+        task_group(const task_group &) = delete;
+        task_group &operator=(const task_group &) = delete;
+
+        /**
+         * @brief Submit a task of the group to the pool
+         *
+         * @param task The task to be run
+         */
+        void submit(function<void()> task)
+        {
+            pool.submit(counted(move(task)));
+        }
+
+        /**
+         * @brief Submit a task of the group to be run on a NUMA node, as thread_pool::submit_to_node does
+         *
+         * @param node The node, which is wrapped around the number of nodes
+         * @param task The task to be run
+         * @param bound True or False whether only the workers of the node may run the task
+         */
+        void submit_to_node(const uint64_t &node, function<void()> task, const bool &bound = false)
+        {
+            pool.submit_to_node(node, counted(move(task)), bound);
+        }
+
+        /**
+         * @brief Wait until every task of the group has finished. If one of them threw an exception it is rethrown here
+         *
+         */
+        void wait()
+        {
+            pool.help_until(pending);
+            lock_guard<mutex> lock(pool.pool_mutex);
+            if (first_error)
+            {
+                exception_ptr error = first_error;
+                first_error = nullptr;
+                rethrow_exception(error);
+            }
+        }
+
+    private:
+        /**
+         * @brief Count a task into the group, and wrap it so that its exception is kept by the group and the waiters are woken once
+         * the last task of the group finishes
+         *
+         * @param task The task
+         * @return The wrapped task
+         */
+        function<void()> counted(function<void()> task)
+        {
+            {
+                lock_guard<mutex> lock(pool.pool_mutex);
+                pending += 1;
+            }
+            return [this, task = move(task)] {
+                try
+                {
+                    task();
+                }
+                catch (...)
+                {
+                    lock_guard<mutex> lock(pool.pool_mutex);
+                    if (not first_error)
+                        first_error = current_exception();
+                }
+                lock_guard<mutex> lock(pool.pool_mutex);
+                pending -= 1;
+                if (pending == 0) // The group may be destroyed as soon as the lock is let go
+                {
+                    pool.done.notify_all();
+                    pool.wake.notify_all();
+                }
+            };
+        }
+
+        thread_pool &pool;
+        uint64_t pending = 0;     // The tasks of the group not yet finished, guarded by the pool mutex
+        exception_ptr first_error; // The first exception thrown by a task of the group, guarded by the pool mutex
+    };
+
+    /**
+     * @brief Run a task once on every NUMA node that has workers and wait for them, such as making a copy of read-only data on each node
+     *
+     * @param task The task, given the node it runs on
+     */
+    void on_each_node(const function<void(uint64_t)> &task)
+    {
+        task_group group(*this);
+        for (uint64_t node = 0; node < topology.nodes(); node++)
+        {
+            if (not node_workers[node].empty())
+                group.submit_to_node(node, [&task, node] { task(node); }, true);
+        }
+        group.wait();
+    }
+
+    /**
+     * @brief Wait until every task submitted to the pool has finished, including the tasks of other callers, so a caller that shares
+     * the pool waits for its own tasks with a task_group instead. If a task that is not in a group threw an exception it is rethrown here
+     *
+     */
+    void wait()
+    {
+        unique_lock<mutex> lock(pool_mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        if (first_error)
+        {
+            exception_ptr error = first_error;
+            first_error = nullptr;
+            rethrow_exception(error);
+        }
+    }
+
+    /**
+     * @brief The number of worker threads in this pool
+     *
+     * @return The number of workers
+     */
+    uint64_t size() const
+    {
+        return workers.size();
+    }
+
+    /**
+     * @brief The number of NUMA nodes the workers are spread over
+     *
+     * @return The number of nodes, 1 on a machine without NUMA
+     */
+    uint64_t nodes() const
+    {
+        return topology.nodes();
+    }
+
+    /**
+     * @brief The NUMA node of the calling thread, if it is a worker of some pool
+     *
+     * @return The node, or no_node for a thread that is not a worker
+     */
+    static uint64_t current_node()
+    {
+        return this_worker_pool ? this_worker_node : no_node;
+    }
+
+    /**
+     * @brief The node returned for threads that are not workers
+     *
+     */
+    static constexpr uint64_t no_node = numeric_limits<uint64_t>::max();
+
+private:
+    /**
+     * @brief The queue of tasks that belong to one worker
+     *
+     */
+    struct worker_queue
+    {
+        mutex queue_mutex;
+        deque<function<void()> > tasks;
+        deque<function<void()> > bound_tasks; // Tasks that only the workers of this queue's node may take
+    };
+
+    /**
+     * @brief Take a task for a worker, first from the back of its own queue, then from the front of the queues of the other workers
+     * on its node, and only then from the queues of other nodes
+     *
+     * @param index The index of the worker
+     * @param task The task that was taken
+     * @return True or False whether a task was found
+     */
+    bool take(const uint64_t &index, function<void()> &task)
+    {
+        bool bound = false;
+        if (not steal(index, task, bound))
+            return false;
+        lock_guard<mutex> lock(pool_mutex);
+        (bound ? bound_queued[worker_node[index]] : queued) -= 1;
+        return true;
+    }
+
+    /**
+     * @brief Remove a task from the queues for a worker, in the order described by take
+     *
+     * @param index The index of the worker
+     * @param task The task that was removed
+     * @param bound Set to whether the task was bound to the worker's node
+     * @return True or False whether a task was found
+     */
+    bool steal(const uint64_t &index, function<void()> &task, bool &bound)
+    {
+        for (const bool &same_node : {true, false})
+        {
+            for (uint64_t offset = 0; offset < queues.size(); offset++)
+            {
+                uint64_t victim = (index + offset) % queues.size();
+                if ((worker_node[victim] == worker_node[index]) != same_node)
+                    continue;
+                worker_queue &queue = queues[victim];
+                lock_guard<mutex> lock(queue.queue_mutex);
+                if (same_node and not queue.bound_tasks.empty())
+                {
+                    task = move(queue.bound_tasks.front());
+                    queue.bound_tasks.pop_front();
+                    bound = true;
+                    return true;
+                }
+                if (queue.tasks.empty())
+                    continue;
+                if (offset == 0)
+                {
+                    task = move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else // Steal the oldest task, which is most likely to be the largest
+                {
+                    task = move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                if (not same_node) // The task will mostly reach memory on another node
+                    PROFILE_COUNT(cross_node_steals, 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Run a task that was taken from the queues, keeping its exception, and count it as finished
+     *
+     * @param task The task
+     */
+    void run_task(function<void()> &task)
+    {
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            lock_guard<mutex> lock(pool_mutex);
+            if (not first_error)
+                first_error = current_exception();
+        }
+        lock_guard<mutex> lock(pool_mutex);
+        pending -= 1;
+        if (pending == 0)
+        {
+            done.notify_all();
+            if (stopping) // Let the sleeping workers see that the pool is finished
+                wake.notify_all();
+        }
+    }
+
+    /**
+     * @brief Wait until the tasks of a group are finished. A worker of this pool runs the tasks it can take meanwhile, and sleeps
+     * only while there are none, so the workers never all block on groups whose tasks are still queued
+     *
+     * @param group_pending The number of tasks of the group not yet finished, guarded by the pool mutex
+     */
+    void help_until(const uint64_t &group_pending)
+    {
+        if (this_worker_pool != this)
+        {
+            unique_lock<mutex> lock(pool_mutex);
+            done.wait(lock, [&] { return group_pending == 0; });
+            return;
+        }
+        while (true)
+        {
+            {
+                unique_lock<mutex> lock(pool_mutex);
+                wake.wait(lock, [&] { return group_pending == 0 or queued != 0 or bound_queued[this_worker_node] != 0; });
+                if (group_pending == 0)
+                    return;
+            }
+            function<void()> task;
+            if (take(this_worker, task))
+                run_task(task);
+        }
+    }
+
+    /**
+     * @brief Keep a worker on the CPUs of its node, when the machine has more than one node
+     *
+     * @param index The index of the worker
+     */
+    void pin(const uint64_t &index)
+    {
+#ifdef __linux__
+        const vector<int> &cpus = topology.node_cpus[worker_node[index]];
+        if (topology.nodes() < 2 or cpus.empty())
+            return;
+        cpu_set_t node_set;
+        CPU_ZERO(&node_set);
+        for (const int &cpu : cpus)
+        {
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &node_set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(node_set), &node_set); // A worker that cannot be kept on its node still runs
+#else
+        (void)index;
+#endif
+    }
+
+    /**
+     * @brief The loop run by each worker thread
+     *
+     * @param index The index of the worker
+     */
+    void run(const uint64_t index)
+    {
+        this_worker_pool = this;
+        this_worker = index;
+        this_worker_node = worker_node[index];
+        pin(index);
+        while (true)
+        {
+            function<void()> task;
+            if (take(index, task))
+            {
+                run_task(task);
+                continue;
+            }
+            unique_lock<mutex> lock(pool_mutex);
+            if (stopping and pending == 0)
+                return;
+            /* Sleep until a task this worker may take is queued. The counts change under the pool mutex, so a task queued after the failed take is seen here. */
+            wake.wait(lock, [&] { return queued != 0 or bound_queued[this_worker_node] != 0 or (stopping and pending == 0); });
+        }
+    }
+
+    /**
+     * @brief The NUMA nodes of the machine
+     *
+     */
+    numa_topology topology;
+    /**
+     * @brief The worker threads
+     *
+     */
+    vector<thread> workers;
+    /**
+     * @brief One task queue per worker
+     *
+     */
+    vector<worker_queue> queues;
+    /**
+     * @brief The node of each worker, the workers of each node, and the worker of each node that the next task submitted to it is placed on
+     *
+     */
+    vector<uint64_t> worker_node;
+    vector<vector<uint64_t> > node_workers;
+    vector<atomic<uint64_t> > next_node_queue;
+    /**
+     * @brief Guards the task counts, those of every task group, the stop flag and the first error
+     *
+     */
+    mutex pool_mutex;
+    condition_variable wake, done;
+    /**
+     * @brief The number of tasks submitted but not yet finished, the number still waiting in a queue that any worker may take, and
+     * the number waiting that only the workers of each node may take
+     *
+     */
+    uint64_t pending = 0;
+    uint64_t queued = 0;
+    vector<uint64_t> bound_queued;
+    bool stopping = false;
+    /**
+     * @brief The first exception thrown by a task
+     *
+     */
+    exception_ptr first_error;
+    /**
+     * @brief The queue that the next task submitted from outside the pool is placed on
+     *
+     */
+    atomic<uint64_t> next_queue{0};
+
+    /**
+     * @brief The pool and worker index of the current thread, if it is a worker
+     *
+     */
+    static thread_local thread_pool *this_worker_pool;
+    static thread_local uint64_t this_worker, this_worker_node;
+};
+
+inline thread_local thread_pool *thread_pool::this_worker_pool = nullptr;
+inline thread_local uint64_t thread_pool::this_worker = 0;
+inline thread_local uint64_t thread_pool::this_worker_node = 0;
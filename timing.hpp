@@ -0,0 +1,514 @@
+/**
+ * @file timing.hpp
+ * @author Cassandra Masschelein
+ * @brief Define the travel times of trucks, so that parcels are delivered within their time windows and routes stay within the truck shift limits
+ * @version 0.1
+ * @date 2022-03-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+/* C++ Header Files */
+#pragma once
+#include "domain.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief Add two times, a sum that would pass unlimited_time stays at unlimited_time
+ *
+ * @param a The first time
+ * @param b The second time
+ * @return The sum of the times
+ */
+uint64_t add_time(const uint64_t &a, const uint64_t &b)
+{
+    return a > unlimited_time - b ? unlimited_time : a + b;
+}
+
+/**
+ * @brief Check if any parcel has a delivery time window or any truck has a shift limit, so that time only has to be tracked when it matters
+ *
+ * @param parcel_list The list of parcels to be delivered
+ * @param truck_list The list of trucks available for delivering parcels
+ * @return True or False whether any delivery is constrained in time
+ */
+bool needs_timing(const item_span<const parcels> &parcel_list, const item_span<const trucks> &truck_list)
+{
+    for (const parcels &parcel : parcel_list)
+    {
+        if (not parcel.window().unconstrained())
+            return true;
+    }
+    for (const trucks &truck : truck_list)
+    {
+        if (truck.max_duration() != unlimited_time)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief The position of the stop in each city on the routes of a list of trucks, so that the stop a parcel would join is found
+ * without going over the route. Cities are numbered once per parcel so that trucks are looked up without comparing names
+ *
+ */
+class route_stops
+{
+public:
+    /**
+     * @brief Index the stops of every truck
+     *
+     * @param truck_list The list of trucks
+     */
+    void prepare(const item_span<const trucks> &truck_list)
+    {
+        positions.assign(truck_list.size(), unordered_map<uint32_t, uint64_t>());
+        indexed.assign(truck_list.size(), 0);
+        for (uint64_t t_index = 0; t_index < truck_list.size(); t_index++)
+            update(truck_list[t_index], t_index);
+    }
+
+    /**
+     * @brief Index the stops added to the end of a trucks route since it was last indexed
+     *
+     * @param truck The truck
+     * @param t_index The index of the truck, a truck past the end of the index is added to it
+     */
+    void update(const trucks &truck, const uint64_t &t_index)
+    {
+        if (t_index >= positions.size())
+        {
+            positions.resize(t_index + 1);
+            indexed.resize(t_index + 1, 0);
+        }
+        for (; indexed[t_index] < truck.route.size(); indexed[t_index]++)
+            positions[t_index].emplace(number(truck.route[indexed[t_index]]), indexed[t_index]); // A city visited twice is joined at its first stop
+    }
+
+    /**
+     * @brief Index the stops of a truck again, after stops were removed from its route
+     *
+     * @param truck The truck
+     * @param t_index The index of the truck
+     */
+    void reindex(const trucks &truck, const uint64_t &t_index)
+    {
+        positions[t_index].clear();
+        indexed[t_index] = 0;
+        update(truck, t_index);
+    }
+
+    /**
+     * @brief The number of a city, numbering it if it has not been seen before
+     *
+     * @param city The city name
+     * @return The number of the city
+     */
+    uint32_t number(const string &city)
+    {
+        return city_numbers.emplace(city, (uint32_t)city_numbers.size()).first->second;
+    }
+
+    /**
+     * @brief Find the stop of a truck in a city
+     *
+     * @param truck The truck
+     * @param t_index The index of the truck
+     * @param city The number of the city
+     * @return The position of the stop on the route, or the length of the route if the truck does not stop there
+     */
+    uint64_t position(const trucks &truck, const uint64_t &t_index, const uint32_t &city) const
+    {
+        auto found = positions[t_index].find(city);
+        return found == positions[t_index].end() ? truck.route.size() : found->second;
+    }
+
+private:
+    /**
+     * @brief The position of the stop in each city of every truck, and the number of stops of each truck that are indexed
+     *
+     */
+    vector<unordered_map<uint32_t, uint64_t> > positions;
+    vector<uint64_t> indexed;
+    unordered_map<string, uint32_t> city_numbers;
+};
+
+/**
+ * @brief The travel times of trucks between cities, found from the distance map and a constant speed. Each truck keeps the
+ * arrival time and the forward time slack of every stop on its route, which is how long that stop could start later without
+ * it or a later stop missing its window. Times are counted as if the truck left its depot at the start of the day, but the
+ * truck leaves as late as its windows allow, so the waiting before the first windows open is not part of its shift. The
+ * shift runs until the truck is back at its depot, and is checked from the time waited so far and how late the truck could
+ * leave, which each stop also keeps. With these and the stop found by route_stops, adding a parcel to a route is checked in
+ * constant time instead of going over the whole route again, and only a parcel that is actually loaded updates the route
+ *
+ */
+class travel_clock
+{
+public:
+    /**
+     * @brief Construct a new travel clock object
+     *
+     * @param _dmap The distance map that travel times are found from
+     * @param _km_per_hour The speed of every truck
+     * @param _service_minutes The time taken to make a delivery at each stop
+     */
+    travel_clock(const distanceMap &_dmap, const uint64_t &_km_per_hour = 60, const uint64_t &_service_minutes = 0) : dmap(_dmap), km_per_hour(max<uint64_t>(_km_per_hour, 1)), service_minutes(_service_minutes) {}
+
+    /**
+     * @brief The time taken to drive between two cities, rounded up to the next minute
+     *
+     * @param city_1 The city the truck leaves from
+     * @param city_2 The city the truck arrives at
+     * @return The travel time in minutes
+     */
+    uint64_t travel(const string &city_1, const string &city_2) const
+    {
+        if (city_1 == city_2)
+            return 0;
+        return (dmap.distance(city_1, city_2) * 60 + km_per_hour - 1) / km_per_hour;
+    }
+
+    /**
+     * @brief Time a trucks route if the truck was loaded without this clock. Stops that were not timed are given windows that never close
+     *
+     * @param truck The truck to be timed
+     */
+    void prepare(trucks &truck) const
+    {
+        if (truck.timing.size() == truck.route.size())
+            return;
+        vector<time_window> windows(truck.route.size());
+        for (uint64_t k = 0; k < truck.timing.size() and k < windows.size(); k++)
+            windows[k] = truck.timing[k].window;
+        retime(truck, windows);
+    }
+
+    /**
+     * @brief Time a whole route again from the depot, such as after stops were removed from it
+     *
+     * @param truck The truck to be timed
+     * @param windows The window of each stop on the route, in route order
+     */
+    void retime(trucks &truck, const vector<time_window> &windows) const
+    {
+        truck.timing.resize(truck.route.size());
+        for (uint64_t k = 0; k < truck.route.size(); k++)
+        {
+            stop_time &stop = truck.timing[k];
+            stop.window = windows[k];
+            stop.arrival = k == 0 ? 0 : add_time(departure(truck, k - 1), leg(truck.route[k - 1], truck.route[k]));
+            stop.start = max(stop.arrival, stop.window.earliest);
+        }
+        update_slack(truck);
+    }
+
+    /**
+     * @brief Check if a parcel can be delivered on time by a truck, and without the truck passing its shift limit. The parcel joins
+     * the stop at its destination if the truck already stops there, and is otherwise delivered at a new stop at the end of the route
+     *
+     * @param truck A truck that has been timed by this clock
+     * @param k The position of the stop at the parcel destination, found with route_stops, or the length of the route if the truck does not stop there
+     * @param parcel The parcel to be delivered
+     * @return True or False whether the parcel can be delivered on time
+     */
+    bool can_pack(const trucks &truck, const uint64_t &k, const parcels &parcel) const
+    {
+        if (k < truck.route.size())
+            return can_join(truck, k, parcel.window());
+        return can_insert(truck, truck.route.size(), parcel.where_to(), parcel.window());
+    }
+
+    /**
+     * @brief Check if a delivery can be added to a stop that is already on a route
+     *
+     * @param truck A truck that has been timed by this clock
+     * @param k The position of the stop on the route
+     * @param window The window of the delivery
+     * @return True or False whether the stop and every stop after it stay on time
+     */
+    bool can_join(const trucks &truck, const uint64_t &k, const time_window &window) const
+    {
+        /* The stop may have to wait for the later of the two windows to open, which delays every stop after it. */
+        const stop_time &stop = truck.timing[k];
+        uint64_t start = max(stop.start, window.earliest);
+        uint64_t latest = min(stop.window.latest, window.latest);
+        if (start > latest or start - stop.start > later_slack(truck, k))
+            return false;
+        uint64_t waited = add_time(stop.waited, start - stop.start);
+        uint64_t head_slack = min(k == 0 ? unlimited_time : truck.timing[k - 1].head_slack, add_time(waited, own_slack(latest, start)));
+        return pushed_within_shift(truck, k, waited, head_slack, start - stop.start);
+    }
+
+    /**
+     * @brief Check if a new stop can be put between two stops of a route without any stop missing its window or the route passing
+     * the shift limit. Only the stops on each side of the new stop are looked at
+     *
+     * @param truck A truck that has been timed by this clock
+     * @param position The position of the new stop on the route, after the depot and at most the length of the route
+     * @param city The city of the new stop
+     * @param window The window of the new stop
+     * @return True or False whether the new stop keeps the route on time
+     */
+    bool can_insert(const trucks &truck, const uint64_t &position, const string &city, const time_window &window) const
+    {
+        uint64_t arrival = add_time(departure(truck, position - 1), leg(truck.route[position - 1], city));
+        uint64_t start = max(arrival, window.earliest);
+        if (start > window.latest)
+            return false;
+        const stop_time &before = truck.timing[position - 1];
+        uint64_t waited = add_time(before.waited, start - arrival);
+        uint64_t head_slack = min(before.head_slack, add_time(waited, own_slack(window.latest, start)));
+        if (position == truck.route.size())
+            return within_shift(truck, add_time(add_time(start, service_minutes), leg(city, truck.route[0])), waited, head_slack);
+        const stop_time &next = truck.timing[position];
+        uint64_t next_arrival = add_time(add_time(start, service_minutes), leg(city, truck.route[position]));
+        if (max(next_arrival, next.window.earliest) > add_time(next.start, next.slack))
+            return false;
+        return pushed_within_shift(truck, position - 1, waited, head_slack, next_arrival > next.arrival ? next_arrival - next.arrival : 0);
+    }
+
+    /**
+     * @brief Check if a pickup stop followed by a delivery stop can be added to the end of a route
+     *
+     * @param truck A truck that has been timed by this clock
+     * @param pickup The city of the pickup stop, which has no window
+     * @param delivery The city of the delivery stop
+     * @param window The window of the delivery stop
+     * @return True or False whether the delivery is on time and the route stays within the shift limit
+     */
+    bool can_append_pickup(const trucks &truck, const string &pickup, const string &delivery, const time_window &window) const
+    {
+        uint64_t pickup_done = add_time(add_time(departure(truck, truck.route.size() - 1), leg(truck.route.back(), pickup)), service_minutes);
+        uint64_t arrival = add_time(pickup_done, leg(pickup, delivery));
+        uint64_t start = max(arrival, window.earliest);
+        if (start > window.latest)
+            return false;
+        const stop_time &last = truck.timing.back();
+        uint64_t waited = add_time(last.waited, start - arrival);
+        uint64_t head_slack = min(last.head_slack, add_time(waited, own_slack(window.latest, start)));
+        return within_shift(truck, add_time(add_time(start, service_minutes), leg(delivery, truck.route[0])), waited, head_slack);
+    }
+
+    /**
+     * @brief Load a parcel onto a truck and update the timing of its route
+     *
+     * @param truck A truck that has been timed by this clock
+     * @param k The position of the stop at the parcel destination, or the length of the route if the truck does not stop there
+     * @param parcel The parcel to be loaded, checked with can_pack first
+     * @return True or False whether that parcel was loaded
+     */
+    bool pack(trucks &truck, const uint64_t &k, const parcels &parcel) const
+    {
+        if (not truck.pack_truck(parcel))
+            return false;
+        if (k < truck.timing.size())
+            join(truck, k, parcel.window());
+        else
+            time_last_stop(truck, parcel.window());
+        return true;
+    }
+
+    /**
+     * @brief Add a delivery to a stop that is already on a route. The timing of the stops after a stop that now waits longer is
+     * pushed back as far as the delay reaches
+     *
+     * @param truck A truck that has been timed by this clock
+     * @param k The position of the stop on the route
+     * @param window The window of the delivery, checked with can_join first
+     */
+    void join(trucks &truck, const uint64_t &k, const time_window &window) const
+    {
+        stop_time &stop = truck.timing[k];
+        stop.window.earliest = max(stop.window.earliest, window.earliest);
+        stop.window.latest = min(stop.window.latest, window.latest);
+        uint64_t delay = max(stop.start, stop.window.earliest) - stop.start;
+        stop.start += delay;
+        for (uint64_t j = k + 1; j < truck.timing.size() and delay != 0; j++)
+        {
+            stop_time &later = truck.timing[j];
+            later.arrival = add_time(later.arrival, delay);
+            uint64_t start = max(later.arrival, later.window.earliest);
+            delay = start - later.start;
+            later.start = start;
+        }
+        update_slack(truck);
+    }
+
+    /**
+     * @brief Time the stop that was just added to the end of a route
+     *
+     * @param truck A truck whose route has one more stop than its timing
+     * @param window The window of the new stop
+     */
+    void time_last_stop(trucks &truck, const time_window &window) const
+    {
+        stop_time stop;
+        stop.arrival = add_time(departure(truck, truck.timing.size() - 1), leg(truck.route[truck.timing.size() - 1], truck.route[truck.timing.size()]));
+        stop.start = max(stop.arrival, window.earliest);
+        stop.window = window;
+        truck.timing.push_back(stop);
+        update_slack(truck);
+    }
+
+    /**
+     * @brief The time a route takes from leaving the depot, as late as the windows allow, to driving back to it after the last delivery
+     *
+     * @param truck A truck that has been timed by this clock
+     * @return The route duration in minutes
+     */
+    uint64_t route_duration(const trucks &truck) const
+    {
+        const stop_time &last = truck.timing.back();
+        uint64_t finish = route_finish(truck);
+        return finish == unlimited_time ? unlimited_time : finish - min(min(last.waited, last.head_slack), finish);
+    }
+
+private:
+    /**
+     * @brief The travel time between two stops of a route. A stop that no road reaches is never reached in time, which only
+     * matters if that stop or a later one has a window that closes or the truck has a shift limit
+     *
+     * @param city_1 The city the truck leaves from
+     * @param city_2 The city the truck arrives at
+     * @return The travel time in minutes, or unlimited_time if no road connects the cities
+     */
+    uint64_t leg(const string &city_1, const string &city_2) const
+    {
+        try
+        {
+            return travel(city_1, city_2);
+        }
+        catch (const map_invalidation::map_error &)
+        {
+            return unlimited_time;
+        }
+    }
+
+    /**
+     * @brief The time a truck leaves a stop, the depot has no delivery to make
+     *
+     * @param truck A timed truck
+     * @param k The position of the stop on the route
+     * @return The departure time in minutes
+     */
+    uint64_t departure(const trucks &truck, const uint64_t &k) const
+    {
+        return k == 0 ? truck.timing[0].start : add_time(truck.timing[k].start, service_minutes);
+    }
+
+    /**
+     * @brief The time a truck is back at its depot after the last delivery of its route
+     *
+     * @param truck A timed truck
+     * @return The time in minutes
+     */
+    uint64_t route_finish(const trucks &truck) const
+    {
+        uint64_t last = truck.timing.size() - 1;
+        return last == 0 ? departure(truck, 0) : add_time(departure(truck, last), leg(truck.route[last], truck.route[0]));
+    }
+
+    /**
+     * @brief How long the start of a stop can be delayed without missing its own window
+     *
+     * @param latest The latest start of the stop
+     * @param start The start of the stop
+     * @return The delay in minutes
+     */
+    static uint64_t own_slack(const uint64_t &latest, const uint64_t &start)
+    {
+        return latest == unlimited_time ? unlimited_time : (latest > start ? latest - start : 0);
+    }
+
+    /**
+     * @brief How long the departure from a stop can be delayed without a later stop missing its window
+     *
+     * @param truck A timed truck
+     * @param k The position of the stop on the route
+     * @return The delay in minutes
+     */
+    uint64_t later_slack(const trucks &truck, const uint64_t &k) const
+    {
+        if (k + 1 == truck.timing.size())
+            return unlimited_time;
+        const stop_time &next = truck.timing[k + 1];
+        return add_time(next.slack, next.start - next.arrival); // Waiting at the next stop absorbs part of a delay
+    }
+
+    /**
+     * @brief Check if a route keeps within the shift limit of its truck. The truck leaves its depot as late as its windows allow,
+     * but there is no use leaving later than the time it would otherwise wait, so that much is taken off the time it is back
+     *
+     * @param truck The truck
+     * @param finish The time the truck is back at its depot
+     * @param waited The time spent waiting for windows to open over the whole route
+     * @param head_slack How long leaving the depot can be delayed without any stop missing its window
+     * @return True or False whether the route keeps within the shift limit
+     */
+    static bool within_shift(const trucks &truck, const uint64_t &finish, const uint64_t &waited, const uint64_t &head_slack)
+    {
+        if (truck.max_duration() == unlimited_time)
+            return true;
+        return finish != unlimited_time and finish - min(min(waited, head_slack), finish) <= truck.max_duration();
+    }
+
+    /**
+     * @brief Check if a route keeps within the shift limit once a stop has changed and the stops after it are pushed back. A delay
+     * is taken up by the waiting at the later stops before it reaches the end of the route, and takes as much off the slack of each
+     * later stop as the waiting it uses up, so neither has to be gone over
+     *
+     * @param truck A timed truck, as it was before the change
+     * @param k The position of the last stop before the stops that are pushed back
+     * @param waited The time spent waiting up to and including the changed stop, after the change
+     * @param head_slack How long leaving the depot can be delayed without the changed stop or a stop before it missing its window
+     * @param delay How much later the truck arrives at the stop after position k
+     * @return True or False whether the route keeps within the shift limit
+     */
+    bool pushed_within_shift(const trucks &truck, const uint64_t &k, const uint64_t &waited, const uint64_t &head_slack, const uint64_t &delay) const
+    {
+        if (truck.max_duration() == unlimited_time)
+            return true;
+        const stop_time &stop = truck.timing[k];
+        uint64_t later_waited = truck.timing.back().waited - stop.waited;
+        uint64_t absorbed = min(delay, later_waited);
+        uint64_t later_head = add_time(add_time(stop.waited, later_slack(truck, k)), waited - stop.waited);
+        if (later_head != unlimited_time)
+            later_head -= min(later_head, delay);
+        return within_shift(truck, add_time(route_finish(truck), delay - absorbed), add_time(waited, later_waited - absorbed), min(head_slack, later_head));
+    }
+
+    /**
+     * @brief Compute the time waited up to each stop and how late the truck could leave its depot for each stop from the depot on,
+     * then the forward time slack of every stop from the end of the route back to the depot
+     *
+     * @param truck A timed truck
+     */
+    void update_slack(trucks &truck) const
+    {
+        for (uint64_t k = 0; k < truck.timing.size(); k++)
+        {
+            stop_time &stop = truck.timing[k];
+            stop.waited = add_time(k == 0 ? 0 : truck.timing[k - 1].waited, stop.start - stop.arrival);
+            stop.head_slack = min(k == 0 ? unlimited_time : truck.timing[k - 1].head_slack, add_time(stop.waited, own_slack(stop.window.latest, stop.start)));
+        }
+        for (uint64_t k = truck.timing.size(); k-- > 0;)
+        {
+            stop_time &stop = truck.timing[k];
+            stop.slack = min(own_slack(stop.window.latest, stop.start), later_slack(truck, k));
+        }
+    }
+
+    /**
+     * @brief The distance map that travel times are found from
+     *
+     */
+    const distanceMap &dmap;
+    uint64_t km_per_hour, service_minutes;
+};